@@ -621,6 +621,204 @@ class SimulStop(CTSTest):
 AllTestClasses.append(SimulStop)
 
 
+class SimulRejoin(CTSTest):
+    '''Restart all but one node ~ simultaneously, and check they get the current CIB'''
+    def __init__(self, cm):
+        CTSTest.__init__(self,cm)
+        self.name = "SimulRejoin"
+        self.startall = SimulStartLite(cm)
+        self.marker = "cts-simul-rejoin"
+
+    def cib_state(self, node):
+        '''Return the CIB generation and marker value in a node's local CIB'''
+        generation = None
+        value = None
+
+        (rc, lines) = self.rsh(node, "cibadmin --query --local", None)
+        if rc != 0 or len(lines) == 0:
+            return (None, None)
+
+        m = re.search(r'<cib .*admin_epoch="(\d+)"', lines[0])
+        n = re.search(r'<cib .* epoch="(\d+)"', lines[0])
+        if m and n:
+            generation = "%s.%s" % (m.group(1), n.group(1))
+
+        for line in lines:
+            m = re.search('name="%s" value="([^"]*)"' % self.marker, line)
+            if m:
+                value = m.group(1)
+        return (generation, value)
+
+    def __call__(self, node):
+        '''Perform the 'SimulRejoin' test. '''
+        self.incr("calls")
+
+        ret = self.startall(None)
+        if not ret:
+            return self.failure("Setup failed")
+
+        #     Stop every other node - at about the same time...
+        others = [n for n in self.Env["nodes"] if n != node]
+        watchpats = [ ]
+        for other in others:
+            watchpats.append(self.templates["Pat:We_stopped"] % other)
+
+        watch = self.create_watch(watchpats, self.Env["DeadTime"]+10)
+        watch.setwatch()
+        for other in others:
+            self.CM.StopaCMnoBlock(other)
+        if not watch.lookforall():
+            self.logger.log("Patterns not found: " + repr(watch.unmatched))
+            return self.failure("Could not stop nodes other than %s" % node)
+        for other in others:
+            self.rsh(other, self.templates["StopCmd"])
+
+        #     Change the CIB while they are down, so they must all sync it
+        expected = str(int(time.time()))
+        if self.rsh(node, "crm_attribute --type crm_config --name %s --update %s"
+                    % (self.marker, expected)) != 0:
+            return self.failure("Could not update CIB on %s" % node)
+
+        #     Let every peer request a sync from the survivor at once
+        self.set_timer()
+        if not self.startall(None):
+            return self.failure("Startall failed")
+
+        (generation, value) = self.cib_state(node)
+        failed = []
+        for other in others:
+            (other_generation, other_value) = self.cib_state(other)
+            if other_value != expected or other_generation != generation:
+                self.debug("CIB on %s is %s with %s=%s, expected %s with %s"
+                           % (other, other_generation, self.marker, other_value,
+                              generation, expected))
+                failed.append(other)
+
+        self.rsh(node, "crm_attribute --type crm_config --name %s --delete"
+                 % self.marker)
+
+        if len(failed) > 0:
+            return self.failure("Nodes did not get the current CIB: " + repr(failed))
+        return self.success()
+
+    def is_applicable(self):
+        '''SimulRejoin needs at least two nodes to rejoin together'''
+        return self.is_applicable_common() and len(self.Env["nodes"]) > 2
+
+#     Register SimulRejoin as a good test to run
+AllTestClasses.append(SimulRejoin)
+
+
+class LargeIPCPayload(CTSTest):
+    '''Store and read back a CIB that cannot fit in an IPC buffer'''
+    def __init__(self, cm):
+        CTSTest.__init__(self,cm)
+        self.name = "LargeIPCPayload"
+        self.startall = SimulStartLite(cm)
+        self.marker = "cts-large-ipc"
+        self.value_file = "/tmp/%s.value" % self.marker
+        self.xml_file = "/tmp/%s.xml" % self.marker
+
+        # Random data barely compresses, so this is far above the buffer size
+        self.size = 1024 * 1024
+
+    def query_digest(self, node):
+        '''Return a digest of the large value as a node's CIB manager reports it'''
+        (rc, lines) = self.rsh(node, "crm_attribute --type crm_config --name %s --query --quiet | md5sum"
+                               % self.marker, None)
+        if rc != 0 or len(lines) == 0:
+            return None
+        return lines[0].split()[0]
+
+    def leftover_payloads(self, node):
+        '''Return the number of shared memory IPC payloads left on a node'''
+        (rc, lines) = self.rsh(node, "ls /dev/shm/pcmk-ipc-* 2>/dev/null | wc -l", None)
+        if rc != 0 or len(lines) == 0:
+            return 0
+        return int(lines[0])
+
+    def __call__(self, node):
+        '''Perform the 'LargeIPCPayload' test. '''
+        self.incr("calls")
+
+        ret = self.startall(None)
+        if not ret:
+            return self.failure("Setup failed")
+
+        self.rsh(node, "head -c %d /dev/urandom | base64 -w 0 > %s"
+                 % (self.size, self.value_file))
+        self.rsh(node, "(printf \"<cluster_property_set id=\\\"%s\\\"><nvpair id=\\\"%s-value\\\" name=\\\"%s\\\" value=\\\"\";"
+                 " cat %s; printf \"\\\"/></cluster_property_set>\") > %s"
+                 % (self.marker, self.marker, self.marker, self.value_file, self.xml_file))
+        (rc, lines) = self.rsh(node, "(cat %s; echo) | md5sum" % self.value_file, None)
+        if rc != 0 or len(lines) == 0:
+            return self.failure("Could not create large value on %s" % node)
+        expected = lines[0].split()[0]
+
+        #     Both the request and the peer notifications exceed the buffer
+        self.set_timer()
+        rc = self.rsh(node, "cibadmin --create --scope crm_config --xml-file %s" % self.xml_file)
+        self.log_timer()
+        self.rsh(node, "rm -f %s %s" % (self.value_file, self.xml_file))
+        if rc != 0:
+            return self.failure("Could not store large value on %s: %d" % (node, rc))
+
+        #     So do the resulting scheduler input and every query reply
+        self.CM.cluster_stable()
+        failed = []
+        for other in self.Env["nodes"]:
+            if self.CM.ShouldBeStatus[other] == "up" and self.query_digest(other) != expected:
+                failed.append(other)
+
+        self.rsh(node, "cibadmin --delete --xml-text \"<cluster_property_set id=\\\"%s\\\"/>\""
+                 % self.marker)
+        if len(failed) > 0:
+            return self.failure("Large value not read back intact on " + repr(failed))
+
+        #     Every payload must have been removed by its reader or sender
+        self.CM.cluster_stable()
+        for other in self.Env["nodes"]:
+            left = self.leftover_payloads(other)
+            if left > 0:
+                failed.append(other)
+                self.debug("%d shared memory IPC payloads left on %s" % (left, other))
+        if len(failed) > 0:
+            return self.failure("Shared memory IPC payloads left on " + repr(failed))
+
+        return self.success()
+
+#     Register LargeIPCPayload as a good test to run
+AllTestClasses.append(LargeIPCPayload)
+
+
+class CIBNotifyFilter(CTSTest):
+    '''Check that diff notification filters suppress unrelated changes'''
+    def __init__(self, cm):
+        CTSTest.__init__(self,cm)
+        self.name = "CIBNotifyFilter"
+        self.startall = SimulStartLite(cm)
+        self.helper = CTSvars.CRM_DAEMON_DIR + "/cts-cib-helper"
+
+    def __call__(self, node):
+        '''Perform the 'CIBNotifyFilter' test. '''
+        self.incr("calls")
+
+        ret = self.startall(None)
+        if not ret:
+            return self.failure("Setup failed")
+
+        self.set_timer()
+        rc = self.rsh(node, self.helper)
+        self.log_timer()
+        if rc != 0:
+            return self.failure("Diff notification filter checks failed on %s: %d" % (node, rc))
+
+        return self.success()
+
+#     Register CIBNotifyFilter as a good test to run
+AllTestClasses.append(CIBNotifyFilter)
+
+
 class StopOnebyOne(CTSTest):
     '''Stop all the nodes in order'''
     def __init__(self, cm):
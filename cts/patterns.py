@@ -185,6 +185,8 @@ class crm_corosync(BasePatterns):
             r"Receiving messages from a node we think is dead",
             r"share the same cluster nodeid",
             r"share the same name",
+            # The controller's incremental scheduler input should always apply
+            r"pacemaker-schedulerd.*Requesting full input from .*: could not apply changes",
 
             #r"crm_ipc_send:.*Request .* failed",
             #r"crm_ipc_send:.*Sending to .* is disabled until pending reply is received",
@@ -227,7 +227,10 @@ attrd_cib_init()
     attrd_erase_attrs();
 
     // Set a trigger for reading the CIB (for the alerts section)
-    attrd_config_read = mainloop_add_trigger(G_PRIORITY_HIGH, attrd_read_options, NULL);
+    attrd_config_read = pcmk__mainloop_add_named_trigger("attrd-config",
+                                                         G_PRIORITY_HIGH,
+                                                         attrd_read_options,
+                                                         NULL);
 
     // Always read the CIB at start-up
     mainloop_set_trigger(attrd_config_read);
@@ -248,6 +251,11 @@ attrd_ipc_dispatch(qb_ipcs_connection_t * c, void *data, size_t size)
         crm_debug("No msg from %d (%p)", crm_ipcs_client_pid(c), c);
         return 0;
     }
+
+    if (pcmk__ipc_handle_stats_request(client, xml, id, flags)) {
+        free_xml(xml);
+        return 0;
+    }
 #if ENABLE_ACL
     CRM_ASSERT(client->user != NULL);
     crm_acl_get_set_user(xml, F_ATTRD_USER, client->user);
@@ -26,6 +26,7 @@
 
 #include <crm/common/xml.h>
 #include <crm/common/remote_internal.h>
+#include <crm/common/trace_internal.h>
 
 #include <pacemaker-based.h>
 
@@ -114,6 +115,7 @@ cib_ipc_closed(qb_ipcs_connection_t * c)
         return 0;
     }
     crm_trace("Connection %p", c);
+    cib_notify_set_filter(client, NULL);
     crm_client_destroy(client);
     return 0;
 }
@@ -165,6 +167,7 @@ cib_common_callback_worker(uint32_t id, uint32_t flags, xmlNode * op_request,
     } else if (crm_str_eq(op, T_CIB_NOTIFY, TRUE)) {
         /* Update the notify filters for this client */
         int on_off = 0;
+        int rc = pcmk_ok;
         long long bit = 0;
         const char *type = crm_element_value(op_request, F_CIB_NOTIFY_TYPE);
 
@@ -195,9 +198,24 @@ cib_common_callback_worker(uint32_t id, uint32_t flags, xmlNode * op_request,
             clear_bit(cib_client->options, bit);
         }
 
+        if (bit == cib_notify_diff) {
+            /* Each registration replaces any previous filter. A client with an
+             * invalid filter gets no diff notifications at all, rather than
+             * unfiltered ones it does not expect.
+             */
+            rc = cib_notify_set_filter(cib_client, on_off?
+                                       crm_element_value(op_request,
+                                                         F_CIB_NOTIFY_FILTER)
+                                       : NULL);
+            if (rc != pcmk_ok) {
+                clear_bit(cib_client->options, bit);
+            }
+        }
+
         if (flags & crm_ipc_client_response) {
-            /* TODO - include rc */
-            crm_ipcs_send_ack(cib_client, id, flags, "ack", __FUNCTION__, __LINE__);
+            crm_ipcs_send_ack(cib_client, id, flags,
+                              ((rc == pcmk_ok)? "ack" : "nack"),
+                              __FUNCTION__, __LINE__);
         }
         return;
     }
@@ -226,6 +244,11 @@ cib_common_callback(qb_ipcs_connection_t * c, void *data, size_t size, gboolean
     } else if(cib_client == NULL) {
         crm_trace("Invalid client %p", c);
         return 0;
+
+    } else if (pcmk__ipc_handle_stats_request(cib_client, op_request, id,
+                                              flags)) {
+        free_xml(op_request);
+        return 0;
     }
 
     if (is_set(call_options, cib_sync_call)) {
@@ -314,6 +337,8 @@ process_ping_reply(xmlNode *reply)
     const char *seq_s = crm_element_value(pong, F_CIB_PING_ID);
     const char *digest = crm_element_value(pong, XML_ATTR_DIGEST);
 
+    cib_sync_batch_peer_seen(host, pong);
+
     if (seq_s) {
         seq = crm_int_helper(seq_s, NULL);
     }
@@ -683,6 +708,14 @@ parse_peer_options_v2(int call_type, xmlNode * request,
     gboolean is_reply = safe_str_eq(reply_to, cib_our_uname);
 
     if(safe_str_eq(op, CIB_OP_REPLACE)) {
+        const char *sync_hosts = crm_element_value(request, F_CIB_SYNC_HOSTS);
+
+        if (sync_hosts && !cib_sync_host_listed(sync_hosts, cib_our_uname)) {
+            crm_trace("Ignoring CIB sync from %s for %s",
+                      originator, sync_hosts);
+            return FALSE;
+        }
+
         /* sync_our_cib() sets F_CIB_ISREPLY */
         if (reply_to) {
             delegated = reply_to;
@@ -1019,8 +1052,12 @@ cib_process_request(xmlNode *request, gboolean force_synchronous,
         time_t now = time(NULL);
         int level = LOG_INFO;
         const char *section = crm_element_value(request, F_CIB_SECTION);
+        uint32_t trace_call_id = (uint32_t) crm_parse_int(call_id, "0");
 
+        pcmk__trace(pcmk__trace_cib_op_start, trace_call_id, call_type,
+                    call_options);
         rc = cib_process_command(request, &op_reply, &result_diff, privileged);
+        pcmk__trace(pcmk__trace_cib_op_done, trace_call_id, call_type, rc);
 
         if (is_update == FALSE) {
             level = LOG_TRACE;
@@ -1522,6 +1559,7 @@ terminate_cib(const char *caller, int fast)
     }
 
     uninitializeCib();
+    cib_sync_batch_cleanup();
 
     if (fast > 0) {
         /* Quit fast on error */
@@ -30,6 +30,9 @@
 /* Maximum number of diffs to ignore while waiting for a resync */
 #define MAX_DIFF_RETRY 5
 
+/* How long to collect peer sync requests before answering them all at once */
+#define CIB_SYNC_BATCH_MS 500
+
 gboolean cib_is_master = FALSE;
 
 xmlNode *the_cib = NULL;
@@ -143,6 +146,7 @@ send_sync_request(const char *host)
     crm_xml_add(sync_me, F_TYPE, "cib");
     crm_xml_add(sync_me, F_CIB_OPERATION, CIB_OP_SYNC_ONE);
     crm_xml_add(sync_me, F_CIB_DELEGATED, cib_our_uname);
+    crm_xml_add(sync_me, F_CIB_SYNC_BATCH, XML_BOOLEAN_TRUE);
 
     send_cluster_message(host ? crm_get_peer(0, host) : NULL, crm_msg_cib, sync_me, FALSE);
     free_xml(sync_me);
@@ -164,6 +168,7 @@ cib_process_ping(const char *op, int options, const char *section, xmlNode * req
     crm_xml_add(*answer, XML_ATTR_CRM_VERSION, CRM_FEATURE_SET);
     crm_xml_add(*answer, XML_ATTR_DIGEST, digest);
     crm_xml_add(*answer, F_CIB_PING_ID, seq);
+    crm_xml_add(*answer, F_CIB_SYNC_BATCH, XML_BOOLEAN_TRUE);
 
     if (cs == NULL) {
         cs = qb_log_callsite_get(__func__, __FILE__, __FUNCTION__, LOG_TRACE, __LINE__, crm_trace_nonlog);
@@ -482,6 +487,266 @@ cib_process_delete_absolute(const char *op, int options, const char *section, xm
     return result;
 }
 
+/* Peers waiting for a batched sync, and the timer that will send it */
+static GHashTable *sync_batch_hosts = NULL;
+static mainloop_timer_t *sync_batch_timer = NULL;
+
+/* Peers known to understand F_CIB_SYNC_HOSTS (and so to ignore batched syncs
+ * meant for others), learned from their sync requests and ping replies
+ */
+static GHashTable *sync_batch_peers = NULL;
+
+/*!
+ * \internal
+ * \brief Check whether a node is named in a batched sync's host list
+ *
+ * \param[in] hosts  Space-separated list of node names
+ * \param[in] node   Node name to look for
+ *
+ * \return TRUE if \p node is in \p hosts, otherwise FALSE
+ */
+gboolean
+cib_sync_host_listed(const char *hosts, const char *node)
+{
+    size_t len = 0;
+    const char *match = hosts;
+
+    if ((hosts == NULL) || (node == NULL)) {
+        return FALSE;
+    }
+
+    len = strlen(node);
+    while ((match = strstr(match, node)) != NULL) {
+        if (((match == hosts) || (match[-1] == ' '))
+            && ((match[len] == '\0') || (match[len] == ' '))) {
+            return TRUE;
+        }
+        match += len;
+    }
+    return FALSE;
+}
+
+/*!
+ * \internal
+ * \brief Remember whether a peer supports batched syncs
+ *
+ * \param[in] node  Name of peer that sent \p msg
+ * \param[in] msg   Sync request or ping reply from \p node
+ */
+void
+cib_sync_batch_peer_seen(const char *node, xmlNode *msg)
+{
+    if ((node == NULL) || safe_str_eq(node, cib_our_uname)) {
+        return;
+    }
+    if (crm_is_true(crm_element_value(msg, F_CIB_SYNC_BATCH))) {
+        if (sync_batch_peers == NULL) {
+            sync_batch_peers = g_hash_table_new_full(crm_str_hash, g_str_equal,
+                                                     free, NULL);
+        }
+        g_hash_table_replace(sync_batch_peers, strdup(node), NULL);
+
+    } else if (sync_batch_peers != NULL) {
+        g_hash_table_remove(sync_batch_peers, node);
+    }
+}
+
+/*!
+ * \internal
+ * \brief Forget what is known about a peer that has left
+ *
+ * \param[in] node  Name of peer (which may rejoin running another version)
+ */
+void
+cib_sync_batch_peer_lost(const char *node)
+{
+    if ((node != NULL) && (sync_batch_peers != NULL)) {
+        g_hash_table_remove(sync_batch_peers, node);
+    }
+}
+
+/*!
+ * \internal
+ * \brief Check whether a batched sync may be multicast
+ *
+ * \return TRUE if every active peer is known to apply a batched sync only if
+ *         it is listed as a target, otherwise FALSE
+ */
+static gboolean
+sync_batch_supported(void)
+{
+    GHashTableIter iter;
+    crm_node_t *node = NULL;
+
+    if (crm_peer_cache == NULL) {
+        return FALSE;
+    }
+    g_hash_table_iter_init(&iter, crm_peer_cache);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &node)) {
+        if (!crm_is_peer_active(node) || (node->uname == NULL)
+            || safe_str_eq(node->uname, cib_our_uname)) {
+            continue;
+        }
+        if ((sync_batch_peers == NULL)
+            || !g_hash_table_contains(sync_batch_peers, node->uname)) {
+            crm_trace("Not batching CIB syncs because %s might not support it",
+                      node->uname);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*!
+ * \internal
+ * \brief Send a copy of our CIB to peers that requested a sync
+ *
+ * \param[in] hosts    Space-separated list of peers to sync
+ * \param[in] n_hosts  Number of peers in \p hosts
+ *
+ * \return TRUE if message was sent, otherwise FALSE
+ * \note A single peer is addressed directly, exactly as without batching.
+ *       Multiple peers share one multicast, which must be sent only if
+ *       sync_batch_supported() is TRUE, so that every peer applies it only if
+ *       it is listed as a target.
+ */
+static gboolean
+send_sync_replace(const char *hosts, guint n_hosts)
+{
+    gboolean sent = FALSE;
+    char *digest = NULL;
+    xmlNode *replace_request = create_xml_node(NULL, "sync-batch");
+
+    crm_debug("Syncing CIB to %u peer%s: %s",
+              n_hosts, ((n_hosts == 1)? "" : "s"), hosts);
+
+    crm_xml_add(replace_request, F_TYPE, T_CIB);
+    crm_xml_add(replace_request, F_CIB_OPERATION, CIB_OP_REPLACE);
+    crm_xml_add(replace_request, "original_" F_CIB_OPERATION, CIB_OP_SYNC_ONE);
+    crm_xml_add(replace_request, F_CIB_GLOBAL_UPDATE, XML_BOOLEAN_TRUE);
+    if (n_hosts == 1) {
+        crm_xml_add(replace_request, F_CIB_ISREPLY, hosts);
+    } else {
+        crm_xml_add(replace_request, F_CIB_SYNC_HOSTS, hosts);
+    }
+
+    crm_xml_add(replace_request, XML_ATTR_CRM_VERSION, CRM_FEATURE_SET);
+    digest = calculate_xml_versioned_digest(the_cib, FALSE, TRUE, CRM_FEATURE_SET);
+    crm_xml_add(replace_request, XML_ATTR_DIGEST, digest);
+
+    add_message_xml(replace_request, F_CIB_CALLDATA, the_cib);
+
+    sent = send_cluster_message(((n_hosts == 1)? crm_get_peer(0, hosts) : NULL),
+                                crm_msg_cib, replace_request, FALSE);
+    if (sent == FALSE) {
+        crm_warn("Could not sync CIB to %s", hosts);
+    }
+    free_xml(replace_request);
+    free(digest);
+    return sent;
+}
+
+/*!
+ * \internal
+ * \brief Send one copy of our CIB to all peers waiting for a sync
+ *
+ * Peers that request a sync within a short window of each other (typically
+ * all the nodes rejoining after a membership change) share one multicast,
+ * so the CIB is serialized, compressed and sent only once. If any active
+ * peer might not understand that, each waiting peer is synced directly.
+ */
+static gboolean
+send_sync_batch(gpointer user_data)
+{
+    GHashTableIter iter;
+    const char *host = NULL;
+    guint n_hosts = 0;
+
+    if (sync_batch_hosts != NULL) {
+        n_hosts = g_hash_table_size(sync_batch_hosts);
+    }
+    if ((the_cib == NULL) || (n_hosts == 0)) {
+        return FALSE;
+    }
+
+    if ((n_hosts == 1) || !sync_batch_supported()) {
+        g_hash_table_iter_init(&iter, sync_batch_hosts);
+        while (g_hash_table_iter_next(&iter, (gpointer *) &host, NULL)) {
+            send_sync_replace(host, 1);
+        }
+
+    } else {
+        GString *hosts = g_string_sized_new(64);
+
+        g_hash_table_iter_init(&iter, sync_batch_hosts);
+        while (g_hash_table_iter_next(&iter, (gpointer *) &host, NULL)) {
+            if (hosts->len > 0) {
+                g_string_append_c(hosts, ' ');
+            }
+            g_string_append(hosts, host);
+        }
+        send_sync_replace(hosts->str, n_hosts);
+        g_string_free(hosts, TRUE);
+    }
+    g_hash_table_remove_all(sync_batch_hosts);
+    return FALSE;
+}
+
+/*!
+ * \internal
+ * \brief Answer a peer's sync request, batching it with others if possible
+ *
+ * A request that arrives while no batch is being collected is answered right
+ * away, and opens a short window during which further requests are collected
+ * into one batch. Batching is used only if all active peers support it.
+ *
+ * \param[in] host  Name of peer that requested a sync
+ */
+static void
+queue_sync_host(const char *host)
+{
+    if (sync_batch_hosts == NULL) {
+        sync_batch_hosts = g_hash_table_new_full(crm_str_hash, g_str_equal,
+                                                 free, NULL);
+        sync_batch_timer = mainloop_timer_add("cib-sync-batch",
+                                              CIB_SYNC_BATCH_MS, FALSE,
+                                              send_sync_batch, NULL);
+    }
+
+    if (!sync_batch_supported()) {
+        send_sync_replace(host, 1);
+
+    } else if (mainloop_timer_running(sync_batch_timer) == FALSE) {
+        send_sync_replace(host, 1);
+        mainloop_timer_start(sync_batch_timer);
+
+    } else {
+        crm_trace("Queueing CIB sync for %s", host);
+        g_hash_table_replace(sync_batch_hosts, strdup(host), NULL);
+    }
+}
+
+/*!
+ * \internal
+ * \brief Free batched sync resources (dropping any waiting syncs)
+ */
+void
+cib_sync_batch_cleanup(void)
+{
+    if (sync_batch_timer != NULL) {
+        mainloop_timer_del(sync_batch_timer);
+        sync_batch_timer = NULL;
+    }
+    if (sync_batch_hosts != NULL) {
+        g_hash_table_destroy(sync_batch_hosts);
+        sync_batch_hosts = NULL;
+    }
+    if (sync_batch_peers != NULL) {
+        g_hash_table_destroy(sync_batch_peers);
+        sync_batch_peers = NULL;
+    }
+}
+
 int
 sync_our_cib(xmlNode * request, gboolean all)
 {
@@ -490,7 +755,21 @@ sync_our_cib(xmlNode * request, gboolean all)
     const char *host = crm_element_value(request, F_ORIG);
     const char *op = crm_element_value(request, F_CIB_OPERATION);
 
-    xmlNode *replace_request = cib_msg_copy(request, FALSE);
+    xmlNode *replace_request = NULL;
+
+    /* Syncs requested by peers rather than clients need no reply routing,
+     * so they can share one multicast with other peers' requests
+     */
+    if ((all == FALSE) && (host != NULL) && !cib_legacy_mode()
+        && (crm_element_value(request, F_CIB_CLIENTID) == NULL)) {
+        if (safe_str_eq(op, CIB_OP_SYNC_ONE)) {
+            cib_sync_batch_peer_seen(host, request);
+        }
+        queue_sync_host(host);
+        return pcmk_ok;
+    }
+
+    replace_request = cib_msg_copy(request, FALSE);
 
     CRM_CHECK(the_cib != NULL,;);
     CRM_CHECK(replace_request != NULL,;);
@@ -28,10 +28,16 @@
 
 int pending_updates = 0;
 
+/* XPath filters for diff notifications, keyed by client ID */
+static GHashTable *notify_filters = NULL;
+
 struct cib_notification_s {
     xmlNode *msg;
     struct iovec *iov;
     int32_t iov_size;
+
+    /* Filtered copies of this notification, keyed by XPath */
+    GHashTable *filtered;
 };
 
 void attach_cib_generation(xmlNode * msg, const char *field, xmlNode * a_cib);
@@ -39,6 +45,228 @@ void attach_cib_generation(xmlNode * msg, const char *field, xmlNode * a_cib);
 void do_cib_notify(int options, const char *op, xmlNode * update,
                    int result, xmlNode * result_data, const char *msg_type);
 
+/*!
+ * \internal
+ * \brief Set (or clear) the diff notification filter for a client
+ *
+ * \param[in] client  Client that registered for diff notifications
+ * \param[in] xpath   Only send changes within elements matching this XPath
+ *                    (or NULL to send all changes)
+ *
+ * \return pcmk_ok on success, or -EINVAL if \p xpath is invalid (in which case
+ *         any previous filter is cleared)
+ */
+int
+cib_notify_set_filter(crm_client_t *client, const char *xpath)
+{
+    xmlXPathCompExprPtr compiled = NULL;
+
+    CRM_CHECK((client != NULL) && (client->id != NULL), return -EINVAL);
+
+    if (notify_filters != NULL) {
+        g_hash_table_remove(notify_filters, client->id);
+    }
+    if (xpath == NULL) {
+        return pcmk_ok;
+    }
+
+    compiled = xmlXPathCompile((const xmlChar *) xpath);
+    if (compiled == NULL) {
+        crm_warn("Rejecting invalid diff notification filter '%s' from %s",
+                 xpath, crm_client_name(client));
+        return -EINVAL;
+    }
+    xmlXPathFreeCompExpr(compiled);
+
+    if (notify_filters == NULL) {
+        notify_filters = crm_str_table_new();
+    }
+    crm_debug("Filtering diff notifications for %s (%s) with %s",
+              crm_client_name(client), client->id, xpath);
+    g_hash_table_replace(notify_filters, strdup(client->id), strdup(xpath));
+    return pcmk_ok;
+}
+
+/*!
+ * \internal
+ * \brief Check whether one CIB path is at or below another
+ *
+ * \param[in] path      Path to check
+ * \param[in] ancestor  Path of possible ancestor
+ *
+ * \return TRUE if \p path is \p ancestor or a descendent of it
+ */
+static gboolean
+path_is_within(const char *path, const char *ancestor)
+{
+    size_t len = strlen(ancestor);
+
+    return (strncmp(path, ancestor, len) == 0)
+           && ((path[len] == '\0') || (path[len] == '/'));
+}
+
+static gboolean
+change_matches_filter(xmlNode *change, GList *paths)
+{
+    GList *iter = NULL;
+    char *path = NULL;
+    gboolean match = FALSE;
+    gboolean created = FALSE;
+    const char *op = crm_element_value(change, XML_DIFF_OP);
+    const char *change_path = crm_element_value(change, XML_DIFF_PATH);
+
+    if (change_path == NULL) {
+        return FALSE;
+    }
+
+    /* A creation's path is that of the parent, so use the path of the
+     * created element instead, in case the filter matches a sibling
+     */
+    if (safe_str_eq(op, "create") && (__xml_first_child(change) != NULL)) {
+        xmlNode *child = __xml_first_child(change);
+
+        created = TRUE;
+        if (ID(child)) {
+            path = crm_strdup_printf("%s/%s[@id='%s']", change_path,
+                                     crm_element_name(child), ID(child));
+        } else {
+            path = crm_strdup_printf("%s/%s", change_path,
+                                     crm_element_name(child));
+        }
+    } else {
+        path = strdup(change_path);
+    }
+
+    for (iter = paths; (iter != NULL) && !match; iter = iter->next) {
+        match = path_is_within(path, iter->data)
+                || (created && path_is_within(iter->data, path));
+    }
+    free(path);
+    return match;
+}
+
+/*!
+ * \internal
+ * \brief Create a copy of a diff notification with only relevant changes
+ *
+ * \param[in] msg    Diff notification to filter
+ * \param[in] xpath  XPath of elements whose changes are of interest
+ *
+ * \return Newly allocated notification (or NULL if no changes are relevant)
+ * \note Elements are matched against the resulting CIB, so the deletion of
+ *       an element matched by \p xpath is only reported if an ancestor of it
+ *       is also matched. Legacy (v1) diffs are not filtered.
+ */
+static xmlNode *
+filter_diff_notification(xmlNode *msg, const char *xpath)
+{
+    int lpc = 0;
+    int max = 0;
+    int format = 1;
+    int matches = 0;
+    GList *paths = NULL;
+    xmlNode *copy = copy_xml(msg);
+    xmlNode *diff = get_message_xml(copy, F_CIB_UPDATE_RESULT);
+    xmlNode *change = NULL;
+    xmlXPathObjectPtr xpathObj = NULL;
+
+    if (diff != NULL) {
+        crm_element_value_int(diff, "format", &format);
+    }
+    if (format != 2) {
+        return copy;
+    }
+
+    xpathObj = xpath_search(the_cib, xpath);
+    max = numXpathResults(xpathObj);
+    for (lpc = 0; lpc < max; lpc++) {
+        char *path = xml_get_path(getXpathResult(xpathObj, lpc));
+
+        if (path != NULL) {
+            paths = g_list_prepend(paths, path);
+        }
+    }
+    freeXpathObject(xpathObj);
+
+    change = __xml_first_child(diff);
+    while (change != NULL) {
+        xmlNode *next = __xml_next(change);
+
+        if (crm_str_eq(crm_element_name(change), XML_DIFF_CHANGE, TRUE)) {
+            if (change_matches_filter(change, paths)) {
+                matches++;
+            } else {
+                free_xml(change);
+            }
+        }
+        change = next;
+    }
+    g_list_free_full(paths, free);
+
+    if (matches == 0) {
+        free_xml(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+static void
+free_filtered_notification(gpointer data)
+{
+    struct cib_notification_s *filtered = data;
+
+    free_xml(filtered->msg);
+    pcmk_free_ipc_event(filtered->iov);
+    free(filtered);
+}
+
+/*!
+ * \internal
+ * \brief Get a filtered copy of a notification, creating it if needed
+ *
+ * \param[in] update  Full notification
+ * \param[in] xpath   Diff notification filter
+ *
+ * \return Filtered notification (whose msg is NULL if there is nothing
+ *         to send to clients with this filter)
+ * \note The result is shared by all clients with the same filter.
+ */
+static struct cib_notification_s *
+filtered_notification(struct cib_notification_s *update, const char *xpath)
+{
+    struct cib_notification_s *filtered = NULL;
+
+    if (update->filtered == NULL) {
+        update->filtered = g_hash_table_new_full(crm_str_hash, g_str_equal,
+                                                 free,
+                                                 free_filtered_notification);
+    } else {
+        filtered = g_hash_table_lookup(update->filtered, xpath);
+        if (filtered != NULL) {
+            return filtered;
+        }
+    }
+
+    filtered = calloc(1, sizeof(struct cib_notification_s));
+    CRM_ASSERT(filtered != NULL);
+    filtered->msg = filter_diff_notification(update->msg, xpath);
+
+    if (filtered->msg != NULL) {
+        ssize_t rc = crm_ipc_prepare(0, filtered->msg, &(filtered->iov), 0);
+
+        if (rc > 0) {
+            filtered->iov_size = rc;
+        } else {
+            crm_notice("Could not prepare filtered notification: %s "
+                       CRM_XS " rc=%lld", pcmk_strerror(rc), (long long) rc);
+            free_xml(filtered->msg);
+            filtered->msg = NULL;
+        }
+    }
+    g_hash_table_insert(update->filtered, strdup(xpath), filtered);
+    return filtered;
+}
+
 static gboolean
 cib_notify_send_one(gpointer key, gpointer value, gpointer user_data)
 {
@@ -77,6 +305,21 @@ cib_notify_send_one(gpointer key, gpointer value, gpointer user_data)
         do_send = TRUE;
     }
 
+    if (do_send && (notify_filters != NULL)
+        && safe_str_eq(type, T_CIB_DIFF_NOTIFY)) {
+
+        const char *xpath = g_hash_table_lookup(notify_filters, client->id);
+
+        if (xpath != NULL) {
+            update = filtered_notification(update, xpath);
+            if (update->msg == NULL) {
+                crm_trace("No changes of interest to %s/%s",
+                          client->name, client->id);
+                do_send = FALSE;
+            }
+        }
+    }
+
     if (do_send) {
         switch (client->kind) {
             case CRM_CLIENT_IPC:
@@ -111,7 +354,11 @@ cib_notify_send(xmlNode * xml)
         update.msg = xml;
         update.iov = iov;
         update.iov_size = rc;
+        update.filtered = NULL;
         g_hash_table_foreach_remove(client_connections, cib_notify_send_one, &update);
+        if (update.filtered != NULL) {
+            g_hash_table_destroy(update.filtered);
+        }
 
     } else {
         crm_notice("Could not notify clients: %s " CRM_XS " rc=%lld",
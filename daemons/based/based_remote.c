@@ -393,6 +393,7 @@ cib_remote_connection_destroy(gpointer user_data)
         close(csock);
     }
 
+    cib_notify_set_filter(client, NULL);
     crm_client_destroy(client);
 
     crm_trace("Freed the cib client");
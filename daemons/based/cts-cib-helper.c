@@ -0,0 +1,267 @@
+/*
+ * Copyright 2019 the Pacemaker project contributors
+ *
+ * The version control history for this file may have further details.
+ *
+ * This source code is licensed under the GNU General Public License version 2
+ * or later (GPLv2+) WITHOUT ANY WARRANTY.
+ */
+
+#include <crm_internal.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <crm/crm.h>
+#include <crm/msg_xml.h>
+#include <crm/common/xml.h>
+#include <crm/common/mainloop.h>
+#include <crm/cib/internal.h>
+
+/* Exercise diff notification filters against a running CIB manager: changes
+ * outside a client's filter must not be sent to it, and an invalid filter must
+ * be rejected without disturbing the one already in effect.
+ */
+
+#define NOTIFY_TIMEOUT_S    10
+
+#define WATCHED_ID  "cts-cib-helper-watched"
+#define OTHER_ID    "cts-cib-helper-other"
+#define FILTER      "//" XML_CIB_TAG_PROPSET "[@id='" WATCHED_ID "']"
+
+/* *INDENT-OFF* */
+static struct crm_option long_options[] = {
+    {"help",    0, 0, '?', "\tThis text"},
+    {"version", 0, 0, '$', "\tVersion information"},
+    {"verbose", 0, 0, 'V', "\tIncrease debug output"},
+
+    {0, 0, 0, 0}
+};
+/* *INDENT-ON* */
+
+static cib_t *cib = NULL;
+static GMainLoop *mainloop = NULL;
+static bool notified = FALSE;       // Whether a diff notification arrived
+static bool saw_watched = FALSE;    // Whether it included the watched set
+static bool saw_other = FALSE;      // Whether it included the other set
+
+/*!
+ * \internal
+ * \brief Create a cluster property set with a single option
+ *
+ * \param[in] id     ID of property set
+ * \param[in] value  Value of option
+ *
+ * \return Newly created property set (which the caller must free)
+ */
+static xmlNode *
+create_property_set(const char *id, int value)
+{
+    xmlNode *set = create_xml_node(NULL, XML_CIB_TAG_PROPSET);
+    xmlNode *nvpair = create_xml_node(set, XML_CIB_TAG_NVPAIR);
+
+    crm_xml_set_id(set, "%s", id);
+    crm_xml_set_id(nvpair, "%s-nvpair", id);
+    crm_xml_add(nvpair, XML_NVPAIR_ATTR_NAME, id);
+    crm_xml_add_int(nvpair, XML_NVPAIR_ATTR_VALUE, value);
+    return set;
+}
+
+/*!
+ * \internal
+ * \brief Create or change a cluster property set
+ *
+ * \param[in] id     ID of property set
+ * \param[in] value  Value of its option
+ * \param[in] new    Whether to create the set rather than change it
+ *
+ * \return Legacy Pacemaker return code
+ */
+static int
+update_property_set(const char *id, int value, bool new)
+{
+    xmlNode *set = create_property_set(id, value);
+    int rc = pcmk_ok;
+
+    if (new) {
+        rc = cib->cmds->create(cib, XML_CIB_TAG_CRMCONFIG, set, cib_sync_call);
+    } else {
+        rc = cib->cmds->modify(cib, XML_CIB_TAG_CRMCONFIG, set, cib_sync_call);
+    }
+    if (rc != pcmk_ok) {
+        crm_err("Could not update %s: %s " CRM_XS " rc=%d",
+                id, pcmk_strerror(rc), rc);
+    }
+    free_xml(set);
+    return rc;
+}
+
+/*!
+ * \internal
+ * \brief Remove a cluster property set
+ *
+ * \param[in] id  ID of property set
+ */
+static void
+remove_property_set(const char *id)
+{
+    xmlNode *set = create_xml_node(NULL, XML_CIB_TAG_PROPSET);
+
+    crm_xml_set_id(set, "%s", id);
+    cib->cmds->remove(cib, XML_CIB_TAG_CRMCONFIG, set, cib_sync_call);
+    free_xml(set);
+}
+
+/*!
+ * \internal
+ * \brief Record which property sets the first diff notification changed
+ *
+ * \param[in] event  Notification type
+ * \param[in] msg    Notification
+ */
+static void
+diff_notify(const char *event, xmlNode *msg)
+{
+    xmlNode *patchset = get_message_xml(msg, F_CIB_UPDATE_RESULT);
+
+    if (notified) {
+        return;
+    }
+    notified = TRUE;
+
+    for (xmlNode *change = __xml_first_child(patchset); change != NULL;
+         change = __xml_next(change)) {
+
+        const char *path = crm_element_value(change, XML_DIFF_PATH);
+
+        if (!crm_str_eq(crm_element_name(change), XML_DIFF_CHANGE, TRUE)
+            || (path == NULL)) {
+            continue;
+        }
+        crm_debug("Notified of %s to %s",
+                  crm_element_value(change, XML_DIFF_OP), path);
+        if (strstr(path, WATCHED_ID) != NULL) {
+            saw_watched = TRUE;
+        } else if (strstr(path, OTHER_ID) != NULL) {
+            saw_other = TRUE;
+        }
+    }
+    g_main_loop_quit(mainloop);
+}
+
+static gboolean
+notify_timeout(gpointer data)
+{
+    crm_err("No diff notification within %ds", NOTIFY_TIMEOUT_S);
+    g_main_loop_quit(mainloop);
+    return FALSE;
+}
+
+#define run_test(desc, test) do {                                   \
+        if (test) {                                                 \
+            crm_info("SUCCESS - %s", (desc));                       \
+        } else {                                                    \
+            crm_err("FAILURE - %s", (desc));                        \
+            rc = CRM_EX_ERROR;                                      \
+        }                                                           \
+    } while (0)
+
+int
+main(int argc, char **argv)
+{
+    int argerr = 0;
+    int flag;
+    int option_index = 0;
+    int rc = CRM_EX_OK;
+    int verbose = 0;
+    int cib_rc = pcmk_ok;
+
+    crm_log_cli_init("cts-cib-helper");
+    crm_set_options(NULL, "[options]", long_options,
+                    "Test diff notification filters"
+                    " against a running pacemaker-based");
+
+    while (1) {
+        flag = crm_get_option(argc, argv, &option_index);
+        if (flag == -1) {
+            break;
+        }
+
+        switch (flag) {
+            case 'V':
+                verbose = 1;
+                break;
+            case '$':
+            case '?':
+                crm_help(flag, CRM_EX_OK);
+                break;
+            default:
+                ++argerr;
+                break;
+        }
+    }
+
+    crm_log_init(NULL, LOG_INFO, TRUE, (verbose? TRUE : FALSE), argc, argv,
+                 FALSE);
+
+    if (optind < argc) {
+        ++argerr;
+    }
+    if (argerr) {
+        crm_help('?', CRM_EX_USAGE);
+    }
+
+    cib = cib_new();
+    cib_rc = cib->cmds->signon(cib, crm_system_name, cib_command);
+    if (cib_rc != pcmk_ok) {
+        crm_err("Could not connect to CIB manager: %s " CRM_XS " rc=%d",
+                pcmk_strerror(cib_rc), cib_rc);
+        cib_delete(cib);
+        crm_exit(CRM_EX_UNAVAILABLE);
+    }
+
+    // Start from a clean slate in case an earlier run was interrupted
+    remove_property_set(WATCHED_ID);
+    remove_property_set(OTHER_ID);
+    if ((update_property_set(WATCHED_ID, 0, TRUE) != pcmk_ok)
+        || (update_property_set(OTHER_ID, 0, TRUE) != pcmk_ok)) {
+        rc = CRM_EX_ERROR;
+        goto done;
+    }
+
+    run_test("Valid filter is accepted",
+             cib->cmds->set_notify_filter(cib, FILTER) == pcmk_ok);
+    run_test("Diff notifications can be registered for",
+             cib->cmds->add_notify_callback(cib, T_CIB_DIFF_NOTIFY,
+                                            diff_notify) == pcmk_ok);
+    run_test("Invalid filter is rejected",
+             cib->cmds->set_notify_filter(cib, "//[") == -EINVAL);
+
+    /* Change the other set first, so that if it is not filtered out, it is the
+     * first notification we get
+     */
+    if ((update_property_set(OTHER_ID, 1, FALSE) != pcmk_ok)
+        || (update_property_set(WATCHED_ID, 1, FALSE) != pcmk_ok)) {
+        rc = CRM_EX_ERROR;
+        goto done;
+    }
+
+    mainloop = g_main_loop_new(NULL, FALSE);
+    g_timeout_add_seconds(NOTIFY_TIMEOUT_S, notify_timeout, NULL);
+    g_main_loop_run(mainloop);
+    g_main_loop_unref(mainloop);
+
+    run_test("Change outside filter is not notified", notified && !saw_other);
+    run_test("Change inside filter is notified", saw_watched);
+
+done:
+    cib->cmds->del_notify_callback(cib, T_CIB_DIFF_NOTIFY, diff_notify);
+    remove_property_set(WATCHED_ID);
+    remove_property_set(OTHER_ID);
+    cib->cmds->signoff(cib);
+    cib_delete(cib);
+    crm_exit(rc);
+    return rc;
+}
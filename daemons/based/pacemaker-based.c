@@ -90,7 +90,8 @@ main(int argc, char **argv)
     mainloop_add_signal(SIGTERM, cib_shutdown);
     mainloop_add_signal(SIGPIPE, cib_enable_writes);
 
-    cib_writer = mainloop_add_trigger(G_PRIORITY_LOW, write_cib_contents, NULL);
+    cib_writer = pcmk__mainloop_add_named_trigger("cib-writer", G_PRIORITY_LOW,
+                                                  write_cib_contents, NULL);
 
     while (1) {
         flag = crm_get_option(argc, argv, &index);
@@ -267,6 +268,9 @@ cib_peer_update_callback(enum crm_status_type type, crm_node_t * node, const voi
 {
     switch (type) {
         case crm_status_processes:
+            if (is_not_set(node->processes, crm_get_cluster_proc())) {
+                cib_sync_batch_peer_lost(node->uname);
+            }
             if (cib_legacy_mode()
                 && is_not_set(node->processes, crm_get_cluster_proc())) {
 
@@ -282,6 +286,9 @@ cib_peer_update_callback(enum crm_status_type type, crm_node_t * node, const voi
 
         case crm_status_uname:
         case crm_status_nstate:
+            if (!crm_is_peer_active(node)) {
+                cib_sync_batch_peer_lost(node->uname);
+            }
             if (cib_shutdown_flag && (crm_active_peers() < 2)
                 && crm_hash_table_size(client_connections) == 0) {
 
@@ -130,6 +130,10 @@ int cib_process_upgrade_server(const char *op, int options, const char *section,
                                xmlNode *existing_cib, xmlNode **result_cib,
                                xmlNode **answer);
 void send_sync_request(const char *host);
+gboolean cib_sync_host_listed(const char *hosts, const char *node);
+void cib_sync_batch_peer_seen(const char *node, xmlNode *msg);
+void cib_sync_batch_peer_lost(const char *node);
+void cib_sync_batch_cleanup(void);
 
 xmlNode *cib_msg_copy(xmlNode *msg, gboolean with_data);
 xmlNode *cib_construct_reply(xmlNode *request, xmlNode *output, int rc);
@@ -147,6 +151,7 @@ void cib_diff_notify(int options, const char *client, const char *call_id,
                      xmlNode *old_cib);
 void cib_replace_notify(const char *origin, xmlNode *update, int result,
                         xmlNode *diff);
+int cib_notify_set_filter(crm_client_t *client, const char *xpath);
 
 static inline const char *
 cib_config_lookup(const char *opt)
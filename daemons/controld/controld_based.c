@@ -23,6 +23,7 @@ int cib_retries = 0;
 static void
 do_cib_updated(const char *event, xmlNode * msg)
 {
+    controld_sched_cib_updated(msg);
     if (crm_patchset_contains_alert(msg, TRUE)) {
         mainloop_set_trigger(config_read);
     }
@@ -340,9 +340,15 @@ do_startup(long long action,
     mainloop_add_signal(SIGTERM, crm_shutdown);
     mainloop_add_signal(SIGPIPE, sigpipe_ignore);
 
-    fsa_source = mainloop_add_trigger(G_PRIORITY_HIGH, crm_fsa_trigger, NULL);
-    config_read = mainloop_add_trigger(G_PRIORITY_HIGH, crm_read_options, NULL);
-    transition_trigger = mainloop_add_trigger(G_PRIORITY_LOW, te_graph_trigger, NULL);
+    fsa_source = pcmk__mainloop_add_named_trigger("fsa", G_PRIORITY_HIGH,
+                                                  crm_fsa_trigger, NULL);
+    config_read = pcmk__mainloop_add_named_trigger("config-read",
+                                                   G_PRIORITY_HIGH,
+                                                   crm_read_options, NULL);
+    transition_trigger = pcmk__mainloop_add_named_trigger("transition",
+                                                          G_PRIORITY_LOW,
+                                                          te_graph_trigger,
+                                                          NULL);
 
     crm_debug("Creating CIB manager and executor objects");
     fsa_cib_conn = cib_new();
@@ -379,6 +385,10 @@ crmd_ipc_dispatch(qb_ipcs_connection_t * c, void *data, size_t size)
     xmlNode *msg = crm_ipcs_recv(client, data, size, &id, &flags);
 
     crm_trace("Invoked: %s", crm_client_name(client));
+    if (pcmk__ipc_handle_stats_request(client, msg, id, flags)) {
+        free_xml(msg);
+        return 0;
+    }
     crm_ipcs_send_ack(client, id, flags, "ack", __FUNCTION__, __LINE__);
 
     if (msg == NULL) {
@@ -544,7 +554,7 @@ static pe_cluster_option crmd_opts[] = {
 	{ "load-threshold", NULL, "percentage", NULL, "80%", &check_utilization,
 	  "The maximum amount of system resources that should be used by nodes in the cluster",
 	  "The cluster will slow down its recovery process when the amount of system resources used"
-          " (currently CPU) approaches this limit",
+          " (CPU, and where the kernel reports it, CPU, I/O and memory pressure) approaches this limit",
         },
 	{ "node-action-limit", NULL, "integer", NULL, "0", &check_number,
           "The maximum number of jobs that can be scheduled per node. Defaults to 2x cores"},
@@ -580,6 +590,13 @@ static pe_cluster_option crmd_opts[] = {
         "*** Advanced Use Only *** Enabling this option will slow down cluster recovery under all conditions",
         "Delay cluster recovery for the configured interval to allow for additional/related events to occur.\n"
         "Useful if your configuration is sensitive to the order in which ping updates arrive."
+    },
+	{
+        "speculative-transitions", NULL, "boolean", NULL, "false", &check_boolean,
+        "*** Advanced Use Only *** Calculate the next transition while an aborted one finishes",
+        "After a transition is aborted, ask the scheduler for the next transition while in-flight actions "
+        "are still running, assuming they will succeed. The result is used if they do and their recorded results "
+        "match the prediction, and discarded otherwise."
     },
 	{ "stonith-watchdog-timeout", NULL, "time", NULL, NULL, &check_sbd_timeout,
 	  "How long to wait before we can assume nodes are safely down", NULL
@@ -692,6 +709,9 @@ config_query_callback(xmlNode * msg, int call_id, int rc, xmlNode * output, void
     value = crmd_pref(config_hash, "transition-delay");
     transition_timer->period_ms = crm_parse_interval_spec(value);
 
+    value = crmd_pref(config_hash, "speculative-transitions");
+    controld_sched_set_speculation(value);
+
     value = crmd_pref(config_hash, "join-integration-timeout");
     integration_timer->period_ms = crm_parse_interval_spec(value);
 
@@ -73,14 +73,6 @@ make_stop_id(const char *rsc, int call_id)
     return crm_strdup_printf("%s:%d", rsc, call_id);
 }
 
-static void
-copy_instance_keys(gpointer key, gpointer value, gpointer user_data)
-{
-    if (strstr(key, CRM_META "_") == NULL) {
-        g_hash_table_replace(user_data, strdup((const char *)key), strdup((const char *)value));
-    }
-}
-
 static void
 copy_meta_keys(gpointer key, gpointer value, gpointer user_data)
 {
@@ -104,14 +96,14 @@ history_remove_recurring_op(rsc_history_t *history, const lrmd_event_data_t *op)
     GList *iter;
 
     for (iter = history->recurring_op_list; iter != NULL; iter = iter->next) {
-        lrmd_event_data_t *existing = iter->data;
+        history_op_t *existing = iter->data;
 
         if ((op->interval_ms == existing->interval_ms)
-            && crm_str_eq(op->rsc_id, existing->rsc_id, TRUE)
+            && crm_str_eq(op->rsc_id, history->id, TRUE)
             && safe_str_eq(op->op_type, existing->op_type)) {
 
             history->recurring_op_list = g_list_delete_link(history->recurring_op_list, iter);
-            lrmd_free_event(existing);
+            history_op_free(existing);
             return TRUE;
         }
     }
@@ -127,12 +119,7 @@ history_remove_recurring_op(rsc_history_t *history, const lrmd_event_data_t *op)
 static void
 history_free_recurring_ops(rsc_history_t *history)
 {
-    GList *iter;
-
-    for (iter = history->recurring_op_list; iter != NULL; iter = iter->next) {
-        lrmd_free_event(iter->data);
-    }
-    g_list_free(history->recurring_op_list);
+    g_list_free_full(history->recurring_op_list, history_op_free);
     history->recurring_op_list = NULL;
 }
 
@@ -147,17 +134,13 @@ history_free(gpointer data)
 {
     rsc_history_t *history = (rsc_history_t*)data;
 
-    if (history->stop_params) {
-        g_hash_table_destroy(history->stop_params);
-    }
+    history_params_unref(history->stop_params);
 
-    /* Don't need to free history->rsc.id because it's set to history->id */
-    free(history->rsc.type);
-    free(history->rsc.standard);
-    free(history->rsc.provider);
-
-    lrmd_free_event(history->failed);
-    lrmd_free_event(history->last);
+    /* Don't need to free history->rsc.id because it's set to history->id, or
+     * the agent strings because they are interned
+     */
+    history_op_free(history->failed);
+    history_op_free(history->last);
     free(history->id);
     history_free_recurring_ops(history);
     free(history);
@@ -187,14 +170,11 @@ update_history_cache(lrm_state_t * lrm_state, lrmd_rsc_info_t * rsc, lrmd_event_
         entry->id = strdup(op->rsc_id);
         g_hash_table_insert(lrm_state->resource_history, entry->id, entry);
 
+        // Agent strings are shared by all instances of the same agent
         entry->rsc.id = entry->id;
-        entry->rsc.type = strdup(rsc->type);
-        entry->rsc.standard = strdup(rsc->standard);
-        if (rsc->provider) {
-            entry->rsc.provider = strdup(rsc->provider);
-        } else {
-            entry->rsc.provider = NULL;
-        }
+        entry->rsc.type = (char *) g_intern_string(rsc->type);
+        entry->rsc.standard = (char *) g_intern_string(rsc->standard);
+        entry->rsc.provider = (char *) g_intern_string(rsc->provider);
 
     } else if (entry == NULL) {
         crm_info("Resource %s no longer exists, not updating cache", op->rsc_id);
@@ -219,28 +199,21 @@ update_history_cache(lrm_state_t * lrm_state, lrmd_rsc_info_t * rsc, lrmd_event_
         /* Store failed monitors here, otherwise the block below will cause them
          * to be forgotten when a stop happens.
          */
-        if (entry->failed) {
-            lrmd_free_event(entry->failed);
-        }
-        entry->failed = lrmd_copy_event(op);
+        history_op_free(entry->failed);
+        entry->failed = history_op_new(op);
 
     } else if (op->interval_ms == 0) {
-        if (entry->last) {
-            lrmd_free_event(entry->last);
-        }
-        entry->last = lrmd_copy_event(op);
+        history_op_free(entry->last);
+        entry->last = history_op_new(op);
 
         if (op->params &&
             (safe_str_eq(CRMD_ACTION_START, op->op_type) ||
              safe_str_eq("reload", op->op_type) ||
              safe_str_eq(CRMD_ACTION_STATUS, op->op_type))) {
 
-            if (entry->stop_params) {
-                g_hash_table_destroy(entry->stop_params);
-            }
-            entry->stop_params = crm_str_table_new();
-
-            g_hash_table_foreach(op->params, copy_instance_keys, entry->stop_params);
+            // The interned instance attributes are shared, not copied
+            history_params_unref(entry->stop_params);
+            entry->stop_params = history_params_ref(entry->last->instance);
         }
     }
 
@@ -250,7 +223,7 @@ update_history_cache(lrm_state_t * lrm_state, lrmd_rsc_info_t * rsc, lrmd_event_
 
         crm_trace("Adding recurring op: " CRM_OP_FMT,
                   op->rsc_id, op->op_type, op->interval_ms);
-        entry->recurring_op_list = g_list_prepend(entry->recurring_op_list, lrmd_copy_event(op));
+        entry->recurring_op_list = g_list_prepend(entry->recurring_op_list, history_op_new(op));
 
     } else if (entry->recurring_op_list && safe_str_eq(op->op_type, RSC_STATUS) == FALSE) {
         crm_trace("Dropping %d recurring ops because of: " CRM_OP_FMT,
@@ -386,6 +359,7 @@ do_lrm_control(long long action,
 
         set_bit(fsa_input_register, R_LRM_CONNECTED);
         crm_info("Connection to the executor established");
+        controld_preload_metadata(lrm_state);
     }
 
     if (action & ~(A_LRM_CONNECT | A_LRM_DISCONNECT)) {
@@ -712,16 +686,22 @@ build_operation_update(xmlNode * parent, lrmd_rsc_info_t * rsc, lrmd_event_data_
          * Once that is working, this block will only be a fallback in case the
          * initial collection fails.
          */
-        char *metadata_str = NULL;
-
-        int rc = lrm_state_get_metadata(lrm_state, rsc->standard,
-                                        rsc->provider, rsc->type,
-                                        &metadata_str, 0);
-
-        if (rc != pcmk_ok) {
-            crm_warn("Failed to get metadata for %s (%s:%s:%s)",
-                     rsc->id, rsc->standard, rsc->provider, rsc->type);
-            return TRUE;
+        char *metadata_str = pcmk__cached_agent_metadata(rsc->standard,
+                                                         rsc->provider,
+                                                         rsc->type);
+
+        if (metadata_str == NULL) {
+            int rc = lrm_state_get_metadata(lrm_state, rsc->standard,
+                                            rsc->provider, rsc->type,
+                                            &metadata_str, 0);
+
+            if (rc != pcmk_ok) {
+                crm_warn("Failed to get metadata for %s (%s:%s:%s)",
+                         rsc->id, rsc->standard, rsc->provider, rsc->type);
+                return TRUE;
+            }
+            pcmk__cache_agent_metadata(rsc->standard, rsc->provider,
+                                       rsc->type, metadata_str);
         }
 
         metadata = metadata_cache_update(lrm_state->metadata_cache, rsc,
@@ -779,6 +759,31 @@ is_rsc_active(lrm_state_t * lrm_state, const char *rsc_id)
     return TRUE;
 }
 
+/*!
+ * \internal
+ * \brief Add an operation update for a remembered result to resource XML
+ *
+ * \param[in,out] parent     Resource XML to add update to
+ * \param[in]     entry      Resource history that result is from
+ * \param[in]     hop        Remembered result (may be NULL)
+ * \param[in]     node_name  Node that result is for
+ * \param[in]     src        Function name of caller
+ */
+static void
+build_history_update(xmlNode *parent, rsc_history_t *entry,
+                     const history_op_t *hop, const char *node_name,
+                     const char *src)
+{
+    lrmd_event_data_t *op = NULL;
+
+    if (hop == NULL) {
+        return;
+    }
+    op = history_op_event(hop, entry->id);
+    build_operation_update(parent, &(entry->rsc), op, node_name, src);
+    lrmd_free_event(op);
+}
+
 static gboolean
 build_active_RAs(lrm_state_t * lrm_state, xmlNode * rsc_list)
 {
@@ -796,17 +801,20 @@ build_active_RAs(lrm_state_t * lrm_state, xmlNode * rsc_list)
         crm_xml_add(xml_rsc, XML_AGENT_ATTR_CLASS, entry->rsc.standard);
         crm_xml_add(xml_rsc, XML_AGENT_ATTR_PROVIDER, entry->rsc.provider);
 
-        if (entry->last && entry->last->params) {
-            const char *container = g_hash_table_lookup(entry->last->params, CRM_META"_"XML_RSC_ATTR_CONTAINER);
+        if (entry->last) {
+            const char *container = history_params_value(entry->last->meta, CRM_META"_"XML_RSC_ATTR_CONTAINER);
             if (container) {
                 crm_trace("Resource %s is a part of container resource %s", entry->id, container);
                 crm_xml_add(xml_rsc, XML_RSC_ATTR_CONTAINER, container);
             }
         }
-        build_operation_update(xml_rsc, &(entry->rsc), entry->failed, lrm_state->node_name, __FUNCTION__);
-        build_operation_update(xml_rsc, &(entry->rsc), entry->last, lrm_state->node_name, __FUNCTION__);
+        build_history_update(xml_rsc, entry, entry->failed, lrm_state->node_name,
+                             __FUNCTION__);
+        build_history_update(xml_rsc, entry, entry->last, lrm_state->node_name,
+                             __FUNCTION__);
         for (gIter = entry->recurring_op_list; gIter != NULL; gIter = gIter->next) {
-            build_operation_update(xml_rsc, &(entry->rsc), gIter->data, lrm_state->node_name, __FUNCTION__);
+            build_history_update(xml_rsc, entry, gIter->data,
+                                 lrm_state->node_name, __FUNCTION__);
         }
     }
 
@@ -941,6 +949,9 @@ delete_rsc_status(lrm_state_t * lrm_state, const char *rsc_id, int call_options,
 
     rc = cib_internal_op(fsa_cib_conn, CIB_OP_DELETE, NULL, rsc_xpath,
                          NULL, NULL, call_options | cib_xpath, user_name);
+    if (is_not_set(call_options, cib_sync_call)) {
+        controld_track_cib_call(rc);
+    }
 
     free(rsc_xpath);
     return rc;
@@ -1007,8 +1018,10 @@ erase_lrm_history_by_op(lrm_state_t *lrm_state, lrmd_event_data_t *op)
     crm_debug("Erasing resource operation history for " CRM_OP_FMT " (call=%d)",
               op->rsc_id, op->op_type, op->interval_ms, op->call_id);
 
-    fsa_cib_conn->cmds->remove(fsa_cib_conn, XML_CIB_TAG_STATUS, xml_top,
-                               cib_quorum_override);
+    controld_track_cib_call(fsa_cib_conn->cmds->remove(fsa_cib_conn,
+                                                       XML_CIB_TAG_STATUS,
+                                                       xml_top,
+                                                       cib_quorum_override));
 
     crm_log_xml_trace(xml_top, "op:cancel");
     free_xml(xml_top);
@@ -1068,8 +1081,10 @@ erase_lrm_history_by_id(lrm_state_t *lrm_state, const char *rsc_id,
 
     crm_debug("Erasing resource operation history for %s on %s (call=%d)",
               key, rsc_id, call_id);
-    fsa_cib_conn->cmds->remove(fsa_cib_conn, op_xpath, NULL,
-                               cib_quorum_override | cib_xpath);
+    controld_track_cib_call(fsa_cib_conn->cmds->remove(fsa_cib_conn, op_xpath,
+                                                       NULL,
+                                                       cib_quorum_override
+                                                       | cib_xpath));
     free(op_xpath);
 }
 
@@ -1127,7 +1142,7 @@ lrm_clear_last_failure(const char *rsc_id, const char *node_name,
                                                    rsc_id);
 
         if (last_failed_matches_op(entry, operation, interval_ms)) {
-            lrmd_free_event(entry->failed);
+            history_op_free(entry->failed);
             entry->failed = NULL;
         }
     }
@@ -1556,6 +1571,7 @@ handle_refresh_op(lrm_state_t *lrm_state, const char *user_name,
 
     fsa_cib_update(XML_CIB_TAG_STATUS, fragment, cib_quorum_override, rc, user_name);
     crm_info("Forced a local resource history refresh: call=%d", rc);
+    controld_track_cib_call(rc);
 
     if (safe_str_neq(CRM_SYSTEM_CRMD, from_sys)) {
         xmlNode *reply = create_request(CRM_OP_INVOKE_LRM, fragment, from_host,
@@ -1999,7 +2015,7 @@ construct_op(lrm_state_t * lrm_state, xmlNode * rsc_op, const char *rsc_id, cons
             op->params = crm_str_table_new();
 
             g_hash_table_foreach(params, copy_meta_keys, op->params);
-            g_hash_table_foreach(entry->stop_params, copy_instance_keys, op->params);
+            history_params_copy(entry->stop_params, op->params);
             g_hash_table_destroy(params);
             params = NULL;
         }
@@ -2508,7 +2524,7 @@ did_lrm_rsc_op_fail(lrm_state_t *lrm_state, const char * rsc_id,
         return FALSE;
     }
 
-    if (crm_str_eq(entry->failed->rsc_id, rsc_id, TRUE)
+    if (crm_str_eq(entry->id, rsc_id, TRUE)
         && safe_str_eq(entry->failed->op_type, op_type)
         && entry->failed->interval_ms == interval_ms) {
         return TRUE;
@@ -2777,7 +2793,11 @@ process_lrm_event(lrm_state_t *lrm_state, lrmd_event_data_t *op,
         } else if (rsc && (op->rc == PCMK_OCF_OK)) {
             char *metadata = unescape_newlines(op->output);
 
-            metadata_cache_update(lrm_state->metadata_cache, rsc, metadata);
+            if (metadata_cache_update(lrm_state->metadata_cache, rsc,
+                                      metadata)) {
+                pcmk__cache_agent_metadata(rsc->standard, rsc->provider,
+                                           rsc->type, metadata);
+            }
             free(metadata);
         }
     }
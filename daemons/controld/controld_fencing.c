@@ -254,7 +254,7 @@ abort_for_stonith_failure(enum transition_action abort_action,
     if ((abort_action != tg_stop) && too_many_st_failures(target)) {
         abort_action = tg_stop;
     }
-    abort_transition(INFINITY, abort_action, "Stonith failed", reason);
+    abort_transition_urgent(INFINITY, abort_action, "Stonith failed", reason);
 }
 
 
@@ -540,7 +540,7 @@ tengine_stonith_notify(stonith_t *st, stonith_event_t *st_event)
                  * that invoked stonith to fence someone
                  */
                 crm_info("External fencing operation from %s fenced %s", st_event->client_origin, st_event->target);
-                abort_transition(INFINITY, tg_restart, "External Fencing Operation", NULL);
+                abort_transition_urgent(INFINITY, tg_restart, "External Fencing Operation", NULL);
             }
 
             /* Assume it was our leader if we don't currently have one */
@@ -649,9 +649,10 @@ void
 controld_trigger_fencer_connect()
 {
     if (stonith_reconnect == NULL) {
-        stonith_reconnect = mainloop_add_trigger(G_PRIORITY_LOW,
-                                                 te_connect_stonith,
-                                                 GINT_TO_POINTER(TRUE));
+        stonith_reconnect =
+            pcmk__mainloop_add_named_trigger("fencer-connect", G_PRIORITY_LOW,
+                                             te_connect_stonith,
+                                             GINT_TO_POINTER(TRUE));
     }
     set_bit(fsa_input_register, R_ST_REQUIRED);
     mainloop_set_trigger(stonith_reconnect);
@@ -925,8 +926,9 @@ te_trigger_stonith_history_sync(bool long_timeout)
      */
     if (stonith_history_sync_trigger == NULL) {
         stonith_history_sync_trigger =
-            mainloop_add_trigger(G_PRIORITY_LOW,
-                                 do_stonith_history_sync, NULL);
+            pcmk__mainloop_add_named_trigger("fencing-history-sync",
+                                             G_PRIORITY_LOW,
+                                             do_stonith_history_sync, NULL);
     }
 
     if (long_timeout) {
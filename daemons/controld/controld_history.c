@@ -0,0 +1,321 @@
+/*
+ * Copyright 2019 the Pacemaker project contributors
+ *
+ * The version control history for this file may have further details.
+ *
+ * This source code is licensed under the GNU General Public License version 2
+ * or later (GPLv2+) WITHOUT ANY WARRANTY.
+ */
+
+#include <crm_internal.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <crm/crm.h>
+#include <crm/lrmd.h>
+
+#include <pacemaker-controld.h>
+
+/* Compact resource history
+ *
+ * The controller remembers the last results of each resource's operations
+ * for every node it has an executor connection to, so it can rebuild the
+ * node's resource history in the CIB. Rather than full event copies, results
+ * are kept as packed records without agent output, and their parameters are
+ * split into instance attributes and meta-attributes, each stored as a
+ * reference-counted parameter set interned across all nodes. Instances of
+ * the same resource (clone instances, or the same resource on many remote
+ * nodes) usually share their instance attributes, so that memory is only used
+ * once. Parameter tables are rebuilt only when an event is needed.
+ */
+
+struct history_params_s {
+    char *data;         // "name\0value\0" for each parameter, sorted by name
+    size_t len;
+    unsigned int refs;
+};
+
+static GHashTable *interned_params = NULL;
+
+static guint
+params_hash(gconstpointer key)
+{
+    const history_params_t *params = key;
+    guint hash = 5381;
+
+    for (size_t lpc = 0; lpc < params->len; lpc++) {
+        hash = (hash * 33) + (unsigned char) params->data[lpc];
+    }
+    return hash;
+}
+
+static gboolean
+params_equal(gconstpointer a, gconstpointer b)
+{
+    const history_params_t *params_a = a;
+    const history_params_t *params_b = b;
+
+    return (params_a->len == params_b->len)
+           && !memcmp(params_a->data, params_b->data, params_a->len);
+}
+
+static inline bool
+is_meta_param(const char *name)
+{
+    // This must match how stop parameters have always been selected
+    return strstr(name, CRM_META "_") != NULL;
+}
+
+/*!
+ * \internal
+ * \brief Get an interned set of operation parameters
+ *
+ * \param[in] table  Operation parameters
+ * \param[in] meta   If TRUE, use only meta-attributes, otherwise only others
+ *
+ * \return Parameter set (which the caller must release with
+ *         history_params_unref())
+ */
+static history_params_t *
+intern_params(GHashTable *table, bool meta)
+{
+    history_params_t lookup = { NULL, 0, 0 };
+    history_params_t *params = NULL;
+    GList *names = NULL;
+    GHashTableIter iter;
+    const char *name = NULL;
+    const char *value = NULL;
+    char *pos = NULL;
+
+    g_hash_table_iter_init(&iter, table);
+    while (g_hash_table_iter_next(&iter, (gpointer *) &name,
+                                  (gpointer *) &value)) {
+        if (is_meta_param(name) == meta) {
+            names = g_list_prepend(names, (gpointer) name);
+            lookup.len += strlen(name) + strlen(value) + 2;
+        }
+    }
+    names = g_list_sort(names, (GCompareFunc) strcmp);
+
+    lookup.data = calloc(1, MAX(lookup.len, 1));
+    CRM_ASSERT(lookup.data != NULL);
+    pos = lookup.data;
+    for (GList *gIter = names; gIter != NULL; gIter = gIter->next) {
+        size_t name_len = strlen(gIter->data) + 1;
+        size_t value_len = 0;
+
+        value = g_hash_table_lookup(table, gIter->data);
+        value_len = strlen(value) + 1;
+        memcpy(pos, gIter->data, name_len);
+        memcpy(pos + name_len, value, value_len);
+        pos += name_len + value_len;
+    }
+    g_list_free(names);
+
+    if (interned_params == NULL) {
+        interned_params = g_hash_table_new(params_hash, params_equal);
+    }
+
+    params = g_hash_table_lookup(interned_params, &lookup);
+    if (params != NULL) {
+        free(lookup.data);
+        params->refs++;
+        return params;
+    }
+
+    params = calloc(1, sizeof(history_params_t));
+    CRM_ASSERT(params != NULL);
+    params->data = lookup.data;
+    params->len = lookup.len;
+    params->refs = 1;
+    g_hash_table_insert(interned_params, params, params);
+    return params;
+}
+
+/*!
+ * \internal
+ * \brief Add a reference to a parameter set
+ *
+ * \param[in,out] params  Parameter set (may be NULL)
+ *
+ * \return \p params
+ */
+history_params_t *
+history_params_ref(history_params_t *params)
+{
+    if (params != NULL) {
+        params->refs++;
+    }
+    return params;
+}
+
+/*!
+ * \internal
+ * \brief Release a reference to a parameter set
+ *
+ * \param[in,out] params  Parameter set (may be NULL)
+ */
+void
+history_params_unref(history_params_t *params)
+{
+    if ((params == NULL) || (--(params->refs) > 0)) {
+        return;
+    }
+
+    g_hash_table_remove(interned_params, params);
+    if (g_hash_table_size(interned_params) == 0) {
+        g_hash_table_destroy(interned_params);
+        interned_params = NULL;
+    }
+    free(params->data);
+    free(params);
+}
+
+/*!
+ * \internal
+ * \brief Copy all parameters in a parameter set into a table
+ *
+ * \param[in]     params  Parameter set (may be NULL)
+ * \param[in,out] table   Table to add parameters to
+ */
+void
+history_params_copy(const history_params_t *params, GHashTable *table)
+{
+    const char *pos = NULL;
+
+    if (params == NULL) {
+        return;
+    }
+    for (pos = params->data; pos < (params->data + params->len); ) {
+        const char *value = pos + strlen(pos) + 1;
+
+        g_hash_table_replace(table, strdup(pos), strdup(value));
+        pos = value + strlen(value) + 1;
+    }
+}
+
+/*!
+ * \internal
+ * \brief Get the value of a parameter in a parameter set
+ *
+ * \param[in] params  Parameter set (may be NULL)
+ * \param[in] name    Parameter name
+ *
+ * \return Value of \p name in \p params, or NULL if not present
+ */
+const char *
+history_params_value(const history_params_t *params, const char *name)
+{
+    const char *pos = NULL;
+
+    if (params == NULL) {
+        return NULL;
+    }
+    for (pos = params->data; pos < (params->data + params->len); ) {
+        const char *value = pos + strlen(pos) + 1;
+
+        if (!strcmp(pos, name)) {
+            return value;
+        }
+        pos = value + strlen(value) + 1;
+    }
+    return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Create a compact resource history record from an executor event
+ *
+ * \param[in] op  Executor event to record
+ *
+ * \return Newly allocated record (which the caller must free with
+ *         history_op_free())
+ */
+history_op_t *
+history_op_new(const lrmd_event_data_t *op)
+{
+    history_op_t *hop = calloc(1, sizeof(history_op_t));
+
+    CRM_ASSERT(hop != NULL);
+    hop->op_type = g_intern_string(op->op_type);
+    hop->user_data = op->user_data? strdup(op->user_data) : NULL;
+    hop->exit_reason = op->exit_reason? strdup(op->exit_reason) : NULL;
+    hop->call_id = op->call_id;
+    hop->timeout = op->timeout;
+    hop->interval_ms = op->interval_ms;
+    hop->start_delay = op->start_delay;
+    hop->rc = op->rc;
+    hop->op_status = op->op_status;
+    hop->t_run = op->t_run;
+    hop->t_rcchange = op->t_rcchange;
+    hop->exec_time = op->exec_time;
+    hop->queue_time = op->queue_time;
+    if (op->params != NULL) {
+        hop->instance = intern_params(op->params, FALSE);
+        hop->meta = intern_params(op->params, TRUE);
+    }
+    return hop;
+}
+
+/*!
+ * \internal
+ * \brief Free a compact resource history record
+ *
+ * \param[in,out] data  Record to free
+ */
+void
+history_op_free(gpointer data)
+{
+    history_op_t *hop = data;
+
+    if (hop == NULL) {
+        return;
+    }
+    history_params_unref(hop->instance);
+    history_params_unref(hop->meta);
+    free(hop->user_data);
+    free(hop->exit_reason);
+    free(hop);
+}
+
+/*!
+ * \internal
+ * \brief Rebuild an executor event from a compact resource history record
+ *
+ * \param[in] hop     Record to rebuild
+ * \param[in] rsc_id  ID of resource that record is for
+ *
+ * \return Newly allocated event (which the caller must free with
+ *         lrmd_free_event())
+ * \note The event has no agent output.
+ */
+lrmd_event_data_t *
+history_op_event(const history_op_t *hop, const char *rsc_id)
+{
+    lrmd_event_data_t *op = calloc(1, sizeof(lrmd_event_data_t));
+
+    CRM_ASSERT(op != NULL);
+    op->type = lrmd_event_exec_complete;
+    op->rsc_id = strdup(rsc_id);
+    op->op_type = hop->op_type? strdup(hop->op_type) : NULL;
+    op->user_data = hop->user_data? strdup(hop->user_data) : NULL;
+    op->exit_reason = hop->exit_reason? strdup(hop->exit_reason) : NULL;
+    op->call_id = hop->call_id;
+    op->timeout = hop->timeout;
+    op->interval_ms = hop->interval_ms;
+    op->start_delay = hop->start_delay;
+    op->rc = hop->rc;
+    op->op_status = hop->op_status;
+    op->t_run = hop->t_run;
+    op->t_rcchange = hop->t_rcchange;
+    op->exec_time = hop->exec_time;
+    op->queue_time = hop->queue_time;
+    if ((hop->instance != NULL) || (hop->meta != NULL)) {
+        op->params = crm_str_table_new();
+        history_params_copy(hop->instance, op->params);
+        history_params_copy(hop->meta, op->params);
+    }
+    return op;
+}
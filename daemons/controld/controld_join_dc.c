@@ -27,6 +27,9 @@ void finalize_sync_callback(xmlNode * msg, int call_id, int rc, xmlNode * output
 gboolean check_join_state(enum crmd_fsa_state cur_state, const char *source);
 
 static int current_join_id = 0;
+static int join_updates_pending = 0;    // Current round's incomplete updates
+
+#define JOIN_HISTORY_CHUNK 200  // Maximum resources per join history update
 unsigned long long saved_ccm_membership_id = 0;
 
 void
@@ -82,6 +85,11 @@ initialize_join(gboolean before)
         crm_update_peer_join(__FUNCTION__, peer, crm_join_none);
     }
 
+    /* Updates from an earlier round (which may have failed or been abandoned)
+     * must not hold up this one
+     */
+    join_updates_pending = 0;
+
     if (before) {
         if (max_generation_from != NULL) {
             free(max_generation_from);
@@ -490,10 +498,21 @@ static void
 join_update_complete_callback(xmlNode * msg, int call_id, int rc, xmlNode * output, void *user_data)
 {
     fsa_data_t *msg_data = NULL;
+    int join_id = *(int *) user_data;
+
+    if (join_id != current_join_id) {
+        crm_debug("join-%d update %d completed during join-%d",
+                  join_id, call_id, current_join_id);
+
+    } else if (join_updates_pending > 0) {
+        join_updates_pending--;
+    }
 
     if (rc == pcmk_ok) {
         crm_debug("Join update %d complete", call_id);
-        check_join_state(fsa_state, __FUNCTION__);
+        if ((join_id == current_join_id) && (join_updates_pending == 0)) {
+            check_join_state(fsa_state, __FUNCTION__);
+        }
 
     } else {
         crm_err("Join update %d failed", call_id);
@@ -502,6 +521,295 @@ join_update_complete_callback(xmlNode * msg, int call_id, int rc, xmlNode * outp
     }
 }
 
+static void
+send_join_update(xmlNode *update)
+{
+    int call_id = 0;
+    int *join_id = malloc(sizeof(int));
+
+    CRM_ASSERT(join_id != NULL);
+    *join_id = current_join_id;
+
+    fsa_cib_update(XML_CIB_TAG_STATUS, update,
+                   cib_scope_local | cib_quorum_override | cib_can_create,
+                   call_id, NULL);
+    join_updates_pending++;
+    fsa_register_cib_callback(call_id, FALSE, join_id,
+                              join_update_complete_callback);
+    crm_debug("join-%d: Registered callback for CIB status update %d",
+              current_join_id, call_id);
+}
+
+/*!
+ * \internal
+ * \brief Record a joining node's state and resource history in the CIB
+ *
+ * Large histories are split into several CIB updates of a limited number of
+ * resources each, so the CIB manager applies (and notifies clients of) the
+ * history incrementally, rather than stalling on a single huge update. The
+ * join is not considered complete until all of the updates are.
+ *
+ * \param[in] node_state  Node state (including resource history) to record
+ */
+static void
+update_join_history(xmlNode *node_state)
+{
+    xmlNode *lrm = first_named_child(node_state, XML_CIB_TAG_LRM);
+    xmlNode *rscs = first_named_child(lrm, XML_LRM_TAG_RESOURCES);
+    xmlNode *skeleton = NULL;
+    xmlNode *skeleton_rscs = NULL;
+    xmlNode *rsc = NULL;
+    int num_rscs = 0;
+    int chunks = 0;
+
+    for (rsc = __xml_first_child(rscs); rsc != NULL; rsc = __xml_next(rsc)) {
+        num_rscs++;
+    }
+    if (num_rscs <= JOIN_HISTORY_CHUNK) {
+        send_join_update(node_state);
+        return;
+    }
+
+    // Each update gets the node state, plus some of the resources
+    skeleton = copy_xml(node_state);
+    skeleton_rscs = first_named_child(first_named_child(skeleton,
+                                                        XML_CIB_TAG_LRM),
+                                      XML_LRM_TAG_RESOURCES);
+    while (__xml_first_child(skeleton_rscs) != NULL) {
+        free_xml(__xml_first_child(skeleton_rscs));
+    }
+
+    rsc = __xml_first_child(rscs);
+    while (rsc != NULL) {
+        xmlNode *chunk = copy_xml(skeleton);
+        xmlNode *chunk_rscs = first_named_child(first_named_child(chunk,
+                                                                  XML_CIB_TAG_LRM),
+                                                XML_LRM_TAG_RESOURCES);
+
+        for (int lpc = 0; (rsc != NULL) && (lpc < JOIN_HISTORY_CHUNK);
+             rsc = __xml_next(rsc), lpc++) {
+            add_node_copy(chunk_rscs, rsc);
+        }
+        send_join_update(chunk);
+        free_xml(chunk);
+        chunks++;
+    }
+    free_xml(skeleton);
+
+    crm_info("join-%d: Recording history of %d resources for %s "
+             "in %d CIB updates", current_join_id, num_rscs,
+             crm_element_value(node_state, XML_ATTR_UNAME), chunks);
+}
+
+/*!
+ * \internal
+ * \brief Calculate a signature of a node's resource history
+ *
+ * The signature covers only what identifies each history entry (in any
+ * order), so it is the same for the history a node sends when joining and for
+ * the history recorded in the CIB from the same operation results.
+ *
+ * \param[in] lrm  Node's resource history status section
+ *
+ * \return Newly allocated signature
+ */
+static char *
+history_signature(xmlNode *lrm)
+{
+    xmlNode *rscs = first_named_child(lrm, XML_LRM_TAG_RESOURCES);
+    GList *entries = NULL;
+    GString *buffer = g_string_sized_new(1024);
+    char *signature = NULL;
+
+    for (xmlNode *rsc = first_named_child(rscs, XML_LRM_TAG_RESOURCE);
+         rsc != NULL; rsc = crm_next_same_xml(rsc)) {
+
+        char *rsc_entry = crm_strdup_printf("%s %s %s %s %s", ID(rsc),
+                                            crm_str(crm_element_value(rsc, XML_AGENT_ATTR_CLASS)),
+                                            crm_str(crm_element_value(rsc, XML_AGENT_ATTR_PROVIDER)),
+                                            crm_str(crm_element_value(rsc, XML_ATTR_TYPE)),
+                                            crm_str(crm_element_value(rsc, XML_RSC_ATTR_CONTAINER)));
+
+        entries = g_list_prepend(entries, rsc_entry);
+        for (xmlNode *op = first_named_child(rsc, XML_LRM_TAG_RSC_OP);
+             op != NULL; op = crm_next_same_xml(op)) {
+
+            entries = g_list_prepend(entries,
+                                     crm_strdup_printf("%s %s %s %s %s %s %s %s",
+                                                       ID(rsc), ID(op),
+                                                       crm_str(crm_element_value(op, XML_LRM_ATTR_CALLID)),
+                                                       crm_str(crm_element_value(op, XML_LRM_ATTR_RC)),
+                                                       crm_str(crm_element_value(op, XML_LRM_ATTR_OPSTATUS)),
+                                                       crm_str(crm_element_value(op, XML_LRM_ATTR_INTERVAL_MS)),
+                                                       crm_str(crm_element_value(op, XML_ATTR_TRANSITION_MAGIC)),
+                                                       crm_str(crm_element_value(op, XML_LRM_ATTR_OP_DIGEST))));
+        }
+    }
+
+    entries = g_list_sort(entries, (GCompareFunc) strcmp);
+    for (GList *iter = entries; iter != NULL; iter = iter->next) {
+        g_string_append(buffer, (const char *) iter->data);
+        g_string_append_c(buffer, '\n');
+    }
+    signature = crm_md5sum(buffer->str);
+
+    g_list_free_full(entries, free);
+    g_string_free(buffer, TRUE);
+    return signature;
+}
+
+/*!
+ * \internal
+ * \brief Record a joining node's state, unless its history is already current
+ *
+ * \param[in] uname       Name of joining node
+ * \param[in] node_state  Node state (including resource history) from join
+ * \param[in] cib_lrm     Node's resource history currently in the CIB (or
+ *                        NULL if unknown)
+ */
+static void
+record_join_state(const char *uname, xmlNode *node_state, xmlNode *cib_lrm)
+{
+    xmlNode *lrm = first_named_child(node_state, XML_CIB_TAG_LRM);
+    bool unchanged = FALSE;
+
+    if ((lrm != NULL) && (cib_lrm != NULL)) {
+        char *join_signature = history_signature(lrm);
+        char *cib_signature = history_signature(cib_lrm);
+
+        unchanged = safe_str_eq(join_signature, cib_signature);
+        crm_trace("Resource history signature for %s: %s (CIB has %s)",
+                  uname, join_signature, cib_signature);
+        free(join_signature);
+        free(cib_signature);
+    }
+
+    if (unchanged) {
+        /* Skip rewriting identical history (for example, when a new join
+         * round starts without the node having run anything since the last)
+         */
+        crm_info("join-%d: Resource history for %s is already current",
+                 current_join_id, uname);
+        free_xml(lrm);
+        send_join_update(node_state);
+
+    } else {
+        erase_status_tag(uname, XML_CIB_TAG_LRM, cib_scope_local);
+        update_join_history(node_state);
+    }
+}
+
+struct join_history_query_s {
+    int join_id;        // Join round that query is for
+    char *uname;        // Joining node
+    xmlNode *state;     // Node state (including resource history) from join
+};
+
+static void
+free_join_history_query(void *user_data)
+{
+    struct join_history_query_s *query = user_data;
+
+    free(query->uname);
+    free_xml(query->state);
+    free(query);
+}
+
+static void
+join_history_query_callback(xmlNode *msg, int call_id, int rc, xmlNode *output,
+                            void *user_data)
+{
+    struct join_history_query_s *query = user_data;
+
+    if (query->join_id != current_join_id) {
+        crm_debug("join-%d history query %d completed during join-%d",
+                  query->join_id, call_id, current_join_id);
+        return;
+    }
+    if (join_updates_pending > 0) {
+        join_updates_pending--;
+    }
+    if (rc != pcmk_ok) {
+        crm_trace("No resource history for %s in CIB: %s " CRM_XS " rc=%d",
+                  query->uname, pcmk_strerror(rc), rc);
+        output = NULL;
+    }
+
+    /* This sends at least one update that the join must wait for, so there's
+     * no need to check the join state here
+     */
+    record_join_state(query->uname, query->state, output);
+}
+
+/*!
+ * \internal
+ * \brief Record a joining node's state and history, deduplicating if possible
+ *
+ * The history sent by a joining node is compared with the history already in
+ * the CIB, which must be known to be current. That is the case for the DC's
+ * CIB replica only while none of the controller's own CIB calls are pending.
+ * Otherwise, the node's history is queried from the CIB manager (which orders
+ * the query after those calls), and the comparison is made when the result
+ * arrives. The join is not complete until then.
+ *
+ * \param[in] peer        Joining node
+ * \param[in] node_state  Node state (including resource history) from join
+ *                        (will be freed)
+ */
+static void
+process_join_state(crm_node_t *peer, xmlNode *node_state)
+{
+    xmlNode *cib = controld_sched_cib_replica();
+    struct join_history_query_s *query = NULL;
+    char *xpath = NULL;
+    int call_id = 0;
+
+    if ((peer->uuid == NULL)
+        || (first_named_child(node_state, XML_CIB_TAG_LRM) == NULL)) {
+        record_join_state(peer->uname, node_state, NULL);
+        free_xml(node_state);
+        return;
+    }
+
+    if (cib != NULL) {
+        xmlNode *status = first_named_child(cib, XML_CIB_TAG_STATUS);
+        xmlNode *cib_lrm = NULL;
+
+        for (xmlNode *state = first_named_child(status, XML_CIB_TAG_STATE);
+             state != NULL; state = crm_next_same_xml(state)) {
+
+            if (safe_str_eq(ID(state), peer->uuid)) {
+                cib_lrm = first_named_child(state, XML_CIB_TAG_LRM);
+                break;
+            }
+        }
+        record_join_state(peer->uname, node_state, cib_lrm);
+        free_xml(node_state);
+        return;
+    }
+
+    xpath = crm_strdup_printf("//" XML_CIB_TAG_STATE "[@" XML_ATTR_ID "='%s']/"
+                              XML_CIB_TAG_LRM, peer->uuid);
+    call_id = fsa_cib_conn->cmds->query(fsa_cib_conn, xpath, NULL,
+                                        cib_xpath|cib_scope_local);
+    free(xpath);
+
+    query = calloc(1, sizeof(struct join_history_query_s));
+    CRM_ASSERT(query != NULL);
+    query->join_id = current_join_id;
+    query->uname = strdup(peer->uname);
+    query->state = node_state;
+
+    join_updates_pending++;
+    crm_debug("join-%d: Querying resource history for %s (call %d)",
+              current_join_id, peer->uname, call_id);
+    fsa_cib_conn->cmds->register_callback_full(fsa_cib_conn, call_id,
+                                               cib_op_timeout(), FALSE, query,
+                                               "join_history_query_callback",
+                                               join_history_query_callback,
+                                               free_join_history_query);
+}
+
 /*	A_DC_JOIN_PROCESS_ACK	*/
 void
 do_dc_join_ack(long long action,
@@ -510,7 +818,7 @@ do_dc_join_ack(long long action,
                enum crmd_fsa_input current_input, fsa_data_t * msg_data)
 {
     int join_id = -1;
-    int call_id = 0;
+    xmlNode *state = NULL;
     ha_msg_input_t *join_ack = fsa_typed_data(fsa_dt_ha_msg);
 
     const char *op = crm_element_value(join_ack->msg, F_CRM_TASK);
@@ -546,30 +854,22 @@ do_dc_join_ack(long long action,
      * We don't need to notify the TE of these updates, a transition will
      *   be started in due time
      */
-    erase_status_tag(join_from, XML_CIB_TAG_LRM, cib_scope_local);
-
     if (safe_str_eq(join_from, fsa_our_uname)) {
-        xmlNode *now_dc_lrmd_state = do_lrm_query(TRUE, fsa_our_uname);
-
-        if (now_dc_lrmd_state != NULL) {
+        state = do_lrm_query(TRUE, fsa_our_uname);
+        if (state != NULL) {
             crm_debug("Local executor state updated from query");
-            fsa_cib_update(XML_CIB_TAG_STATUS, now_dc_lrmd_state,
-                cib_scope_local | cib_quorum_override | cib_can_create, call_id, NULL);
-            free_xml(now_dc_lrmd_state);
         } else {
             crm_warn("Local executor state updated from join acknowledgement because query failed");
-            fsa_cib_update(XML_CIB_TAG_STATUS, join_ack->xml,
-                cib_scope_local | cib_quorum_override | cib_can_create, call_id, NULL);
         }
     } else {
         crm_debug("Executor state for %s updated from join acknowledgement",
                   join_from);
-        fsa_cib_update(XML_CIB_TAG_STATUS, join_ack->xml,
-           cib_scope_local | cib_quorum_override | cib_can_create, call_id, NULL);
+    }
+    if (state == NULL) {
+        state = copy_xml(join_ack->xml);
     }
 
-    fsa_register_cib_callback(call_id, FALSE, NULL, join_update_complete_callback);
-    crm_debug("join-%d: Registered callback for CIB status update %d", join_id, call_id);
+    process_join_state(peer, state);
 }
 
 void
@@ -16,23 +16,55 @@ void lrm_clear_last_failure(const char *rsc_id, const char *node_name,
 void lrm_op_callback(lrmd_event_data_t * op);
 lrmd_t *crmd_local_lrmd_conn(void);
 
+/* Interned, reference-counted set of operation parameters */
+typedef struct history_params_s history_params_t;
+
+/* Operation result as remembered in resource history (without agent output) */
+typedef struct history_op_s {
+    const char *op_type;        // Interned string
+    char *user_data;
+    char *exit_reason;
+    int call_id;
+    int timeout;
+    guint interval_ms;
+    int start_delay;
+    enum ocf_exitcode rc;
+    int op_status;
+    unsigned int t_run;
+    unsigned int t_rcchange;
+    unsigned int exec_time;
+    unsigned int queue_time;
+    history_params_t *instance; // Parameters other than meta-attributes
+    history_params_t *meta;     // Meta-attributes passed as parameters
+} history_op_t;
+
 typedef struct resource_history_s {
     char *id;
     uint32_t last_callid;
-    lrmd_rsc_info_t rsc;
-    lrmd_event_data_t *last;
-    lrmd_event_data_t *failed;
-    GList *recurring_op_list;
+    lrmd_rsc_info_t rsc;        // Agent strings are interned, not allocated
+    history_op_t *last;
+    history_op_t *failed;
+    GList *recurring_op_list;   // history_op_t
 
     /* Resources must be stopped using the same
-     * parameters they were started with.  This hashtable
-     * holds the parameters that should be used for the next stop
+     * parameters they were started with.  This parameter
+     * set holds the parameters that should be used for the next stop
      * cmd on this resource. */
-    GHashTable *stop_params;
+    history_params_t *stop_params;
 } rsc_history_t;
 
 void history_free(gpointer data);
 
+history_params_t *history_params_ref(history_params_t *params);
+void history_params_unref(history_params_t *params);
+void history_params_copy(const history_params_t *params, GHashTable *table);
+const char *history_params_value(const history_params_t *params,
+                                 const char *name);
+history_op_t *history_op_new(const lrmd_event_data_t *op);
+void history_op_free(gpointer data);
+lrmd_event_data_t *history_op_event(const history_op_t *hop,
+                                    const char *rsc_id);
+
 /* TODO - Replace this with lrmd_event_data_t */
 struct recurring_op_s {
     guint interval_ms;
@@ -129,6 +161,7 @@ int lrm_state_get_metadata(lrm_state_t * lrm_state,
                            const char *class,
                            const char *provider,
                            const char *agent, char **output, enum lrmd_call_options options);
+void controld_preload_metadata(lrm_state_t *lrm_state);
 int lrm_state_cancel(lrm_state_t *lrm_state, const char *rsc_id,
                      const char *action, guint interval_ms);
 int lrm_state_exec(lrm_state_t *lrm_state, const char *rsc_id,
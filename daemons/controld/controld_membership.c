@@ -429,7 +429,7 @@ crm_update_quorum(gboolean quorum, gboolean force_update)
              */
             abort_after_delay(INFINITY, tg_restart, "Quorum gained", 5000);
         } else {
-            abort_transition(INFINITY, tg_restart, "Quorum lost", NULL);
+            abort_transition_urgent(INFINITY, tg_restart, "Quorum lost", NULL);
         }
     }
     fsa_has_quorum = quorum;
@@ -707,6 +707,27 @@ handle_ping(xmlNode *msg)
     // @TODO maybe do some checks to determine meaningful status
     crm_xml_add(ping, XML_PING_ATTR_STATUS, "ok");
 
+    // Add main loop latency by priority lane and by source
+    pcmk__mainloop_lane_stats(ping);
+    pcmk__mainloop_source_stats(ping);
+
+#if SUPPORT_COROSYNC
+    // Add outbound cluster message queue statistics
+    if (is_corosync_cluster()) {
+        pcmk__cpg_queue_stats_t stats;
+        xmlNode *queue = create_xml_node(ping, "cpg_queue");
+
+        pcmk__cpg_queue_stats(&stats);
+        crm_xml_add_int(queue, "depth", stats.depth);
+        crm_xml_add_int(queue, "max_depth", stats.max_depth);
+        crm_xml_add_ll(queue, "queued", stats.queued);
+        crm_xml_add_ll(queue, "sent", stats.sent);
+        crm_xml_add_ll(queue, "batched", stats.batched);
+        crm_xml_add_ll(queue, "flow_control", stats.flow_control);
+        crm_xml_add_ll(queue, "max_wait_ms", stats.max_wait_ms);
+    }
+#endif
+
     // Send reply
     msg = create_reply(msg, ping);
     free_xml(ping);
@@ -1012,8 +1033,14 @@ handle_response(xmlNode * stored_msg)
             ha_msg_input_t fsa_input;
 
             controld_stop_sched_timer();
-            fsa_input.msg = stored_msg;
-            register_fsa_input_later(C_IPC_MESSAGE, I_PE_SUCCESS, &fsa_input);
+            if (controld_sched_reply_ok(stored_msg)) {
+                fsa_input.msg = stored_msg;
+                register_fsa_input_later(C_IPC_MESSAGE, I_PE_SUCCESS,
+                                         &fsa_input);
+            }
+
+        } else if (controld_sched_speculation_reply(stored_msg)) {
+            crm_trace("Holding speculative calculation %s", msg_ref);
 
         } else {
             crm_info("%s calculation %s is obsolete", op, msg_ref);
@@ -1076,6 +1103,7 @@ send_msg_via_ipc(xmlNode * msg, const char *sys)
     if (client_channel != NULL) {
         /* Transient clients such as crmadmin */
         send_ok = crm_ipcs_send(client_channel, 0, msg, crm_ipc_server_event);
+        pcmk__ipcs_reply_sent(client_channel);
 
     } else if (sys != NULL && strcmp(sys, CRM_SYSTEM_TENGINE) == 0) {
         xmlNode *data = get_message_xml(msg, F_CRM_DATA);
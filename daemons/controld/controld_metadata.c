@@ -10,11 +10,14 @@
 #include <crm_internal.h>
 
 #include <stdio.h>
+#include <dirent.h>
 #include <glib.h>
 #include <regex.h>
 
 #include <crm/crm.h>
+#include <crm/msg_xml.h>
 #include <crm/lrmd.h>
+#include <crm/services.h>
 
 #include <pacemaker-controld.h>
 
@@ -269,3 +272,226 @@ metadata_cache_get(GHashTable *mdc, lrmd_rsc_info_t *rsc)
     }
     return metadata;
 }
+
+static GHashTable *metadata_fetches = NULL;  // Keys of agents being refreshed
+
+static void
+metadata_refreshed(svc_action_t *action)
+{
+    lrm_state_t *lrm_state = lrm_state_find(fsa_our_uname);
+    lrmd_rsc_info_t rsc = {
+        .id = action->agent,
+        .type = action->agent,
+        .standard = action->standard,
+        .provider = action->provider,
+    };
+
+    if (metadata_fetches != NULL) {
+        g_hash_table_remove(metadata_fetches, action->rsc);
+    }
+    if ((action->rc != PCMK_OCF_OK) || (action->stdout_data == NULL)) {
+        crm_debug("Could not refresh meta-data for %s (rc=%d)",
+                  action->rsc, action->rc);
+        return;
+    }
+
+    pcmk__cache_agent_metadata(action->standard, action->provider,
+                               action->agent, action->stdout_data);
+    if (lrm_state != NULL) {
+        metadata_cache_update(lrm_state->metadata_cache, &rsc,
+                              action->stdout_data);
+    }
+    crm_debug("Refreshed meta-data for %s", action->rsc);
+}
+
+static void
+refresh_metadata(lrm_state_t *lrm_state, const char *key,
+                 const char *standard, const char *provider, const char *type)
+{
+    GHashTable *params = NULL;
+    svc_action_t *action = NULL;
+
+    if (metadata_fetches == NULL) {
+        metadata_fetches = crm_str_table_new();
+    }
+    if (g_hash_table_lookup(metadata_fetches, key) != NULL) {
+        return;
+    }
+
+    // See lrm_state_get_metadata() for why the node name is needed
+    params = crm_str_table_new();
+    g_hash_table_insert(params, strdup(CRM_META "_" XML_LRM_ATTR_TARGET),
+                        strdup(lrm_state->node_name));
+
+    action = resources_action_create(key, standard, provider, type,
+                                     CRMD_ACTION_METADATA, 0,
+                                     CRMD_METADATA_CALL_TIMEOUT, params, 0);
+    if (action == NULL) {
+        return;
+    }
+    g_hash_table_insert(metadata_fetches, strdup(key), strdup(key));
+    if (!services_action_async(action, metadata_refreshed)) {
+        crm_debug("Could not refresh meta-data for %s", key);
+        g_hash_table_remove(metadata_fetches, key);
+        services_action_free(action);
+    }
+}
+
+/*!
+ * \internal
+ * \brief Make an agent's meta-data available without blocking
+ *
+ * Load the agent's meta-data from the on-disk cache if it has a valid entry
+ * there, otherwise fetch it in the background where the standard allows it.
+ *
+ * \param[in]     lrm_state   Executor state for the local node
+ * \param[in]     key         Agent key
+ * \param[in]     standard    Agent standard
+ * \param[in]     provider    Agent provider (or NULL)
+ * \param[in]     type        Agent type
+ * \param[in,out] loaded      Incremented if meta-data was loaded
+ * \param[in,out] refreshing  Incremented if meta-data is being fetched
+ */
+static void
+preload_agent(lrm_state_t *lrm_state, const char *key, const char *standard,
+              const char *provider, const char *type, int *loaded,
+              int *refreshing)
+{
+    char *metadata = NULL;
+    lrmd_rsc_info_t rsc;
+
+    rsc.id = (char *) key;
+    rsc.type = (char *) type;
+    rsc.standard = (char *) standard;
+    rsc.provider = (char *) provider;
+
+    if (metadata_cache_get(lrm_state->metadata_cache, &rsc) != NULL) {
+        return;
+    }
+
+    metadata = pcmk__cached_agent_metadata(standard, provider, type);
+    if (metadata != NULL) {
+        if (metadata_cache_update(lrm_state->metadata_cache, &rsc,
+                                  metadata)) {
+            (*loaded)++;
+        }
+        free(metadata);
+
+    } else if (!strcmp(standard, PCMK_RESOURCE_CLASS_OCF)) {
+        refresh_metadata(lrm_state, key, standard, provider, type);
+        (*refreshing)++;
+    }
+}
+
+static void
+preload_configured_metadata(xmlNode *msg, int call_id, int rc,
+                            xmlNode *output, void *user_data)
+{
+    lrm_state_t *lrm_state = lrm_state_find(fsa_our_uname);
+    xmlXPathObjectPtr xpathObj = NULL;
+    int max = 0;
+    int loaded = 0;
+    int refreshing = 0;
+
+    if ((rc != pcmk_ok) || (lrm_state == NULL)) {
+        crm_debug("Not preloading meta-data for configured resources: %s "
+                  CRM_XS " rc=%d", pcmk_strerror(rc), rc);
+        return;
+    }
+
+    // Templates cover primitives that get their agent from one
+    xpathObj = xpath_search(output, "//" XML_CIB_TAG_RESOURCE
+                                    "|//" XML_CIB_TAG_RSC_TEMPLATE);
+    max = numXpathResults(xpathObj);
+    for (int lpc = 0; lpc < max; lpc++) {
+        xmlNode *match = getXpathResult(xpathObj, lpc);
+        const char *standard = crm_element_value(match, XML_AGENT_ATTR_CLASS);
+        const char *provider = crm_element_value(match,
+                                                 XML_AGENT_ATTR_PROVIDER);
+        const char *type = crm_element_value(match, XML_ATTR_TYPE);
+        char *key = NULL;
+
+        if ((standard == NULL) || (type == NULL)
+            || !crm_op_needs_metadata(standard, NULL)) {
+            continue;
+        }
+        key = crm_generate_ra_key(standard, provider, type);
+        if (key != NULL) {
+            preload_agent(lrm_state, key, standard, provider, type, &loaded,
+                          &refreshing);
+            free(key);
+        }
+    }
+    freeXpathObject(xpathObj);
+
+    crm_info("Loaded cached meta-data for %d configured agent%s "
+             "(fetching %d)", loaded, s_if_plural(loaded), refreshing);
+}
+
+/*!
+ * \internal
+ * \brief Load agent meta-data from the on-disk cache
+ *
+ * Valid entries are loaded into the local executor's meta-data cache, so the
+ * first actions after a restart don't have to wait for agents to be executed.
+ * Entries that are stale (because the agent has been updated) are refreshed
+ * in the background where the standard allows it. The agents of all
+ * configured resources are then handled the same way, so that (OCF) agents
+ * without a cache entry, for example on a new node, are fetched in the
+ * background too.
+ *
+ * \param[in] lrm_state  Executor state for the local node
+ */
+void
+controld_preload_metadata(lrm_state_t *lrm_state)
+{
+    DIR *dir = NULL;
+    struct dirent *entry = NULL;
+    int loaded = 0;
+    int refreshing = 0;
+
+    CRM_CHECK(lrm_state != NULL, return);
+
+    dir = opendir(CRM_METADATA_DIR);
+    if (dir == NULL) {
+        crm_trace("No agent meta-data cache in " CRM_METADATA_DIR);
+
+    } else {
+        while ((entry = readdir(dir)) != NULL) {
+            char *key = NULL;
+            char *standard = NULL;
+            char *provider = NULL;
+            char *type = NULL;
+
+            if ((entry->d_name[0] == '.')
+                || !crm_ends_with(entry->d_name, ".xml")) {
+                continue;
+            }
+            key = strndup(entry->d_name,
+                          strlen(entry->d_name) - strlen(".xml"));
+            if (crm_parse_agent_spec(key, &standard, &provider,
+                                     &type) == pcmk_ok) {
+                preload_agent(lrm_state, key, standard, provider, type,
+                              &loaded, &refreshing);
+            }
+            free(key);
+            free(standard);
+            free(provider);
+            free(type);
+        }
+        closedir(dir);
+
+        crm_info("Loaded cached meta-data for %d agent%s (refreshing %d)",
+                 loaded, s_if_plural(loaded), refreshing);
+    }
+
+    if ((fsa_cib_conn != NULL)
+        && is_set(fsa_input_register, R_CIB_CONNECTED)) {
+        int call_id = fsa_cib_conn->cmds->query(fsa_cib_conn,
+                                                XML_CIB_TAG_RESOURCES, NULL,
+                                                cib_scope_local);
+
+        fsa_register_cib_callback(call_id, FALSE, NULL,
+                                  preload_configured_metadata);
+    }
+}
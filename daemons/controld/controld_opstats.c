@@ -0,0 +1,432 @@
+/*
+ * Copyright 2019 the Pacemaker project contributors
+ *
+ * The version control history for this file may have further details.
+ *
+ * This source code is licensed under the GNU General Public License version 2
+ * or later (GPLv2+) WITHOUT ANY WARRANTY.
+ */
+
+#include <crm_internal.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <crm/crm.h>
+#include <crm/msg_xml.h>
+#include <crm/common/xml.h>
+#include <crm/services.h>
+
+#include <pacemaker-controld.h>
+
+/* Operation duration statistics
+ *
+ * The DC keeps the most recent execution times of each resource operation
+ * (by agent, action, interval, and node), as reported in operation history.
+ * The median is used as the action's expected duration when prioritizing
+ * transitions, and operations whose recent durations approach their timeout
+ * are flagged. Statistics are saved to a local file so they survive restarts
+ * and moving the DC role (to the extent nodes have been DC before).
+ */
+
+#define OP_STATS_FILE       PE_STATE_DIR "/op-stats.xml"
+#define OP_STATS_SAMPLES    32  // Most recent durations kept per operation
+#define OP_STATS_MIN        3   // Samples needed before estimates are used
+#define OP_STATS_WARN_PCT   80  // Flag operations whose p95 reaches this
+#define OP_STATS_SAVE_S     60  // Minimum interval between saves
+
+#define XML_TAG_OP_STATS    "op_stats"
+#define XML_TAG_OP_STAT     "op"
+
+typedef struct op_stats_s {
+    char *agent;
+    char *task;
+    guint interval_ms;
+    char *node;
+    guint samples[OP_STATS_SAMPLES];    // Execution times (ms), as a ring
+    int next;                           // Index of next sample in ring
+    long long count;                    // Samples ever recorded
+    guint queue_ms;                     // Smoothed queue time
+    bool near_timeout;                  // Whether we warned about timeout
+} op_stats_t;
+
+static GHashTable *op_stats = NULL;     // Key -> op_stats_t*
+static bool op_stats_dirty = FALSE;
+static time_t op_stats_saved = 0;
+
+static void
+free_op_stats(gpointer data)
+{
+    op_stats_t *stats = data;
+
+    free(stats->agent);
+    free(stats->task);
+    free(stats->node);
+    free(stats);
+}
+
+static char *
+op_stats_key(const char *agent, const char *task, guint interval_ms,
+             const char *node)
+{
+    return crm_strdup_printf("%s %s %u %s", agent, task, interval_ms, node);
+}
+
+static op_stats_t *
+new_op_stats(const char *agent, const char *task, guint interval_ms,
+             const char *node)
+{
+    op_stats_t *stats = calloc(1, sizeof(op_stats_t));
+
+    CRM_ASSERT(stats != NULL);
+    stats->agent = strdup(agent);
+    stats->task = strdup(task);
+    stats->interval_ms = interval_ms;
+    stats->node = strdup(node);
+    g_hash_table_insert(op_stats,
+                        op_stats_key(agent, task, interval_ms, node), stats);
+    return stats;
+}
+
+static void
+add_sample(op_stats_t *stats, guint exec_ms)
+{
+    stats->samples[stats->next] = exec_ms;
+    stats->next = (stats->next + 1) % OP_STATS_SAMPLES;
+    stats->count++;
+}
+
+static int
+num_samples(const op_stats_t *stats)
+{
+    return (stats->count < OP_STATS_SAMPLES)? (int) stats->count
+                                             : OP_STATS_SAMPLES;
+}
+
+static int
+compare_ms(const void *a, const void *b)
+{
+    guint ms_a = *(const guint *) a;
+    guint ms_b = *(const guint *) b;
+
+    return (ms_a < ms_b)? -1 : (ms_a > ms_b);
+}
+
+/*!
+ * \internal
+ * \brief Get a percentile of an operation's recent execution times
+ *
+ * \param[in] stats  Operation statistics
+ * \param[in] pct    Percentile to get (100 for maximum)
+ *
+ * \return Execution time (in ms) at \p pct percentile (or 0 if no samples)
+ */
+static guint
+op_stats_percentile(const op_stats_t *stats, int pct)
+{
+    guint sorted[OP_STATS_SAMPLES];
+    int n = num_samples(stats);
+
+    if (n == 0) {
+        return 0;
+    }
+
+    // With fewer samples than slots, the ring has not wrapped yet
+    memcpy(sorted, stats->samples, n * sizeof(guint));
+    qsort(sorted, n, sizeof(guint), compare_ms);
+    return sorted[((n - 1) * pct) / 100];
+}
+
+static void
+load_op_stats(void)
+{
+    xmlNode *xml = NULL;
+    int loaded = 0;
+
+    if (access(OP_STATS_FILE, R_OK) < 0) {
+        return;
+    }
+
+    xml = filename2xml(OP_STATS_FILE);
+    if (xml == NULL) {
+        crm_warn("Ignoring unreadable operation statistics in %s",
+                 OP_STATS_FILE);
+        return;
+    }
+
+    for (xmlNode *op = __xml_first_child(xml); op != NULL;
+         op = __xml_next(op)) {
+
+        const char *agent = crm_element_value(op, XML_ATTR_TYPE);
+        const char *task = crm_element_value(op, XML_LRM_ATTR_TASK);
+        const char *node = crm_element_value(op, XML_LRM_ATTR_TARGET);
+        const char *samples = crm_element_value(op, "samples");
+        guint interval_ms = 0;
+        op_stats_t *stats = NULL;
+
+        if (!crm_str_eq((const char *) op->name, XML_TAG_OP_STAT, TRUE)
+            || (agent == NULL) || (task == NULL) || (node == NULL)
+            || (samples == NULL)) {
+            continue;
+        }
+        crm_element_value_ms(op, XML_LRM_ATTR_INTERVAL_MS, &interval_ms);
+
+        stats = new_op_stats(agent, task, interval_ms, node);
+        for (const char *s = samples; *s != '\0'; ) {
+            char *end = NULL;
+            unsigned long ms = strtoul(s, &end, 10);
+
+            if (end == s) {
+                break;
+            }
+            add_sample(stats, (guint) ms);
+            s = (*end == ',')? (end + 1) : end;
+        }
+
+        // Keep the lifetime count, which may exceed the samples kept
+        crm_element_value_ll(op, "count", &(stats->count));
+        if (stats->count < num_samples(stats)) {
+            stats->count = num_samples(stats);
+        }
+        crm_element_value_ms(op, XML_RSC_OP_T_QUEUE, &(stats->queue_ms));
+        loaded++;
+    }
+    free_xml(xml);
+    crm_info("Loaded duration statistics for %d operations from %s",
+             loaded, OP_STATS_FILE);
+}
+
+static void
+init_op_stats(void)
+{
+    if (op_stats == NULL) {
+        op_stats = g_hash_table_new_full(crm_str_hash, g_str_equal, free,
+                                         free_op_stats);
+        load_op_stats();
+    }
+}
+
+/*!
+ * \internal
+ * \brief Find the statistics for a transition action
+ *
+ * \param[in] action  Resource action to check
+ * \param[in] create  Whether to create statistics if none exist yet
+ *
+ * \return Statistics for \p action (or NULL if none and \p create is FALSE)
+ */
+static op_stats_t *
+find_op_stats(crm_action_t *action, bool create)
+{
+    xmlNode *rsc = first_named_child(action->xml, XML_CIB_TAG_RESOURCE);
+    const char *task = crm_element_value(action->xml, XML_LRM_ATTR_TASK);
+    const char *node = crm_element_value(action->xml, XML_LRM_ATTR_TARGET);
+    char *agent = NULL;
+    char *key = NULL;
+    op_stats_t *stats = NULL;
+
+    if ((rsc == NULL) || (task == NULL) || (node == NULL)) {
+        return NULL;
+    }
+
+    agent = crm_generate_ra_key(crm_element_value(rsc, XML_AGENT_ATTR_CLASS),
+                                crm_element_value(rsc, XML_AGENT_ATTR_PROVIDER),
+                                crm_element_value(rsc, XML_ATTR_TYPE));
+    if (agent == NULL) {
+        return NULL;
+    }
+
+    init_op_stats();
+    key = op_stats_key(agent, task, action->interval_ms, node);
+    stats = g_hash_table_lookup(op_stats, key);
+    if ((stats == NULL) && create) {
+        stats = new_op_stats(agent, task, action->interval_ms, node);
+    }
+    free(key);
+    free(agent);
+    return stats;
+}
+
+static void
+check_op_timeout(op_stats_t *stats, crm_action_t *action)
+{
+    const char *value = crm_meta_value(action->params, XML_ATTR_TIMEOUT);
+    int timeout_ms = crm_parse_int(value, "0");
+    guint p95 = 0;
+    bool near_timeout = FALSE;
+
+    if ((timeout_ms <= 0) || (stats->count < OP_STATS_MIN)) {
+        return;
+    }
+
+    p95 = op_stats_percentile(stats, 95);
+    near_timeout = ((p95 * 100ULL)
+                    >= (timeout_ms * (unsigned long long) OP_STATS_WARN_PCT));
+
+    if (near_timeout && !stats->near_timeout) {
+        crm_warn("%s (%s) on %s is approaching its timeout: "
+                 "95%% of recent runs took up to %ums (timeout is %dms)",
+                 crm_element_value(action->xml, XML_LRM_ATTR_TASK_KEY),
+                 stats->agent, stats->node, p95, timeout_ms);
+
+    } else if (!near_timeout && stats->near_timeout) {
+        crm_info("%s (%s) on %s is no longer approaching its timeout "
+                 CRM_XS " p95=%ums timeout=%dms",
+                 crm_element_value(action->xml, XML_LRM_ATTR_TASK_KEY),
+                 stats->agent, stats->node, p95, timeout_ms);
+    }
+    stats->near_timeout = near_timeout;
+}
+
+/*!
+ * \internal
+ * \brief Record how long a transition action took
+ *
+ * \param[in] action  Resource action that completed
+ * \param[in] event   Operation history entry with the action's result
+ */
+void
+controld_record_op_duration(crm_action_t *action, xmlNode *event)
+{
+    int status = PCMK_LRM_OP_UNKNOWN;
+    int exec_ms = -1;
+    int queue_ms = 0;
+    op_stats_t *stats = NULL;
+
+    if (action->type != action_type_rsc) {
+        return;
+    }
+
+    // Only completed runs (or runs cut short by a timeout) are meaningful
+    crm_element_value_int(event, XML_LRM_ATTR_OPSTATUS, &status);
+    if ((status != PCMK_LRM_OP_DONE) && (status != PCMK_LRM_OP_TIMEOUT)) {
+        return;
+    }
+    if ((crm_element_value_int(event, XML_RSC_OP_T_EXEC, &exec_ms) < 0)
+        || (exec_ms < 0)) {
+        return;
+    }
+    crm_element_value_int(event, XML_RSC_OP_T_QUEUE, &queue_ms);
+
+    stats = find_op_stats(action, TRUE);
+    if (stats == NULL) {
+        return;
+    }
+
+    add_sample(stats, (guint) exec_ms);
+    if (queue_ms >= 0) {
+        stats->queue_ms = (stats->count == 1)? (guint) queue_ms
+                          : (3 * stats->queue_ms + (guint) queue_ms) / 4;
+    }
+    op_stats_dirty = TRUE;
+
+    crm_trace("%s (%s) on %s took %dms (p50=%ums p95=%ums max=%ums n=%lld)",
+              stats->task, stats->agent, stats->node, exec_ms,
+              op_stats_percentile(stats, 50), op_stats_percentile(stats, 95),
+              op_stats_percentile(stats, 100), stats->count);
+    check_op_timeout(stats, action);
+}
+
+/*!
+ * \internal
+ * \brief Get the expected duration of a transition action from history
+ *
+ * \param[in] graph   Transition graph that \p action is part of
+ * \param[in] action  Action to check
+ *
+ * \return Median recent duration (including queue time) of \p action in
+ *         milliseconds, or 0 if not enough history is known
+ */
+guint
+controld_expected_op_duration(crm_graph_t *graph, crm_action_t *action)
+{
+    op_stats_t *stats = NULL;
+
+    if (action->type != action_type_rsc) {
+        return 0;
+    }
+
+    stats = find_op_stats(action, FALSE);
+    if ((stats == NULL) || (stats->count < OP_STATS_MIN)) {
+        return 0;
+    }
+
+    // 0 would mean "unknown", so never return it for known operations
+    return MAX(op_stats_percentile(stats, 50) + stats->queue_ms, 1);
+}
+
+/*!
+ * \internal
+ * \brief Save operation duration statistics to disk if changed
+ *
+ * \param[in] force  If FALSE, skip saving if saved recently
+ */
+void
+controld_save_op_stats(bool force)
+{
+    GHashTableIter iter;
+    op_stats_t *stats = NULL;
+    xmlNode *xml = NULL;
+    time_t now = time(NULL);
+
+    if (!op_stats_dirty
+        || (!force && ((now - op_stats_saved) < OP_STATS_SAVE_S))) {
+        return;
+    }
+
+    xml = create_xml_node(NULL, XML_TAG_OP_STATS);
+    g_hash_table_iter_init(&iter, op_stats);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &stats)) {
+        xmlNode *op = create_xml_node(xml, XML_TAG_OP_STAT);
+        GString *samples = g_string_sized_new(8 * OP_STATS_SAMPLES);
+        int n = num_samples(stats);
+
+        crm_xml_add(op, XML_ATTR_TYPE, stats->agent);
+        crm_xml_add(op, XML_LRM_ATTR_TASK, stats->task);
+        crm_xml_add_ms(op, XML_LRM_ATTR_INTERVAL_MS, stats->interval_ms);
+        crm_xml_add(op, XML_LRM_ATTR_TARGET, stats->node);
+        crm_xml_add_ll(op, "count", stats->count);
+        crm_xml_add_ms(op, XML_RSC_OP_T_QUEUE, stats->queue_ms);
+
+        // For the benefit of anyone reading the file
+        crm_xml_add_ms(op, "p50", op_stats_percentile(stats, 50));
+        crm_xml_add_ms(op, "p95", op_stats_percentile(stats, 95));
+        crm_xml_add_ms(op, "max", op_stats_percentile(stats, 100));
+
+        // Oldest first, so reloading preserves the ring order
+        for (int lpc = 0; lpc < n; lpc++) {
+            int index = (stats->next - n + lpc + OP_STATS_SAMPLES)
+                        % OP_STATS_SAMPLES;
+
+            g_string_append_printf(samples, "%s%u", (lpc? "," : ""),
+                                   stats->samples[index]);
+        }
+        crm_xml_add(op, "samples", samples->str);
+        g_string_free(samples, TRUE);
+    }
+
+    if (write_xml_file(xml, OP_STATS_FILE, FALSE) < 0) {
+        crm_warn("Could not save operation statistics to %s", OP_STATS_FILE);
+    } else {
+        op_stats_dirty = FALSE;
+    }
+    op_stats_saved = now;
+    free_xml(xml);
+}
+
+/*!
+ * \internal
+ * \brief Save and free operation duration statistics
+ */
+void
+controld_free_op_stats(void)
+{
+    if (op_stats != NULL) {
+        controld_save_op_stats(TRUE);
+        g_hash_table_destroy(op_stats);
+        op_stats = NULL;
+    }
+}
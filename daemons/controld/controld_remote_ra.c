@@ -223,6 +223,7 @@ remote_node_up(const char *node_name)
      * soon. Ideally, we wouldn't rely on the CIB for the fenced status.
      */
     fsa_cib_update(XML_CIB_TAG_STATUS, update, call_opt, call_id, NULL);
+    controld_track_cib_call(call_id);
     if (call_id < 0) {
         crm_perror(LOG_WARNING, "%s CIB node state setup", node_name);
     }
@@ -275,6 +276,7 @@ remote_node_down(const char *node_name, const enum down_opts opts)
     update = create_xml_node(NULL, XML_CIB_TAG_STATUS);
     create_node_state_update(node, node_update_cluster, update, __FUNCTION__);
     fsa_cib_update(XML_CIB_TAG_STATUS, update, call_opt, call_id, NULL);
+    controld_track_cib_call(call_id);
     if (call_id < 0) {
         crm_perror(LOG_ERR, "%s CIB node state update", node_name);
     }
@@ -854,7 +856,9 @@ remote_ra_data_init(lrm_state_t * lrm_state)
     }
 
     ra_data = calloc(1, sizeof(remote_ra_data_t));
-    ra_data->work = mainloop_add_trigger(G_PRIORITY_HIGH, handle_remote_ra_exec, lrm_state);
+    ra_data->work = pcmk__mainloop_add_named_trigger("remote-ra", G_PRIORITY_HIGH,
+                                                     handle_remote_ra_exec,
+                                                     lrm_state);
     lrm_state->remote_ra_data = ra_data;
 }
 
@@ -1228,6 +1232,7 @@ remote_ra_maintenance(lrm_state_t * lrm_state, gboolean maintenance)
                                      __FUNCTION__);
     crm_xml_add(state, XML_NODE_IS_MAINTENANCE, maintenance?"1":"0");
     fsa_cib_update(XML_CIB_TAG_STATUS, update, call_opt, call_id, NULL);
+    controld_track_cib_call(call_id);
     if (call_id < 0) {
         crm_perror(LOG_WARNING, "%s CIB node state update failed", lrm_state->node_name);
     } else {
@@ -11,6 +11,8 @@
 
 #include <unistd.h>  /* pid_t, sleep, ssize_t */
 
+#include <qb/qbutil.h>
+
 #include <crm/cib.h>
 #include <crm/cluster.h>
 #include <crm/common/xml.h>
@@ -21,6 +23,194 @@
 
 static mainloop_io_t *pe_subsystem = NULL;
 
+/* Scheduler input session
+ *
+ * Rather than query the full CIB and send it to the scheduler for every
+ * transition, the DC keeps its own replica of the CIB (updated from CIB diff
+ * notifications, the same way crm_mon does). The replica is used only while
+ * none of the controller's own CIB calls are pending (each asynchronous call is
+ * tracked, see controld_track_cib_call()), since their diff notifications may
+ * not have arrived yet. Once the scheduler has confirmed that it is keeping a
+ * replica of the last input it was sent, the DC sends only a v2 patchset
+ * against that input, keyed by its CIB version and carrying a digest of the
+ * intended result. Any divergence is detected there, and the scheduler asks
+ * for the full input again.
+ */
+static xmlNode *sched_cib = NULL;           // DC's replica of the CIB
+static xmlNode *sched_last_input = NULL;    // Last input sent to scheduler
+static bool sched_has_replica = FALSE;      // Scheduler has sched_last_input
+
+static uint64_t sched_sent_ns = 0;          // When current request was sent
+static guint sched_runtime_ms = 0;          // Smoothed scheduler response time
+
+/* Speculative scheduler runs
+ *
+ * Once a transition has been aborted, no new actions are initiated, but the
+ * next transition cannot be calculated until the actions already in flight
+ * complete. If enabled, the DC instead asks the scheduler right away for a
+ * transition based on the CIB as it will look if those actions succeed. If
+ * they all do, nothing else aborts the transition in the meantime, and the
+ * results recorded in the CIB match the predicted ones, the DC asks the
+ * scheduler to adopt the speculative result once the transition completes.
+ * Otherwise, the speculative result is discarded, and the scheduler is invoked
+ * as usual. The scheduler saves the input and uses up a transition ID only for
+ * an adopted result.
+ */
+static bool sched_speculate = FALSE;        // From cluster options
+
+struct prediction_s {
+    char *node_uuid;    // Node that action was executed on
+    char *rsc_id;       // Resource that action is for
+    xmlNode *op;        // Predicted resource history entry
+};
+
+static struct speculation_s {
+    int graph_id;       // Transition most recently speculated on
+    char *ref;          // Reference of speculative request
+    uint64_t sent_ns;   // When speculative request was sent
+    GList *actions;     // IDs of actions assumed to succeed
+    GList *predicted;   // Predicted results (struct prediction_s *)
+} speculation = { -1, NULL, 0, NULL, NULL };
+
+static void
+sched_session_reset(void)
+{
+    free_xml(sched_last_input);
+    sched_last_input = NULL;
+    sched_has_replica = FALSE;
+}
+
+static void
+sched_cib_reset(void)
+{
+    free_xml(sched_cib);
+    sched_cib = NULL;
+}
+
+static void
+free_prediction(gpointer data)
+{
+    struct prediction_s *prediction = data;
+
+    free(prediction->node_uuid);
+    free(prediction->rsc_id);
+    free_xml(prediction->op);
+    free(prediction);
+}
+
+static void
+speculation_reset(void)
+{
+    free(speculation.ref);
+    speculation.ref = NULL;
+    g_list_free(speculation.actions);
+    speculation.actions = NULL;
+    g_list_free_full(speculation.predicted, free_prediction);
+    speculation.predicted = NULL;
+}
+
+/*!
+ * \internal
+ * \brief Apply a CIB diff notification to the DC's CIB replica (if any)
+ *
+ * \param[in] msg  CIB diff notification
+ */
+void
+controld_sched_cib_updated(xmlNode *msg)
+{
+    xmlNode *patchset = NULL;
+    int rc = pcmk_ok;
+
+    if (sched_cib == NULL) {
+        return;
+
+    } else if (AM_I_DC == FALSE) {
+        sched_cib_reset();
+        return;
+    }
+
+    patchset = get_message_xml(msg, F_CIB_UPDATE_RESULT);
+    if (patchset == NULL) {
+        return;
+    }
+
+    rc = xml_apply_patchset(sched_cib, patchset, TRUE);
+    if (rc != pcmk_ok) {
+        // The next scheduler run will query the full CIB instead
+        crm_debug("Discarding CIB replica for scheduler: %s " CRM_XS " rc=%d",
+                  pcmk_strerror(rc), rc);
+        sched_cib_reset();
+    }
+}
+
+/*!
+ * \internal
+ * \brief Get the DC's replica of the CIB, if it is known to be current
+ *
+ * \return CIB replica, or NULL if there is none or our own CIB updates are
+ *         still in flight
+ */
+xmlNode *
+controld_sched_cib_replica(void)
+{
+    return (num_cib_op_callbacks() > 0)? NULL : sched_cib;
+}
+
+/*!
+ * \internal
+ * \brief Discard the DC's replica of the CIB
+ *
+ * This is needed when a change to the CIB may have been missed, so that the
+ * next scheduler run queries the full CIB instead.
+ */
+void
+controld_sched_cib_discard(void)
+{
+    if (sched_cib != NULL) {
+        crm_debug("Discarding CIB replica for scheduler");
+        sched_cib_reset();
+    }
+}
+
+/*!
+ * \internal
+ * \brief Check a scheduler reply for a session resynchronization request
+ *
+ * \param[in] reply  Reply to scheduler request
+ *
+ * \return FALSE if the scheduler could not use our input (and has been asked
+ *         again with the full input), otherwise TRUE
+ */
+bool
+controld_sched_reply_ok(xmlNode *reply)
+{
+    if (sched_sent_ns > 0) {
+        guint elapsed_ms = (guint) ((qb_util_nano_current_get() - sched_sent_ns)
+                                    / QB_TIME_NS_IN_MSEC);
+
+        // Weight the newest sample at 1/4, so one slow run doesn't dominate
+        if (sched_runtime_ms == 0) {
+            sched_runtime_ms = elapsed_ms;
+        } else {
+            sched_runtime_ms = (3 * sched_runtime_ms + elapsed_ms) / 4;
+        }
+        sched_sent_ns = 0;
+        crm_trace("Scheduler replied after %ums (average %ums)",
+                  elapsed_ms, sched_runtime_ms);
+    }
+
+    if (crm_is_true(crm_element_value(reply, F_CRM_SCHED_RESYNC))) {
+        crm_info("Scheduler could not apply input changes, resending in full");
+        sched_session_reset();
+        controld_expect_sched_reply(NULL);
+        register_fsa_action(A_PE_INVOKE);
+        return FALSE;
+    }
+    sched_has_replica = crm_is_true(crm_element_value(reply,
+                                                      F_CRM_SCHED_REPLICA));
+    return TRUE;
+}
+
 /*!
  * \internal
  * \brief Close any scheduler connection and free associated memory
@@ -29,6 +219,9 @@ void
 pe_subsystem_free(void)
 {
     clear_bit(fsa_input_register, R_PE_REQUIRED);
+    sched_session_reset();
+    sched_cib_reset();
+    speculation_reset();
     if (pe_subsystem) {
         controld_expect_sched_reply(NULL);
         mainloop_del_ipc_client(pe_subsystem);
@@ -83,6 +276,8 @@ pe_ipc_destroy(gpointer user_data)
 {
     // If we aren't connected to the scheduler, we can't expect a reply
     controld_expect_sched_reply(NULL);
+    sched_session_reset();
+    speculation_reset();
 
     if (is_set(fsa_input_register, R_PE_REQUIRED)) {
         int rc = pcmk_ok;
@@ -152,7 +347,7 @@ pe_subsystem_new()
 
     set_bit(fsa_input_register, R_PE_REQUIRED);
     pe_subsystem = mainloop_add_ipc_client(CRM_SYSTEM_PENGINE,
-                                           G_PRIORITY_DEFAULT,
+                                           PCMK__PRIORITY_BULK,
                                            5 * 1024 * 1024 /* 5MB */,
                                            NULL, &pe_callbacks);
     if (pe_subsystem == NULL) {
@@ -189,6 +384,9 @@ pe_subsystem_send(xmlNode *cmd)
 
 static void do_pe_invoke_callback(xmlNode *msg, int call_id, int rc,
                                   xmlNode *output, void *user_data);
+static void invoke_scheduler(xmlNode *input);
+static void prepare_scheduler_input(xmlNode *input);
+static xmlNode *send_scheduler_input(xmlNode *input, bool speculative);
 
 /*	 A_PE_START, A_PE_STOP, O_PE_RESTART	*/
 void
@@ -257,19 +455,15 @@ controld_stop_sched_timer()
 
 /*!
  * \internal
- * \brief Set the scheduler request currently being waited on
+ * \brief Set the scheduler request reference currently being waited on
  *
- * \param[in] msg  Request to expect reply to (or NULL for none)
+ * \param[in] ref  Reference of request to expect reply to (or NULL for none),
+ *                 which will be freed when no longer needed
  */
-void
-controld_expect_sched_reply(xmlNode *msg)
+static void
+expect_sched_ref(char *ref)
 {
-    char *ref = NULL;
-
-    if (msg) {
-        ref = crm_element_value_copy(msg, XML_ATTR_REFERENCE);
-        CRM_ASSERT(ref != NULL);
-
+    if (ref) {
         if (controld_sched_timer == NULL) {
             controld_sched_timer = mainloop_timer_add("scheduler_reply_timer",
                                                       SCHED_TIMEOUT_MS, FALSE,
@@ -277,13 +471,46 @@ controld_expect_sched_reply(xmlNode *msg)
                                                       NULL);
         }
         mainloop_timer_start(controld_sched_timer);
+        sched_sent_ns = qb_util_nano_current_get();
     } else {
         controld_stop_sched_timer();
+        sched_sent_ns = 0;
     }
     free(fsa_pe_ref);
     fsa_pe_ref = ref;
 }
 
+/*!
+ * \internal
+ * \brief Set the scheduler request currently being waited on
+ *
+ * \param[in] msg  Request to expect reply to (or NULL for none)
+ */
+void
+controld_expect_sched_reply(xmlNode *msg)
+{
+    char *ref = NULL;
+
+    if (msg) {
+        ref = crm_element_value_copy(msg, XML_ATTR_REFERENCE);
+        CRM_ASSERT(ref != NULL);
+    }
+    expect_sched_ref(ref);
+}
+
+/*!
+ * \internal
+ * \brief Get how long the scheduler typically takes to answer a request
+ *
+ * \return Smoothed time (in milliseconds) between sending the scheduler a
+ *         request and getting its reply (or 0 if not yet known)
+ */
+guint
+controld_sched_runtime(void)
+{
+    return sched_runtime_ms;
+}
+
 /*!
  * \internal
  * \brief Free the scheduler reply timer
@@ -297,6 +524,387 @@ controld_free_sched_timer()
     }
 }
 
+/*!
+ * \internal
+ * \brief Enable or disable speculative scheduler runs
+ *
+ * \param[in] value  Value of speculative-transitions cluster option
+ */
+void
+controld_sched_set_speculation(const char *value)
+{
+    sched_speculate = crm_is_true(value);
+    if (!sched_speculate) {
+        speculation_reset();
+    }
+}
+
+/*!
+ * \internal
+ * \brief Discard any speculative scheduler run
+ *
+ * This should be called whenever the current transition is aborted, because
+ * the speculative input can no longer be assumed to match the CIB.
+ */
+void
+controld_sched_discard_speculation(void)
+{
+    if (speculation.ref != NULL) {
+        crm_info("Discarding speculative transition calculation %s",
+                 speculation.ref);
+        speculation_reset();
+    }
+}
+
+/*!
+ * \internal
+ * \brief Add the expected result of an in-flight action to a CIB copy
+ *
+ * \param[in,out] cib        CIB copy to update
+ * \param[in]     action     In-flight action to assume succeeds
+ * \param[in,out] predicted  List to add predicted result to
+ *
+ * \return TRUE if the action's result could be predicted, otherwise FALSE
+ */
+static bool
+predict_action_result(xmlNode *cib, crm_action_t *action, GList **predicted)
+{
+    struct prediction_s *prediction = NULL;
+    const char *task = crm_element_value(action->xml, XML_LRM_ATTR_TASK);
+    const char *target = crm_element_value(action->xml, XML_LRM_ATTR_TARGET);
+    const char *target_uuid = crm_element_value(action->xml,
+                                                XML_LRM_ATTR_TARGET_UUID);
+    const char *target_rc_s = crm_meta_value(action->params,
+                                             XML_ATTR_TE_TARGET_RC);
+    int target_rc = (target_rc_s? crm_parse_int(target_rc_s, "0") : 0);
+    xmlNode *action_rsc = first_named_child(action->xml, XML_CIB_TAG_RESOURCE);
+    xmlNode *status = get_object_root(XML_CIB_TAG_STATUS, cib);
+    xmlNode *node_state = NULL;
+    xmlNode *parent = NULL;
+    xmlNode *rsc = NULL;
+    xmlNode *xml_op = NULL;
+    lrmd_event_data_t *op = NULL;
+
+    // Only resource actions with well-known history effects are predictable
+    if ((action->type != action_type_rsc) || (action_rsc == NULL)
+        || (task == NULL) || (target_uuid == NULL) || (status == NULL)) {
+        return FALSE;
+    }
+    if (safe_str_eq(task, RSC_NOTIFY)) {
+        return TRUE; // Notifications aren't recorded in the resource history
+    }
+    if (safe_str_neq(task, RSC_START) && safe_str_neq(task, RSC_STOP)
+        && safe_str_neq(task, RSC_STATUS) && safe_str_neq(task, RSC_PROMOTE)
+        && safe_str_neq(task, RSC_DEMOTE) && safe_str_neq(task, RSC_MIGRATE)
+        && safe_str_neq(task, RSC_MIGRATED)) {
+        return FALSE;
+    }
+
+    for (node_state = __xml_first_child_element(status); node_state != NULL;
+         node_state = __xml_next_element(node_state)) {
+        if (safe_str_eq(ID(node_state), target_uuid)) {
+            break;
+        }
+    }
+    if (node_state == NULL) {
+        return FALSE;
+    }
+
+    parent = first_named_child(node_state, XML_CIB_TAG_LRM);
+    if (parent == NULL) {
+        parent = create_xml_node(node_state, XML_CIB_TAG_LRM);
+        crm_xml_add(parent, XML_ATTR_ID, target_uuid);
+    }
+    rsc = first_named_child(parent, XML_LRM_TAG_RESOURCES);
+    if (rsc == NULL) {
+        rsc = create_xml_node(parent, XML_LRM_TAG_RESOURCES);
+    }
+    parent = rsc;
+    for (rsc = __xml_first_child_element(parent); rsc != NULL;
+         rsc = __xml_next_element(rsc)) {
+        if (safe_str_eq(ID(rsc), ID(action_rsc))) {
+            break;
+        }
+    }
+    if (rsc == NULL) {
+        rsc = create_xml_node(parent, XML_LRM_TAG_RESOURCE);
+        crm_xml_add(rsc, XML_ATTR_ID, ID(action_rsc));
+        crm_copy_xml_element(action_rsc, rsc, XML_ATTR_TYPE);
+        crm_copy_xml_element(action_rsc, rsc, XML_AGENT_ATTR_CLASS);
+        crm_copy_xml_element(action_rsc, rsc, XML_AGENT_ATTR_PROVIDER);
+
+    } else if ((action->interval_ms == 0) && safe_str_neq(task, RSC_STATUS)) {
+        /* The controller cancels recurring operations (removing their
+         * history) before changing a resource's state
+         */
+        xmlNode *xop = __xml_first_child_element(rsc);
+
+        while (xop != NULL) {
+            xmlNode *next = __xml_next_element(xop);
+            guint interval_ms = 0;
+
+            crm_element_value_ms(xop, XML_LRM_ATTR_INTERVAL_MS, &interval_ms);
+            if (interval_ms > 0) {
+                free_xml(xop);
+            }
+            xop = next;
+        }
+    }
+
+    op = convert_graph_action(rsc, action, PCMK_LRM_OP_DONE, target_rc);
+    if (op == NULL) {
+        return FALSE;
+    }
+    op->user_data = generate_transition_key(transition_graph->id, action->id,
+                                            target_rc, te_uuid);
+    xml_op = pcmk__create_history_xml(rsc, op, CRM_FEATURE_SET, target_rc,
+                                      target, __FUNCTION__, LOG_TRACE);
+    lrmd_free_event(op);
+    if (xml_op == NULL) {
+        return FALSE;
+    }
+
+    // Remember the prediction, to check against the recorded result
+    prediction = calloc(1, sizeof(struct prediction_s));
+    CRM_ASSERT(prediction != NULL);
+    prediction->node_uuid = strdup(target_uuid);
+    prediction->rsc_id = strdup(ID(action_rsc));
+    prediction->op = copy_xml(xml_op);
+    *predicted = g_list_prepend(*predicted, prediction);
+    return TRUE;
+}
+
+/*!
+ * \internal
+ * \brief Check whether a predicted action result is the one recorded
+ *
+ * \param[in] cib         CIB to check
+ * \param[in] prediction  Predicted result
+ *
+ * \return TRUE if \p cib has a history entry matching \p prediction,
+ *         otherwise FALSE
+ */
+static bool
+prediction_recorded(xmlNode *cib, struct prediction_s *prediction)
+{
+    const char *attrs[] = {
+        XML_LRM_ATTR_TASK,
+        XML_LRM_ATTR_INTERVAL_MS,
+        XML_ATTR_TRANSITION_KEY,
+        XML_LRM_ATTR_RC,
+        XML_LRM_ATTR_OPSTATUS,
+        XML_LRM_ATTR_OP_DIGEST,
+    };
+    char *xpath = crm_strdup_printf("//" XML_CIB_TAG_STATE
+                                    "[@" XML_ATTR_ID "='%s']"
+                                    "//" XML_LRM_TAG_RESOURCE
+                                    "[@" XML_ATTR_ID "='%s']"
+                                    "/" XML_LRM_TAG_RSC_OP
+                                    "[@" XML_ATTR_ID "='%s']",
+                                    prediction->node_uuid, prediction->rsc_id,
+                                    ID(prediction->op));
+    xmlNode *recorded = get_xpath_object(xpath, cib, LOG_TRACE);
+
+    free(xpath);
+    if (recorded == NULL) {
+        return FALSE;
+    }
+    for (int lpc = 0; lpc < DIMOF(attrs); lpc++) {
+        if (safe_str_neq(crm_element_value(recorded, attrs[lpc]),
+                         crm_element_value(prediction->op, attrs[lpc]))) {
+            crm_trace("Recorded %s for %s differs from prediction",
+                      attrs[lpc], ID(recorded));
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*!
+ * \internal
+ * \brief Calculate the next transition while an aborted one finishes
+ *
+ * If speculative runs are enabled, the current transition has been aborted,
+ * and it is only waiting for in-flight actions, ask the scheduler for the
+ * transition that should follow if those actions succeed.
+ */
+void
+controld_sched_speculate(void)
+{
+    xmlNode *input = NULL;
+    xmlNode *cmd = NULL;
+    GList *actions = NULL;
+    GList *predicted = NULL;
+
+    if (!sched_speculate || !AM_I_DC || (fsa_state != S_TRANSITION_ENGINE)
+        || (transition_graph == NULL) || transition_graph->complete
+        || (transition_graph->completion_action != tg_restart)
+        || (transition_graph->abort_priority < INFINITY)
+        || (transition_graph->id == speculation.graph_id)
+        || is_not_set(fsa_input_register, R_PE_CONNECTED)
+        || is_set(fsa_input_register, R_SHUTDOWN)
+        || (transition_timer->period_ms > 0)
+        || (sched_cib == NULL) || (num_cib_op_callbacks() > 0)) {
+        return;
+    }
+
+    // Try only once per transition, so event storms don't multiply runs
+    speculation_reset();
+    speculation.graph_id = transition_graph->id;
+
+    input = copy_xml(sched_cib);
+    for (GList *iter = transition_graph->synapses; iter; iter = iter->next) {
+        synapse_t *synapse = (synapse_t *) iter->data;
+
+        for (GList *iter2 = synapse->actions; iter2; iter2 = iter2->next) {
+            crm_action_t *action = (crm_action_t *) iter2->data;
+
+            if (!action->executed || action->confirmed) {
+                continue;
+            }
+            if (!predict_action_result(input, action, &predicted)) {
+                crm_debug("Not calculating next transition speculatively: "
+                          "cannot predict result of action %d", action->id);
+                g_list_free(actions);
+                g_list_free_full(predicted, free_prediction);
+                free_xml(input);
+                return;
+            }
+            actions = g_list_prepend(actions, GINT_TO_POINTER(action->id));
+        }
+    }
+    if (actions == NULL) {
+        g_list_free_full(predicted, free_prediction);
+        free_xml(input);
+        return;
+    }
+
+    prepare_scheduler_input(input);
+    cmd = send_scheduler_input(input, TRUE);
+    if (cmd == NULL) {
+        g_list_free(actions);
+        g_list_free_full(predicted, free_prediction);
+        return;
+    }
+
+    speculation.ref = crm_element_value_copy(cmd, XML_ATTR_REFERENCE);
+    speculation.sent_ns = qb_util_nano_current_get();
+    speculation.actions = actions;
+    speculation.predicted = predicted;
+    crm_info("Calculating transition to follow %d speculatively, assuming "
+             "in-flight actions succeed " CRM_XS " actions=%u ref=%s",
+             transition_graph->id, g_list_length(actions), speculation.ref);
+    free_xml(cmd);
+}
+
+/*!
+ * \internal
+ * \brief Handle a scheduler reply to a speculative request
+ *
+ * \param[in] reply  Scheduler reply
+ *
+ * \return TRUE if \p reply was for the current speculative request,
+ *         otherwise FALSE
+ */
+bool
+controld_sched_speculation_reply(xmlNode *reply)
+{
+    const char *ref = crm_element_value(reply, XML_ATTR_REFERENCE);
+
+    if ((speculation.ref == NULL) || safe_str_neq(ref, speculation.ref)) {
+        return FALSE;
+    }
+
+    if (crm_is_true(crm_element_value(reply, F_CRM_SCHED_RESYNC))) {
+        crm_info("Scheduler could not apply speculative input");
+        sched_session_reset();
+        speculation_reset();
+        return TRUE;
+    }
+    sched_has_replica = crm_is_true(crm_element_value(reply,
+                                                      F_CRM_SCHED_REPLICA));
+
+    crm_debug("Speculative transition calculation %s completed after %llums",
+              ref, (unsigned long long) ((qb_util_nano_current_get()
+                                          - speculation.sent_ns)
+                                         / QB_TIME_NS_IN_MSEC));
+    return TRUE;
+}
+
+/*!
+ * \internal
+ * \brief Use a speculative scheduler run as the current one, if still valid
+ *
+ * \return TRUE if the speculative run was used, otherwise FALSE
+ */
+static bool
+use_speculation(void)
+{
+    xmlNode *cib = controld_sched_cib_replica();
+    xmlNode *cmd = NULL;
+
+    if (speculation.ref == NULL) {
+        return FALSE;
+    }
+
+    // Every action assumed to succeed must have done so
+    for (GList *iter = speculation.actions; iter; iter = iter->next) {
+        int id = GPOINTER_TO_INT(iter->data);
+        crm_action_t *action = NULL;
+
+        if (transition_graph->id == speculation.graph_id) {
+            action = controld_get_action(id);
+        }
+        if ((action == NULL) || !action->confirmed || action->failed) {
+            crm_info("Discarding speculative transition calculation %s: "
+                     "action %d did not complete as expected",
+                     speculation.ref, id);
+            speculation_reset();
+            return FALSE;
+        }
+    }
+
+    // The results must have been recorded exactly as predicted
+    if (cib == NULL) {
+        crm_info("Discarding speculative transition calculation %s: "
+                 "CIB replica is not current", speculation.ref);
+        speculation_reset();
+        return FALSE;
+    }
+    for (GList *iter = speculation.predicted; iter; iter = iter->next) {
+        struct prediction_s *prediction = iter->data;
+
+        if (!prediction_recorded(cib, prediction)) {
+            crm_info("Discarding speculative transition calculation %s: "
+                     "recorded result of %s on %s differs from prediction",
+                     speculation.ref, ID(prediction->op),
+                     prediction->node_uuid);
+            speculation_reset();
+            return FALSE;
+        }
+    }
+
+    /* Ask the scheduler to use the held result (it will ask for the full input
+     * again if it no longer has it)
+     */
+    cmd = create_request(CRM_OP_PECALC, NULL, NULL, CRM_SYSTEM_PENGINE,
+                         CRM_SYSTEM_DC, NULL);
+    crm_xml_add(cmd, F_CRM_SCHED_ADOPT, speculation.ref);
+    if (pe_subsystem_send(cmd) < 0) {
+        free_xml(cmd);
+        speculation_reset();
+        return FALSE;
+    }
+
+    fsa_pe_query = 0;
+    controld_expect_sched_reply(cmd);
+    crm_info("Using speculative transition calculation %s " CRM_XS " ref=%s",
+             speculation.ref, fsa_pe_ref);
+    free_xml(cmd);
+    speculation_reset();
+    return TRUE;
+}
+
 /*	 A_PE_INVOKE	*/
 void
 do_pe_invoke(long long action,
@@ -336,6 +944,25 @@ do_pe_invoke(long long action,
         return;
     }
 
+    if (use_speculation()) {
+        return;
+    }
+
+    if ((sched_cib != NULL) && (num_cib_op_callbacks() == 0)) {
+        /* Our replica is up to date with everything we've been notified of,
+         * so skip the query (and make any outstanding one obsolete)
+         */
+        crm_debug("Using CIB replica %s.%s.%s for scheduler: %s",
+                  crm_element_value(sched_cib, XML_ATTR_GENERATION_ADMIN),
+                  crm_element_value(sched_cib, XML_ATTR_GENERATION),
+                  crm_element_value(sched_cib, XML_ATTR_NUMUPDATES),
+                  fsa_state2string(fsa_state));
+        fsa_pe_query = 0;
+        controld_expect_sched_reply(NULL);
+        invoke_scheduler(copy_xml(sched_cib));
+        return;
+    }
+
     fsa_pe_query = fsa_cib_conn->cmds->query(fsa_cib_conn, NULL, NULL, cib_scope_local);
 
     crm_debug("Query %d: Requesting the current CIB: %s", fsa_pe_query,
@@ -402,9 +1029,6 @@ force_local_option(xmlNode *xml, const char *attr_name, const char *attr_value)
 static void
 do_pe_invoke_callback(xmlNode * msg, int call_id, int rc, xmlNode * output, void *user_data)
 {
-    xmlNode *cmd = NULL;
-    pid_t watchdog = pcmk_locate_sbd();
-
     if (rc != pcmk_ok) {
         crm_err("Could not retrieve the Cluster Information Base: %s "
                 CRM_XS " rc=%d call=%d", pcmk_strerror(rc), rc, call_id);
@@ -439,30 +1063,140 @@ do_pe_invoke_callback(xmlNode * msg, int call_id, int rc, xmlNode * output, void
 
     CRM_LOG_ASSERT(output != NULL);
 
-    /* Refresh the remote node cache and the known node cache when the
-     * scheduler is invoked */
-    crm_peer_caches_refresh(output);
+    // Keep the result as a replica, so later runs can skip the query
+    sched_cib_reset();
+    sched_cib = copy_xml(output);
 
-    crm_xml_add(output, XML_ATTR_DC_UUID, fsa_our_uuid);
-    crm_xml_add_int(output, XML_ATTR_HAVE_QUORUM, fsa_has_quorum);
+    invoke_scheduler(copy_xml(output));
+}
 
-    force_local_option(output, XML_ATTR_HAVE_WATCHDOG, watchdog?"true":"false");
+/*!
+ * \internal
+ * \brief Add the DC's view of cluster state to a scheduler input
+ *
+ * \param[in,out] input  Copy of CIB to be sent to the scheduler
+ */
+static void
+prepare_scheduler_input(xmlNode *input)
+{
+    pid_t watchdog = pcmk_locate_sbd();
+
+    crm_xml_add(input, XML_ATTR_DC_UUID, fsa_our_uuid);
+    crm_xml_add_int(input, XML_ATTR_HAVE_QUORUM, fsa_has_quorum);
+
+    force_local_option(input, XML_ATTR_HAVE_WATCHDOG, watchdog?"true":"false");
 
     if (ever_had_quorum && crm_have_quorum == FALSE) {
-        crm_xml_add_int(output, XML_ATTR_QUORUM_PANIC, 1);
+        crm_xml_add_int(input, XML_ATTR_QUORUM_PANIC, 1);
     }
+}
 
-    cmd = create_request(CRM_OP_PECALC, output, NULL, CRM_SYSTEM_PENGINE, CRM_SYSTEM_DC, NULL);
+static void
+add_patchset_version(xmlNode *version, const char *name, xmlNode *cib)
+{
+    xmlNode *v = create_xml_node(version, name);
+
+    crm_xml_add(v, XML_ATTR_GENERATION_ADMIN,
+                crm_element_value(cib, XML_ATTR_GENERATION_ADMIN));
+    crm_xml_add(v, XML_ATTR_GENERATION,
+                crm_element_value(cib, XML_ATTR_GENERATION));
+    crm_xml_add(v, XML_ATTR_NUMUPDATES,
+                crm_element_value(cib, XML_ATTR_NUMUPDATES));
+}
+
+/*!
+ * \internal
+ * \brief Send the scheduler an input, as changes since the last one if possible
+ *
+ * \param[in] input        Prepared scheduler input (will be either kept as
+ *                         the session's last input or freed)
+ * \param[in] speculative  Whether scheduler should hold result until adopted
+ *
+ * \return Request that was sent (which the caller should free with
+ *         free_xml()), or NULL if it could not be sent
+ */
+static xmlNode *
+send_scheduler_input(xmlNode *input, bool speculative)
+{
+    int rc = pcmk_ok;
+    xmlNode *cmd = NULL;
+    xmlNode *patchset = NULL;
+
+    if (sched_has_replica && (sched_last_input != NULL)) {
+        // Send only what changed since the scheduler's last input
+        xml_calculate_changes(sched_last_input, input);
+        patchset = xml_create_patchset(2, sched_last_input, input, NULL, FALSE);
+        xml_accept_changes(input);
+
+        if (patchset == NULL) { // Nothing changed
+            xmlNode *version = NULL;
+
+            patchset = create_xml_node(NULL, XML_TAG_DIFF);
+            crm_xml_add_int(patchset, "format", 2);
+
+            // The scheduler checks which version the changes apply to
+            version = create_xml_node(patchset, XML_DIFF_VERSION);
+            add_patchset_version(version, XML_DIFF_VSOURCE, sched_last_input);
+            add_patchset_version(version, XML_DIFF_VTARGET, input);
+        }
+        patchset_process_digest(patchset, sched_last_input, input, TRUE);
+
+        cmd = create_request(CRM_OP_PECALC, patchset, NULL, CRM_SYSTEM_PENGINE,
+                             CRM_SYSTEM_DC, NULL);
+        free_xml(patchset);
+
+    } else {
+        cmd = create_request(CRM_OP_PECALC, input, NULL, CRM_SYSTEM_PENGINE,
+                             CRM_SYSTEM_DC, NULL);
+        crm_xml_add(cmd, F_CRM_SCHED_REPLICA, XML_BOOLEAN_TRUE);
+        sched_has_replica = FALSE;
+    }
+    if (speculative) {
+        crm_xml_add(cmd, F_CRM_SCHED_SPECULATIVE, XML_BOOLEAN_TRUE);
+    }
 
     rc = pe_subsystem_send(cmd);
     if (rc < 0) {
         crm_err("Could not contact the scheduler: %s " CRM_XS " rc=%d",
                 pcmk_strerror(rc), rc);
+        sched_session_reset();
+        free_xml(input);
+        free_xml(cmd);
+        return NULL;
+    }
+    free_xml(sched_last_input);
+    sched_last_input = input;
+    return cmd;
+}
+
+/*!
+ * \internal
+ * \brief Send the scheduler a request to calculate a transition
+ *
+ * \param[in] input  Copy of current CIB (will be modified, and either kept as
+ *                   the session's last input or freed)
+ */
+static void
+invoke_scheduler(xmlNode *input)
+{
+    xmlNode *cmd = NULL;
+
+    /* Refresh the remote node cache and the known node cache when the
+     * scheduler is invoked */
+    crm_peer_caches_refresh(input);
+
+    prepare_scheduler_input(input);
+
+    cmd = send_scheduler_input(input, FALSE);
+    if (cmd == NULL) {
         register_fsa_error_adv(C_FSA_INTERNAL, I_ERROR, NULL, NULL, __FUNCTION__);
-    } else {
-        controld_expect_sched_reply(cmd);
-        crm_debug("Invoking the scheduler: query=%d, ref=%s, seq=%llu, quorate=%d",
-                  fsa_pe_query, fsa_pe_ref, crm_peer_seq, fsa_has_quorum);
+        return;
     }
+
+    controld_expect_sched_reply(cmd);
+    crm_debug("Invoking the scheduler: query=%d, ref=%s, seq=%llu, "
+              "quorate=%d, input=%s",
+              fsa_pe_query, fsa_pe_ref, crm_peer_seq, fsa_has_quorum,
+              (sched_has_replica? "changes" : "full"));
     free_xml(cmd);
 }
@@ -489,10 +489,14 @@ te_should_perform_action_on(crm_graph_t * graph, crm_action_t * action, const ch
                   target, limit, r->jobs, id);
         return FALSE;
 
-    } else if(graph->migration_limit > 0 && r->migrate_jobs >= graph->migration_limit) {
-        if (safe_str_eq(task, CRMD_ACTION_MIGRATE) || safe_str_eq(task, CRMD_ACTION_MIGRATED)) {
+    } else if (safe_str_eq(task, CRMD_ACTION_MIGRATE)
+               || safe_str_eq(task, CRMD_ACTION_MIGRATED)) {
+        int migrate_limit = throttle_get_migration_limit(target,
+                                                         graph->migration_limit);
+
+        if ((migrate_limit > 0) && (r->migrate_jobs >= migrate_limit)) {
             crm_trace("Peer %s is over their migration job limit of %d (%d): deferring %s",
-                      target, graph->migration_limit, r->migrate_jobs, id);
+                      target, migrate_limit, r->migrate_jobs, id);
             return FALSE;
         }
     }
@@ -565,6 +569,7 @@ crm_graph_functions_t te_graph_fns = {
     te_crm_command,
     te_fence_node,
     te_should_perform_action,
+    controld_expected_op_duration,
 };
 
 void
@@ -597,10 +602,7 @@ notify_crmd(crm_graph_t * graph)
         case tg_restart:
             type = "restart";
             if (fsa_state == S_TRANSITION_ENGINE) {
-                if (transition_timer->period_ms > 0) {
-                    controld_stop_timer(transition_timer);
-                    controld_start_timer(transition_timer);
-                } else {
+                if (!controld_defer_pe_calc()) {
                     event = I_PE_CALC;
                 }
 
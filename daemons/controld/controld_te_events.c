@@ -87,7 +87,7 @@ fail_incompletable_actions(crm_graph_t * graph, const char *down_node)
 
     if (last_action != NULL) {
         crm_info("Node %s shutdown resulted in un-runnable actions", down_node);
-        abort_transition(INFINITY, tg_restart, "Node failure", last_action);
+        abort_transition_urgent(INFINITY, tg_restart, "Node failure", last_action);
         return TRUE;
     }
 
@@ -199,18 +199,7 @@ update_failcount(xmlNode * event, const char *event_node_uuid, int rc,
 crm_action_t *
 controld_get_action(int id)
 {
-    for (GList *item = transition_graph->synapses; item; item = item->next) {
-        synapse_t *synapse = (synapse_t *) item->data;
-
-        for (GList *item2 = synapse->actions; item2; item2 = item2->next) {
-            crm_action_t *action = (crm_action_t *) item2->data;
-
-            if (action->id == id) {
-                return action;
-            }
-        }
-    }
-    return NULL;
+    return find_graph_action(transition_graph, id);
 }
 
 crm_action_t *
@@ -445,6 +434,7 @@ process_graph_event(xmlNode *event, const char *event_node)
                 action->failed = TRUE;
             }
 
+            controld_record_op_duration(action, event);
             stop_te_timer(action->timer);
             te_action_confirmed(action, transition_graph);
 
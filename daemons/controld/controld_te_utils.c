@@ -8,9 +8,13 @@
  */
 
 #include <crm_internal.h>
+
+#include <qb/qbutil.h>
+
 #include <crm/crm.h>
 #include <crm/msg_xml.h>
 #include <crm/common/xml.h>
+#include <crm/common/trace_internal.h>
 
 #include <pacemaker-controld.h>
 
@@ -73,6 +77,7 @@ te_graph_trigger(gpointer user_data)
 
         } else if (graph_rc == transition_pending) {
             crm_trace("Transition not yet complete - no actions fired");
+            controld_sched_speculate();
             return TRUE;
         }
 
@@ -83,8 +88,11 @@ te_graph_trigger(gpointer user_data)
     }
 
     crm_debug("Transition %d is now complete", transition_graph->id);
+    pcmk__trace(pcmk__trace_transition_done, transition_graph->id,
+                transition_graph->completed, graph_rc);
     transition_graph->complete = TRUE;
     notify_crmd(transition_graph);
+    controld_save_op_stats(FALSE);
 
     return TRUE;
 }
@@ -136,6 +144,146 @@ abort_after_delay(int abort_priority, enum transition_action abort_action,
     abort_timer.id = g_timeout_add(delay_ms, abort_timer_popped, NULL);
 }
 
+/* Transition recomputation coalescing
+ *
+ * During an event storm (such as the loss of a node running many resources),
+ * each abort would otherwise start a new scheduler run that is superseded by
+ * the next abort before it even completes. When aborts are arriving faster
+ * than the scheduler can answer, wait about one scheduler run time before
+ * recomputing, so that a single run covers the whole burst. The window is
+ * started by the first abort and not extended by later ones, which bounds the
+ * added latency. Isolated aborts are never delayed, and fencing-relevant
+ * events skip the window entirely.
+ */
+#define COALESCE_MIN_MS     100     // Window to use if runtime not yet known
+#define COALESCE_MAX_MS     2000    // Longest window allowed
+#define COALESCE_MIN_RATE   2.0     // Aborts per second never treated as storm
+
+static struct coalesce_s {
+    uint64_t last_abort_ns; // When most recent abort was seen
+    double rate;            // Aborts seen in about the last second
+    bool urgent;            // Whether next recomputation must not be delayed
+    guint id;               // Window timer, if active
+} coalesce = { 0, };
+
+/*!
+ * \internal
+ * \brief Get the recent abort rate, decayed to the current time
+ *
+ * \param[in] now  Current monotonic time (in nanoseconds)
+ *
+ * \return Approximate number of aborts seen in the last second
+ */
+static double
+coalesce_abort_rate(uint64_t now)
+{
+    uint64_t elapsed_ms = (now - coalesce.last_abort_ns) / QB_TIME_NS_IN_MSEC;
+
+    if ((coalesce.last_abort_ns == 0) || (elapsed_ms >= 1000)) {
+        return 0.0;
+    }
+    return coalesce.rate * (1000 - elapsed_ms) / 1000.0;
+}
+
+static void
+coalesce_note_abort(void)
+{
+    uint64_t now = qb_util_nano_current_get();
+
+    coalesce.rate = coalesce_abort_rate(now) + 1.0;
+    coalesce.last_abort_ns = now;
+}
+
+static gboolean
+coalesce_timer_popped(gpointer data)
+{
+    coalesce.id = 0;
+    if (AM_I_DC) {
+        crm_debug("Recomputing transition after coalescing aborts");
+        register_fsa_input(C_TIMER_POPPED, I_PE_CALC, NULL);
+    }
+    return FALSE; // do not immediately reschedule timer
+}
+
+/*!
+ * \internal
+ * \brief Make the next transition recomputation skip any coalescing window
+ *
+ * This should be called for fencing-relevant events (node loss, fencing
+ * results, and quorum loss) before aborting the transition, because delaying
+ * recovery from those is riskier than an extra scheduler run.
+ */
+void
+controld_expedite_transition(void)
+{
+    coalesce.urgent = TRUE;
+}
+
+/*!
+ * \internal
+ * \brief Check whether a transition recomputation is waiting for a window
+ *
+ * \return TRUE if aborts are currently being coalesced, otherwise FALSE
+ */
+bool
+controld_pe_calc_coalescing(void)
+{
+    return coalesce.id != 0;
+}
+
+/*!
+ * \internal
+ * \brief Delay a needed transition recomputation, if appropriate
+ *
+ * \return TRUE if recomputation will happen when a timer pops, or FALSE if
+ *         the caller should request it immediately
+ */
+bool
+controld_defer_pe_calc(void)
+{
+    bool urgent = coalesce.urgent;
+    guint window_ms = 0;
+    double rate = 0.0;
+
+    coalesce.urgent = FALSE;
+
+    // A configured transition-delay applies under all conditions
+    if (transition_timer->period_ms > 0) {
+        controld_stop_timer(transition_timer);
+        controld_start_timer(transition_timer);
+        return TRUE;
+    }
+
+    if (urgent) {
+        if (coalesce.id != 0) {
+            crm_info("Recomputing transition now for fencing-relevant event");
+            g_source_remove(coalesce.id);
+            coalesce.id = 0;
+        }
+        return FALSE;
+    }
+
+    if (coalesce.id != 0) {
+        // This abort will be covered when the existing window closes
+        return TRUE;
+    }
+
+    /* A new run is likely to be superseded before it completes if at least
+     * one more abort is expected while the scheduler is working on it
+     */
+    window_ms = QB_MAX(controld_sched_runtime(), COALESCE_MIN_MS);
+    rate = coalesce_abort_rate(qb_util_nano_current_get());
+    if ((rate < COALESCE_MIN_RATE) || ((rate * window_ms) < 1000.0)) {
+        return FALSE;
+    }
+
+    window_ms = QB_MIN(window_ms, COALESCE_MAX_MS);
+    crm_info("Delaying transition recomputation %ums to coalesce aborts "
+             CRM_XS " rate=%.1f/s", window_ms, rate);
+    coalesce.id = g_timeout_add(window_ms, coalesce_timer_popped, NULL);
+    return TRUE;
+}
+
 void
 abort_transition_graph(int abort_priority, enum transition_action abort_action,
                        const char *abort_text, xmlNode * reason, const char *fn, int line)
@@ -164,7 +312,9 @@ abort_transition_graph(int abort_priority, enum transition_action abort_action,
     }
 
     abort_timer.aborted = TRUE;
+    coalesce_note_abort();
     controld_expect_sched_reply(NULL);
+    controld_sched_discard_speculation();
 
     if (transition_graph->complete == FALSE) {
         if(update_abort_priority(transition_graph, abort_priority, abort_action, abort_text)) {
@@ -281,10 +431,7 @@ abort_transition_graph(int abort_priority, enum transition_action abort_action,
     }
 
     if (transition_graph->complete) {
-        if (transition_timer->period_ms > 0) {
-            controld_stop_timer(transition_timer);
-            controld_start_timer(transition_timer);
-        } else {
+        if (!controld_defer_pe_calc()) {
             register_fsa_input(C_FSA_INTERNAL, I_PE_CALC, NULL);
         }
         return;
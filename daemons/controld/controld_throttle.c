@@ -12,6 +12,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include <stdint.h>
+#include <time.h>
 #include <unistd.h>
 #include <ctype.h>
 #include <dirent.h>
@@ -33,40 +35,95 @@ enum throttle_state_e {
 struct throttle_record_s {
     int max;
     enum throttle_state_e mode;
+    int limit;          // Load-derived job limit (0 if peer only sends mode)
+    int migrate_limit;  // Load-derived migration limit (0 for none)
     char *node;
 };
 
 static int throttle_job_max = 0;
 static float throttle_load_target = 0.0;
 
-#define THROTTLE_FACTOR_LOW    1.2
-#define THROTTLE_FACTOR_MEDIUM 1.6
-#define THROTTLE_FACTOR_HIGH   2.0
+// How often to sample load (and tell peers about any change)
+#define THROTTLE_INTERVAL_MS   (10 * 1000)
 
 static GHashTable *throttle_records = NULL;
 static mainloop_timer_t *throttle_timer = NULL;
 
 #if SUPPORT_PROCFS
-/*!
- * \internal
- * \brief Return name of /proc file containing the CIB daemon's load statistics
- *
- * \return Newly allocated memory with file name on success, NULL otherwise
+
+/* Load model
  *
- * \note It is the caller's responsibility to free the return value.
- *       This will return NULL if the daemon is being run via valgrind.
- *       This should be called only on Linux systems.
+ * Each signal below is sampled every time the throttle timer pops, normalized
+ * so its thresholds do not depend on the size of the host, and smoothed with
+ * an exponentially weighted moving average. Each signal then contributes a
+ * headroom between 1 (at or below its low threshold) and 0 (at or above its
+ * high threshold). The lowest headroom across all signals scales the node's
+ * job limit, and the lowest headroom across I/O-related signals scales its
+ * migration limit. New signals only need a sample function and an entry in
+ * throttle_signals[].
+ */
+
+#define THROTTLE_EWMA_WEIGHT 0.5    // Weight of newest sample
+
+struct throttle_signal_s;
+typedef bool (*throttle_sample_fn)(struct throttle_signal_s *signal,
+                                   float *value);
+
+struct throttle_signal_s {
+    const char *desc;           // Description of metric (for logging)
+    throttle_sample_fn sample;  // Get current value (normalized)
+    const char *path;           // File to sample (if any)
+    float low;                  // Value with full headroom
+    float high;                 // Value with no headroom
+    float extreme;              // Value indicating extreme load
+    bool migration;             // Whether signal limits migrations
+    bool uses_target;           // Whether disabled when load-threshold is 0
+
+    bool available;             // Whether last sample succeeded
+    float ewma;                 // Smoothed value (if available)
+    unsigned long long last_total;  // Last cumulative counter (if any)
+    uint64_t last_ns;           // When last_total was sampled
+};
+
+/* Pacemaker daemons are single-threaded, so any one of them can be maxed out
+ * (causing operations to fail or appear to fail) even though the overall
+ * system load is still reasonable. Track the CPU usage of each.
  */
-static char *
-find_cib_loadfile(void)
+static struct throttle_daemon_s {
+    const char *name;
+    int pid;
+    unsigned long long last_ticks;
+    uint64_t last_ns;
+} throttle_daemons[] = {
+    { "pacemaker-based" },
+    { "pacemaker-fenced" },
+    { "pacemaker-execd" },
+    { "pacemaker-attrd" },
+    { "pacemaker-schedulerd" },
+    { "pacemaker-controld" },
+    { "pacemakerd" },
+};
+
+static inline uint64_t
+throttle_now(void)
 {
-    int pid = crm_procfs_pid_of("pacemaker-based");
+    struct timespec ts;
 
-    return pid? crm_strdup_printf("/proc/%d/stat", pid) : NULL;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
 }
 
+/*!
+ * \internal
+ * \brief Get the CPU time used so far by a process
+ *
+ * \param[in]  pid    Process ID
+ * \param[out] ticks  Where to store user + system time (in clock ticks)
+ *
+ * \return TRUE on success, FALSE otherwise
+ */
 static bool
-throttle_cib_load(float *load)
+throttle_proc_ticks(int pid, unsigned long long *ticks)
 {
 /*
        /proc/[pid]/stat
@@ -80,189 +137,212 @@ throttle_cib_load(float *load)
 
               state %c    (3) One character from the string "RSDZTW" where R is running, S is sleeping in an interruptible wait, D is waiting in uninterruptible disk sleep, Z is zombie, T is traced or stopped (on a signal), and W is paging.
 
-              ppid %d     (4) The PID of the parent.
-
-              pgrp %d     (5) The process group ID of the process.
-
-              session %d  (6) The session ID of the process.
-
-              tty_nr %d   (7) The controlling terminal of the process.  (The minor device number is contained in the combination of bits 31 to 20 and 7 to 0; the major device number is in bits 15 to 8.)
-
-              tpgid %d    (8) The ID of the foreground process group of the controlling terminal of the process.
-
-              flags %u (%lu before Linux 2.6.22)
-                          (9) The kernel flags word of the process.  For bit meanings, see the PF_* defines in the Linux kernel source file include/linux/sched.h.  Details depend on the kernel version.
-
-              minflt %lu  (10) The number of minor faults the process has made which have not required loading a memory page from disk.
-
-              cminflt %lu (11) The number of minor faults that the process's waited-for children have made.
-
-              majflt %lu  (12) The number of major faults the process has made which have required loading a memory page from disk.
-
-              cmajflt %lu (13) The number of major faults that the process's waited-for children have made.
+              ... (fields 4 to 13)
 
               utime %lu   (14) Amount of time that this process has been scheduled in user mode, measured in clock ticks (divide by sysconf(_SC_CLK_TCK)).  This includes guest time, guest_time (time spent running a virtual CPU, see below), so that applications that are not aware of the guest time field do not lose that time from their calculations.
 
               stime %lu   (15) Amount of time that this process has been scheduled in kernel mode, measured in clock ticks (divide by sysconf(_SC_CLK_TCK)).
  */
-
-    static char *loadfile = NULL;
-    static time_t last_call = 0;
-    static long ticks_per_s = 0;
-    static unsigned long last_utime, last_stime;
-
-    char buffer[64*1024];
+    char path[64];
+    char buffer[1024];
+    char *fields = NULL;
     FILE *stream = NULL;
-    time_t now = time(NULL);
+    unsigned long utime = 0, stime = 0;
+    bool rc = FALSE;
 
-    if(load == NULL) {
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    stream = fopen(path, "r");
+    if (stream == NULL) {
         return FALSE;
-    } else {
-        *load = 0.0;
     }
 
-    if(loadfile == NULL) {
-        last_call = 0;
-        last_utime = 0;
-        last_stime = 0;
-        loadfile = find_cib_loadfile();
-        if (loadfile == NULL) {
-            crm_warn("Couldn't find CIB load file");
-            return FALSE;
+    if (fgets(buffer, sizeof(buffer), stream)) {
+        /* The command name may contain spaces, so start after its closing
+         * parenthesis, at the state field
+         */
+        fields = strrchr(buffer, ')');
+        if ((fields != NULL)
+            && (sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                       &utime, &stime) == 2)) {
+            *ticks = (unsigned long long) utime + stime;
+            rc = TRUE;
+        } else {
+            crm_err("Could not parse %s", path);
         }
-        ticks_per_s = sysconf(_SC_CLK_TCK);
-        crm_trace("Found %s", loadfile);
     }
+    fclose(stream);
+    return rc;
+}
 
-    stream = fopen(loadfile, "r");
-    if(stream == NULL) {
-        int rc = errno;
+/*!
+ * \internal
+ * \brief Sample the highest CPU usage of any Pacemaker daemon
+ *
+ * \param[in]  signal  Signal being sampled
+ * \param[out] value   Where to store highest usage, relative to the maximum
+ *                     a daemon should use
+ *
+ * \return TRUE if any daemon could be sampled, otherwise FALSE
+ */
+static bool
+throttle_sample_daemons(struct throttle_signal_s *signal, float *value)
+{
+    static long ticks_per_s = 0;
+    float daemon_max_cpu = 0.95;
+    bool found = FALSE;
+    uint64_t now = throttle_now();
 
-        crm_warn("Couldn't read %s: %s (%d)", loadfile, pcmk_strerror(rc), rc);
-        free(loadfile); loadfile = NULL;
-        return FALSE;
+    if (ticks_per_s <= 0) {
+        ticks_per_s = sysconf(_SC_CLK_TCK);
+    }
+    if (crm_procfs_num_cores() == 1) {
+        daemon_max_cpu = 0.4;
+    }
+    if ((throttle_load_target > 0.0) && (throttle_load_target < daemon_max_cpu)) {
+        daemon_max_cpu = throttle_load_target;
     }
 
-    if(fgets(buffer, sizeof(buffer), stream)) {
-        char *comm = calloc(1, 256);
-        char state = 0;
-        int rc = 0, pid = 0, ppid = 0, pgrp = 0, session = 0, tty_nr = 0, tpgid = 0;
-        unsigned long flags = 0, minflt = 0, cminflt = 0, majflt = 0, cmajflt = 0, utime = 0, stime = 0;
-
-        rc = sscanf(buffer,  "%d %[^ ] %c %d %d %d %d %d %lu %lu %lu %lu %lu %lu %lu",
-                    &pid, comm, &state,
-                    &ppid, &pgrp, &session, &tty_nr, &tpgid,
-                    &flags, &minflt, &cminflt, &majflt, &cmajflt, &utime, &stime);
-        free(comm);
-
-        if(rc != 15) {
-            crm_err("Only %d of 15 fields found in %s", rc, loadfile);
-            fclose(stream);
-            return FALSE;
-
-        } else if(last_call > 0
-           && last_call < now
-           && last_utime <= utime
-           && last_stime <= stime) {
-
-            time_t elapsed = now - last_call;
-            unsigned long delta_utime = utime - last_utime;
-            unsigned long delta_stime = stime - last_stime;
-
-            *load = (delta_utime + delta_stime); /* Cast to a float before division */
-            *load /= ticks_per_s;
-            *load /= elapsed;
-            crm_debug("cib load: %f (%lu ticks in %lds)", *load, delta_utime + delta_stime, (long)elapsed);
-
-        } else {
-            crm_debug("Init %lu + %lu ticks at %ld (%lu tps)", utime, stime, (long)now, ticks_per_s);
+    *value = 0.0;
+    for (int lpc = 0; lpc < DIMOF(throttle_daemons); lpc++) {
+        struct throttle_daemon_s *d = &throttle_daemons[lpc];
+        unsigned long long ticks = 0;
+
+        if (d->pid == 0) {
+            d->pid = safe_str_eq(d->name, crm_system_name)?
+                     getpid() : crm_procfs_pid_of(d->name);
+            d->last_ns = 0;
+            if (d->pid == 0) {
+                continue;
+            }
+        }
+        if (!throttle_proc_ticks(d->pid, &ticks)) {
+            crm_trace("%s is no longer process %d", d->name, d->pid);
+            d->pid = 0; // Look for it again next time
+            continue;
         }
 
-        last_call = now;
-        last_utime = utime;
-        last_stime = stime;
+        found = TRUE;
+        if ((d->last_ns > 0) && (now > d->last_ns) && (ticks >= d->last_ticks)) {
+            float cpu = (float) (ticks - d->last_ticks) / ticks_per_s
+                        / ((now - d->last_ns) / 1000000000.0);
 
-        fclose(stream);
-        return TRUE;
+            crm_trace("%s CPU usage: %f", d->name, cpu);
+            if ((cpu / daemon_max_cpu) > *value) {
+                *value = cpu / daemon_max_cpu;
+            }
+        }
+        d->last_ticks = ticks;
+        d->last_ns = now;
     }
-
-    fclose(stream);
-    return FALSE;
+    return found;
 }
 
+/*!
+ * \internal
+ * \brief Sample pressure stall information
+ *
+ * \param[in]  signal  Signal being sampled (with path of PSI file)
+ * \param[out] value   Where to store fraction of time that some tasks were
+ *                     stalled since last sample
+ *
+ * \return TRUE if pressure could be sampled, otherwise FALSE
+ */
 static bool
-throttle_load_avg(float *load)
+throttle_sample_psi(struct throttle_signal_s *signal, float *value)
 {
     char buffer[256];
     FILE *stream = NULL;
-    const char *loadfile = "/proc/loadavg";
+    unsigned long long total = 0;
+    uint64_t now = throttle_now();
+    bool found = FALSE;
 
-    if(load == NULL) {
-        return FALSE;
+    stream = fopen(signal->path, "r");
+    if (stream == NULL) {
+        return FALSE; // Kernel without PSI (or PSI disabled)
     }
 
-    stream = fopen(loadfile, "r");
-    if(stream == NULL) {
-        int rc = errno;
-        crm_warn("Couldn't read %s: %s (%d)", loadfile, pcmk_strerror(rc), rc);
+    // "some avg10=0.00 avg60=0.00 avg300=0.00 total=0" (total in microseconds)
+    while (!found && fgets(buffer, sizeof(buffer), stream)) {
+        const char *total_s = strstr(buffer, "total=");
+
+        if ((strncmp(buffer, "some ", 5) == 0) && (total_s != NULL)) {
+            total = strtoull(total_s + 6, NULL, 10);
+            found = TRUE;
+        }
+    }
+    fclose(stream);
+    if (!found) {
         return FALSE;
     }
 
-    if(fgets(buffer, sizeof(buffer), stream)) {
-        char *nl = strstr(buffer, "\n");
-
-        /* Grab the 1-minute average, ignore the rest */
-        *load = strtof(buffer, NULL);
-        if(nl) { nl[0] = 0; }
-
-        fclose(stream);
-        return TRUE;
+    *value = 0.0;
+    if ((signal->last_ns > 0) && (now > signal->last_ns)
+        && (total >= signal->last_total)) {
+        *value = (float) ((total - signal->last_total) * 1000)
+                 / (now - signal->last_ns);
     }
-
-    fclose(stream);
-    return FALSE;
+    signal->last_total = total;
+    signal->last_ns = now;
+    return TRUE;
 }
 
+static bool throttle_sample_load_avg(struct throttle_signal_s *signal,
+                                     float *value);
+
+/* *INDENT-OFF* */
+static struct throttle_signal_s throttle_signals[] = {
+    /* desc, sample, path, low, high, extreme, migration, uses_target */
+    { "daemon CPU load", throttle_sample_daemons, NULL,
+      0.8, 1.0, 1.5, FALSE, FALSE },
+    { "CPU pressure", throttle_sample_psi, "/proc/pressure/cpu",
+      0.2, 0.6, 0.9, FALSE, TRUE },
+    { "I/O pressure", throttle_sample_psi, "/proc/pressure/io",
+      0.2, 0.6, 0.9, TRUE, TRUE },
+    { "memory pressure", throttle_sample_psi, "/proc/pressure/memory",
+      0.05, 0.25, 0.5, TRUE, TRUE },
+    { "CPU load", throttle_sample_load_avg, "/proc/loadavg",
+      1.2, 2.0, 0.0 /* never extreme */, FALSE, TRUE },
+};
+/* *INDENT-ON* */
+
+#define THROTTLE_CPU_PRESSURE 1     // Index of CPU pressure in table
+
 /*!
  * \internal
- * \brief Check a load value against throttling thresholds
+ * \brief Sample the 1-minute load average (if CPU pressure is unavailable)
  *
- * \param[in] load        Load value to check
- * \param[in] desc        Description of metric (for logging)
- * \param[in] thresholds  Low/medium/high/extreme thresholds
+ * \param[in]  signal  Signal being sampled
+ * \param[out] value   Where to store load average, relative to the load target
  *
- * \return Throttle mode corresponding to load value
+ * \return TRUE if load average could be sampled, otherwise FALSE
  */
-static enum throttle_state_e
-throttle_check_thresholds(float load, const char *desc, float thresholds[4])
+static bool
+throttle_sample_load_avg(struct throttle_signal_s *signal, float *value)
 {
-    if (load > thresholds[3]) {
-        crm_notice("Extreme %s detected: %f", desc, load);
-        return throttle_extreme;
-
-    } else if (load > thresholds[2]) {
-        crm_notice("High %s detected: %f", desc, load);
-        return throttle_high;
-
-    } else if (load > thresholds[1]) {
-        crm_info("Moderate %s detected: %f", desc, load);
-        return throttle_med;
+    char buffer[256];
+    FILE *stream = NULL;
+    unsigned int cores = 0;
+    float normalize = 0.0;
+    float load = 0.0;
 
-    } else if (load > thresholds[0]) {
-        crm_debug("Noticeable %s detected: %f", desc, load);
-        return throttle_low;
+    if (throttle_signals[THROTTLE_CPU_PRESSURE].available) {
+        return FALSE; // Pressure is a better measure of CPU contention
     }
 
-    crm_trace("Negligible %s detected: %f", desc, load);
-    return throttle_none;
-}
+    stream = fopen(signal->path, "r");
+    if(stream == NULL) {
+        int rc = errno;
+        crm_warn("Couldn't read %s: %s (%d)", signal->path, pcmk_strerror(rc), rc);
+        return FALSE;
+    }
 
-static enum throttle_state_e
-throttle_handle_load(float load, const char *desc, int cores)
-{
-    float normalize;
-    float thresholds[4];
+    if(fgets(buffer, sizeof(buffer), stream) == NULL) {
+        fclose(stream);
+        return FALSE;
+    }
+    fclose(stream);
 
+    cores = crm_procfs_num_cores();
     if (cores == 1) {
         /* On a single core machine, a load of 1.0 is already too high */
         normalize = 0.6;
@@ -271,91 +351,167 @@ throttle_handle_load(float load, const char *desc, int cores)
         /* Normalize the load to be per-core */
         normalize = cores;
     }
-    thresholds[0] = throttle_load_target * normalize * THROTTLE_FACTOR_LOW;
-    thresholds[1] = throttle_load_target * normalize * THROTTLE_FACTOR_MEDIUM;
-    thresholds[2] = throttle_load_target * normalize * THROTTLE_FACTOR_HIGH;
-    thresholds[3] = load + 1.0; /* never extreme */
 
-    return throttle_check_thresholds(load, desc, thresholds);
+    /* Grab the 1-minute average, ignore the rest */
+    load = strtof(buffer, NULL);
+    crm_debug("Current load is %f across %u core(s)", load, cores);
+    *value = load / (throttle_load_target * normalize);
+    return TRUE;
 }
-#endif
 
-static enum throttle_state_e
-throttle_mode(void)
+/*!
+ * \internal
+ * \brief Calculate how much headroom a signal's smoothed value leaves
+ *
+ * \param[in] signal  Signal to check
+ *
+ * \return Headroom between 0.0 (none) and 1.0 (full)
+ */
+static float
+throttle_headroom(struct throttle_signal_s *signal)
 {
-#if SUPPORT_PROCFS
-    unsigned int cores;
-    float load;
-    float thresholds[4];
-    enum throttle_state_e mode = throttle_none;
+    if (!signal->available || (signal->ewma <= signal->low)) {
+        return 1.0;
+    } else if (signal->ewma >= signal->high) {
+        return 0.0;
+    }
+    return (signal->high - signal->ewma) / (signal->high - signal->low);
+}
 
-    cores = crm_procfs_num_cores();
-    if(throttle_cib_load(&load)) {
-        float cib_max_cpu = 0.95;
-
-        /* The CIB is a single-threaded task and thus cannot consume
-         * more than 100% of a CPU (and 1/cores of the overall system
-         * load).
-         *
-         * On a many-cored system, the CIB might therefore be maxed out
-         * (causing operations to fail or appear to fail) even though
-         * the overall system load is still reasonable.
-         *
-         * Therefore, the 'normal' thresholds can not apply here, and we
-         * need a special case.
-         */
-        if(cores == 1) {
-            cib_max_cpu = 0.4;
+/*!
+ * \internal
+ * \brief Sample all load signals and calculate this node's headroom
+ *
+ * \param[out] headroom          Where to store overall headroom
+ * \param[out] migrate_headroom  Where to store headroom for migrations
+ *
+ * \return TRUE if any signal indicates extreme load, otherwise FALSE
+ */
+static bool
+throttle_sample(float *headroom, float *migrate_headroom)
+{
+    bool extreme = FALSE;
+
+    *headroom = 1.0;
+    *migrate_headroom = 1.0;
+
+    for (int lpc = 0; lpc < DIMOF(throttle_signals); lpc++) {
+        struct throttle_signal_s *signal = &throttle_signals[lpc];
+        bool was_available = FALSE;
+        float value = 0.0;
+        float h = 1.0;
+
+        if (signal->uses_target && (throttle_load_target <= 0)) {
+            /* If we ever make this a valid value, the cluster will at least
+             * behave as expected
+             */
+            signal->available = FALSE;
+            continue;
         }
-        if(throttle_load_target > 0.0 && throttle_load_target < cib_max_cpu) {
-            cib_max_cpu = throttle_load_target;
+
+        was_available = signal->available;
+        signal->available = signal->sample(signal, &value);
+        if (!signal->available) {
+            continue;
+        }
+        if (!was_available) {
+            signal->ewma = value;
+        } else {
+            signal->ewma = THROTTLE_EWMA_WEIGHT * value
+                           + (1.0 - THROTTLE_EWMA_WEIGHT) * signal->ewma;
         }
 
-        thresholds[0] = cib_max_cpu * 0.8;
-        thresholds[1] = cib_max_cpu * 0.9;
-        thresholds[2] = cib_max_cpu;
-        /* Can only happen on machines with a low number of cores */
-        thresholds[3] = cib_max_cpu * 1.5;
+        h = throttle_headroom(signal);
+        if ((signal->extreme > 0.0) && (signal->ewma > signal->extreme)) {
+            crm_notice("Extreme %s detected: %f", signal->desc, signal->ewma);
+            extreme = TRUE;
 
-        mode |= throttle_check_thresholds(load, "CIB load", thresholds);
-    }
+        } else if (h < 1.0) {
+            crm_info("%s %s detected: %f (%.0f%% headroom)",
+                     ((h < 0.5)? "High" : "Moderate"), signal->desc,
+                     signal->ewma, h * 100.0);
 
-    if(throttle_load_target <= 0) {
-        /* If we ever make this a valid value, the cluster will at least behave as expected */
-        return mode;
-    }
+        } else {
+            crm_trace("Negligible %s detected: %f", signal->desc, signal->ewma);
+        }
 
-    if(throttle_load_avg(&load)) {
-        crm_debug("Current load is %f across %u core(s)", load, cores);
-        mode |= throttle_handle_load(load, "CPU load", cores);
+        *headroom = QB_MIN(*headroom, h);
+        if (signal->migration) {
+            *migrate_headroom = QB_MIN(*migrate_headroom, h);
+        }
     }
+    return extreme;
+}
+#endif // SUPPORT_PROCFS
 
-    if(mode & throttle_extreme) {
-        return throttle_extreme;
-    } else if(mode & throttle_high) {
-        return throttle_high;
-    } else if(mode & throttle_med) {
-        return throttle_med;
-    } else if(mode & throttle_low) {
-        return throttle_low;
+/*!
+ * \internal
+ * \brief Calculate this node's throttle mode and load-derived job limits
+ *
+ * \param[out] limit          Where to store job limit
+ * \param[out] migrate_limit  Where to store migration job limit (or 0 if
+ *                            migrations need no limit beyond the job limit)
+ *
+ * \return Throttle mode corresponding to current load (for peers that do not
+ *         understand load-derived limits)
+ */
+static enum throttle_state_e
+throttle_mode(int *limit, int *migrate_limit)
+{
+    enum throttle_state_e mode = throttle_none;
+    float headroom = 1.0;
+    float migrate_headroom = 1.0;
+
+#if SUPPORT_PROCFS
+    if (throttle_sample(&headroom, &migrate_headroom)) {
+        mode = throttle_extreme;
+        headroom = 0.0;
+    } else if (headroom < 0.25) {
+        mode = throttle_high;
+    } else if (headroom < 0.5) {
+        mode = throttle_med;
+    } else if (headroom < 1.0) {
+        mode = throttle_low;
     }
 #endif // SUPPORT_PROCFS
-    return throttle_none;
+
+    // At least one job must always be allowed
+    *limit = QB_MAX(1, (int) (throttle_job_max * headroom + 0.5));
+    *migrate_limit = 0;
+    if (migrate_headroom < 1.0) {
+        *migrate_limit = QB_MAX(1, (int) (*limit * migrate_headroom + 0.5));
+    }
+    return mode;
 }
 
 static void
-throttle_send_command(enum throttle_state_e mode)
+throttle_send_command(enum throttle_state_e mode, int limit, int migrate_limit)
 {
     xmlNode *xml = NULL;
     static enum throttle_state_e last = -1;
-
-    if(mode != last) {
-        crm_info("New throttle mode: %.4x (was %.4x)", mode, last);
+    static int last_limit = -1;
+    static int last_migrate_limit = -1;
+
+    /* Ignore small fluctuations in the job limit (unless it reaches either
+     * bound), to avoid flooding the cluster with throttle messages
+     */
+    bool limit_changed = (limit != last_limit)
+                         && ((abs(limit - last_limit) >= QB_MAX(1, throttle_job_max / 8))
+                             || (limit == 1) || (limit == throttle_job_max));
+
+    if ((mode != last) || limit_changed
+        || (migrate_limit != last_migrate_limit)) {
+        crm_info("New throttle mode: %.4x (was %.4x) " CRM_XS
+                 " jobs=%d migrations=%d", mode, last, limit, migrate_limit);
         last = mode;
+        last_limit = limit;
+        last_migrate_limit = migrate_limit;
 
         xml = create_request(CRM_OP_THROTTLE, NULL, NULL, CRM_SYSTEM_CRMD, CRM_SYSTEM_CRMD, NULL);
         crm_xml_add_int(xml, F_CRM_THROTTLE_MODE, mode);
         crm_xml_add_int(xml, F_CRM_THROTTLE_MAX, throttle_job_max);
+        crm_xml_add_int(xml, F_CRM_THROTTLE_LIMIT, limit);
+        crm_xml_add_int(xml, F_CRM_THROTTLE_MIGRATE, migrate_limit);
 
         send_cluster_message(NULL, crm_msg_crmd, xml, TRUE);
         free_xml(xml);
@@ -365,7 +521,11 @@ throttle_send_command(enum throttle_state_e mode)
 static gboolean
 throttle_timer_cb(gpointer data)
 {
-    throttle_send_command(throttle_mode());
+    int limit = 0;
+    int migrate_limit = 0;
+    enum throttle_state_e mode = throttle_mode(&limit, &migrate_limit);
+
+    throttle_send_command(mode, limit, migrate_limit);
     return TRUE;
 }
 
@@ -414,7 +574,8 @@ throttle_init(void)
     if(throttle_records == NULL) {
         throttle_records = g_hash_table_new_full(
             crm_str_hash, g_str_equal, NULL, throttle_record_free);
-        throttle_timer = mainloop_timer_add("throttle", 30 * 1000, TRUE, throttle_timer_cb, NULL);
+        throttle_timer = mainloop_timer_add("throttle", THROTTLE_INTERVAL_MS,
+                                            TRUE, throttle_timer_cb, NULL);
     }
 
     throttle_update_job_max(NULL);
@@ -492,6 +653,11 @@ throttle_get_job_limit(const char *node)
         g_hash_table_insert(throttle_records, r->node, r);
     }
 
+    if (r->limit > 0) {
+        // Peer calculated a limit from its load
+        return QB_MAX(1, QB_MIN(r->limit, r->max));
+    }
+
     switch(r->mode) {
         case throttle_extreme:
         case throttle_high:
@@ -513,10 +679,34 @@ throttle_get_job_limit(const char *node)
     return jobs;
 }
 
+/*!
+ * \internal
+ * \brief Get the maximum number of migrations a node should run at once
+ *
+ * \param[in] node        Name of node
+ * \param[in] configured  Value of migration-limit cluster option
+ *
+ * \return Migration limit for \p node (or 0 or less for no limit)
+ */
+int
+throttle_get_migration_limit(const char *node, int configured)
+{
+    struct throttle_record_s *r = g_hash_table_lookup(throttle_records, node);
+
+    if ((r == NULL) || (r->migrate_limit <= 0)) {
+        return configured;
+    } else if (configured > 0) {
+        return QB_MIN(configured, r->migrate_limit);
+    }
+    return r->migrate_limit;
+}
+
 void
 throttle_update(xmlNode *xml)
 {
     int max = 0;
+    int limit = 0;
+    int migrate_limit = 0;
     enum throttle_state_e mode = 0;
     struct throttle_record_s *r = NULL;
     const char *from = crm_element_value(xml, F_CRM_HOST_FROM);
@@ -524,6 +714,10 @@ throttle_update(xmlNode *xml)
     crm_element_value_int(xml, F_CRM_THROTTLE_MODE, (int*)&mode);
     crm_element_value_int(xml, F_CRM_THROTTLE_MAX, &max);
 
+    // Older peers send only the mode
+    crm_element_value_int(xml, F_CRM_THROTTLE_LIMIT, &limit);
+    crm_element_value_int(xml, F_CRM_THROTTLE_MIGRATE, &migrate_limit);
+
     r = g_hash_table_lookup(throttle_records, from);
 
     if(r == NULL) {
@@ -534,6 +728,8 @@ throttle_update(xmlNode *xml)
 
     r->max = max;
     r->mode = mode;
+    r->limit = limit;
+    r->migrate_limit = migrate_limit;
 
     crm_debug("Host %s supports a maximum of %d jobs and throttle mode %.4x.  New job limit is %d",
               from, max, mode, throttle_get_job_limit(from));
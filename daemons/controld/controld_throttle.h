@@ -25,3 +25,4 @@ void throttle_update(xmlNode *xml);
 void throttle_update_job_max(const char *preference);
 int throttle_get_job_limit(const char *node);
 int throttle_get_total_job_limit(int l);
+int throttle_get_migration_limit(const char *node, int configured);
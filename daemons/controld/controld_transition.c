@@ -12,6 +12,7 @@
 #include <crm/crm.h>
 #include <crm/msg_xml.h>
 #include <crm/common/xml.h>
+#include <crm/common/trace_internal.h>
 
 #include <pacemaker-controld.h>
 
@@ -47,6 +48,7 @@ do_te_control(long long action,
             destroy_graph(transition_graph);
             transition_graph = NULL;
         }
+        controld_free_op_stats();
 
         if (fsa_cib_conn) {
             fsa_cib_conn->cmds->del_notify_callback(fsa_cib_conn, T_CIB_DIFF_NOTIFY,
@@ -174,6 +176,11 @@ do_te_invoke(long long action,
             return;
         }
 
+        if (controld_pe_calc_coalescing()) {
+            crm_debug("Not running transition superseded by coalesced aborts");
+            return;
+        }
+
         CRM_CHECK(graph_data != NULL,
                   crm_err("Input raised by %s is invalid", msg_data->origin);
                   crm_log_xml_err(input->msg, "Bad command");
@@ -188,6 +195,9 @@ do_te_invoke(long long action,
         }
         crm_info("Processing graph %d (ref=%s) derived from %s", transition_graph->id, ref,
                  graph_input);
+        pcmk__trace(pcmk__trace_transition_start, transition_graph->id,
+                    transition_graph->num_synapses,
+                    transition_graph->num_actions);
 
         te_reset_job_counts();
         value = crm_element_value(graph_data, "failed-stop-offset");
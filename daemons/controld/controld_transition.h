@@ -46,6 +46,9 @@ void te_update_diff(const char *event, xmlNode *msg);
 extern void trigger_graph_processing(const char *fn, int line);
 void abort_after_delay(int abort_priority, enum transition_action abort_action,
                        const char *abort_text, guint delay_ms);
+void controld_expedite_transition(void);
+bool controld_defer_pe_calc(void);
+bool controld_pe_calc_coalescing(void);
 extern void abort_transition_graph(int abort_priority, enum transition_action abort_action,
                                    const char *abort_text, xmlNode * reason, const char *fn,
                                    int line);
@@ -54,6 +57,12 @@ extern void abort_transition_graph(int abort_priority, enum transition_action ab
 #  define abort_transition(pri, action, text, reason)			\
 	abort_transition_graph(pri, action, text, reason,__FUNCTION__,__LINE__);
 
+/* Abort, and recompute without waiting for further aborts to coalesce */
+#  define abort_transition_urgent(pri, action, text, reason) do {	\
+	controld_expedite_transition();					\
+	abort_transition_graph(pri, action, text, reason,__FUNCTION__,__LINE__); \
+    } while (0)
+
 extern crm_trigger_t *transition_trigger;
 
 extern char *failed_stop_offset;
@@ -62,4 +71,10 @@ extern char *failed_start_offset;
 void te_action_confirmed(crm_action_t *action, crm_graph_t *graph);
 void te_reset_job_counts(void);
 
+/* operation statistics */
+void controld_record_op_duration(crm_action_t *action, xmlNode *event);
+guint controld_expected_op_duration(crm_graph_t *graph, crm_action_t *action);
+void controld_save_op_stats(bool force);
+void controld_free_op_stats(void);
+
 #endif
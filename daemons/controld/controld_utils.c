@@ -10,6 +10,7 @@
 #include <crm_internal.h>
 
 #include <stdlib.h>
+#include <errno.h>
 
 #include <crm/crm.h>
 #include <crm/cib.h>
@@ -761,6 +762,38 @@ erase_xpath_callback(xmlNode * msg, int call_id, int rc, xmlNode * output, void
                         "Deletion of \"%s\": %s (rc=%d)", xpath, pcmk_strerror(rc), rc);
 }
 
+static void
+cib_call_tracked(xmlNode *msg, int call_id, int rc, xmlNode *output,
+                 void *user_data)
+{
+    if (rc == -ETIME) {
+        /* The change may still be made later, so the DC's CIB replica can't be
+         * known to include it
+         */
+        controld_sched_cib_discard();
+    }
+    crm_trace("CIB call %d completed: %s " CRM_XS " rc=%d",
+              call_id, pcmk_strerror(rc), rc);
+}
+
+/*!
+ * \internal
+ * \brief Track a CIB call whose result needs no other handling
+ *
+ * Every asynchronous CIB call the controller makes must be pending in the CIB
+ * library until its result arrives (which is after the resulting diff
+ * notification), so the DC knows when its CIB replica is current.
+ *
+ * \param[in] call_id  Call ID returned by CIB API (or error code)
+ */
+void
+controld_track_cib_call(int call_id)
+{
+    if (call_id > 0) {
+        fsa_register_cib_callback(call_id, FALSE, NULL, cib_call_tracked);
+    }
+}
+
 #define XPATH_STATUS_TAG "//node_state[@uname='%s']/%s"
 
 void
@@ -18,6 +18,8 @@
 
 #  define FAKE_TE_ID	"xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx"
 
+void controld_track_cib_call(int call_id);
+
 
 #  define fsa_cib_update(section, data, options, call_id, user_name)	\
 	if(fsa_cib_conn != NULL) {					\
@@ -36,7 +38,9 @@ fsa_cib_anon_update(const char *section, xmlNode *data) {
     } else {
         int opts = cib_scope_local | cib_quorum_override | cib_can_create;
 
-        fsa_cib_conn->cmds->modify(fsa_cib_conn, section, data, opts);
+        controld_track_cib_call(fsa_cib_conn->cmds->modify(fsa_cib_conn,
+                                                           section, data,
+                                                           opts));
     }
 }
 
@@ -60,6 +64,15 @@ void pe_subsystem_free(void);
 void controld_stop_sched_timer(void);
 void controld_free_sched_timer(void);
 void controld_expect_sched_reply(xmlNode *msg);
+void controld_sched_cib_updated(xmlNode *msg);
+xmlNode *controld_sched_cib_replica(void);
+void controld_sched_cib_discard(void);
+bool controld_sched_reply_ok(xmlNode *reply);
+guint controld_sched_runtime(void);
+void controld_sched_set_speculation(const char *value);
+void controld_sched_speculate(void);
+void controld_sched_discard_speculation(void);
+bool controld_sched_speculation_reply(xmlNode *reply);
 
 void fsa_dump_actions(long long action, const char *text);
 void fsa_dump_inputs(int log_level, const char *text, long long input_register);
@@ -145,6 +145,11 @@ crmd_init(void)
     fsa_input_register = 0;     /* zero out the regester */
 
     init_dotfile();
+
+    /* Keep fencing and membership traffic ahead of large CIB updates and
+     * scheduler replies (must be done before any connections are made)
+     */
+    pcmk__mainloop_enable_lanes();
     register_fsa_input(C_STARTUP, I_STARTUP, NULL);
 
     crm_peer_init();
@@ -18,6 +18,7 @@
 #include <crm/common/ipc.h>
 #include <crm/common/ipcs.h>
 #include <crm/msg_xml.h>
+#include <crm/common/trace_internal.h>
 
 #include "pacemaker-execd.h"
 
@@ -143,7 +144,8 @@ build_rsc_from_xml(xmlNode * msg)
     rsc->class = crm_element_value_copy(rsc_xml, F_LRMD_CLASS);
     rsc->provider = crm_element_value_copy(rsc_xml, F_LRMD_PROVIDER);
     rsc->type = crm_element_value_copy(rsc_xml, F_LRMD_TYPE);
-    rsc->work = mainloop_add_trigger(G_PRIORITY_HIGH, lrmd_rsc_dispatch, rsc);
+    rsc->work = pcmk__mainloop_add_named_trigger("execd-rsc", G_PRIORITY_HIGH,
+                                                 lrmd_rsc_dispatch, rsc);
     rsc->st_probe_rc = -ENODEV; // if stonith, initialize to "not running"
     return rsc;
 }
@@ -608,6 +610,8 @@ cmd_finalize(lrmd_cmd_t * cmd, lrmd_rsc_t * rsc)
 {
     crm_trace("Resource operation rsc:%s action:%s completed (%p %p)", cmd->rsc_id, cmd->action,
               rsc ? rsc->active : NULL, cmd);
+    pcmk__trace(pcmk__trace_exec_done, cmd->call_id, cmd->exec_rc,
+                cmd->lrmd_op_status);
 
     if (rsc && (rsc->active == cmd)) {
         rsc->active = NULL;
@@ -1363,6 +1367,8 @@ lrmd_rsc_execute(lrmd_rsc_t * rsc)
     }
 
     log_execute(cmd);
+    pcmk__trace(pcmk__trace_exec_start, cmd->call_id, cmd->interval_ms,
+                cmd->timeout);
 
     if (safe_str_eq(rsc->class, PCMK_RESOURCE_CLASS_STONITH)) {
         lrmd_rsc_execute_stonith(rsc, cmd);
@@ -125,6 +125,11 @@ lrmd_ipc_dispatch(qb_ipcs_connection_t * c, void *data, size_t size)
         return 0;
     }
 
+    if (pcmk__ipc_handle_stats_request(client, request, id, flags)) {
+        free_xml(request);
+        return 0;
+    }
+
     if (!client->name) {
         const char *value = crm_element_value(request, F_LRMD_CLIENTNAME);
 
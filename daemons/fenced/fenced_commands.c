@@ -646,6 +646,12 @@ get_agent_metadata(const char *agent)
         return NULL;
 
     } else if(buffer == NULL) {
+        // Meta-data cached on disk survives restarts of the fencer
+        buffer = pcmk__cached_agent_metadata(PCMK_RESOURCE_CLASS_STONITH,
+                                             NULL, agent);
+    }
+
+    if (buffer == NULL) {
         stonith_t *st = stonith_api_new();
         int rc;
 
@@ -660,6 +666,10 @@ get_agent_metadata(const char *agent)
             crm_err("Could not retrieve metadata for fencing agent %s", agent);
             return NULL;
         }
+        pcmk__cache_agent_metadata(PCMK_RESOURCE_CLASS_STONITH, NULL, agent,
+                                   buffer);
+    }
+    if (g_hash_table_lookup(metadata_cache, agent) != buffer) {
         g_hash_table_replace(metadata_cache, strdup(agent), buffer);
     }
 
@@ -884,7 +894,10 @@ build_device_from_xml(xmlNode * msg)
                  device->id, device->on_target_actions);
     }
 
-    device->work = mainloop_add_trigger(G_PRIORITY_HIGH, stonith_device_dispatch, device);
+    device->work = pcmk__mainloop_add_named_trigger("fenced-device",
+                                                    G_PRIORITY_HIGH,
+                                                    stonith_device_dispatch,
+                                                    device);
     /* TODO: Hook up priority */
 
     return device;
@@ -101,6 +101,11 @@ st_ipc_dispatch(qb_ipcs_connection_t * qbc, void *data, size_t size)
         return 0;
     }
 
+    if (pcmk__ipc_handle_stats_request(c, request, id, flags)) {
+        free_xml(request);
+        return 0;
+    }
+
 
     op = crm_element_value(request, F_CRM_TASK);
     if(safe_str_eq(op, CRM_OP_RM_NODE_CACHE)) {
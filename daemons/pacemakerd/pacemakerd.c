@@ -536,7 +536,10 @@ void
 pcmk_shutdown(int nsig)
 {
     if (shutdown_trigger == NULL) {
-        shutdown_trigger = mainloop_add_trigger(G_PRIORITY_HIGH, pcmk_shutdown_worker, NULL);
+        shutdown_trigger = pcmk__mainloop_add_named_trigger("shutdown",
+                                                             G_PRIORITY_HIGH,
+                                                             pcmk_shutdown_worker,
+                                                             NULL);
     }
     mainloop_set_trigger(shutdown_trigger);
 }
@@ -567,6 +570,11 @@ pcmk_ipc_dispatch(qb_ipcs_connection_t * qbc, void *data, size_t size)
     crm_client_t *c = crm_client_get(qbc);
     xmlNode *msg = crm_ipcs_recv(c, data, size, &id, &flags);
 
+    if (pcmk__ipc_handle_stats_request(c, msg, id, flags)) {
+        free_xml(msg);
+        return 0;
+    }
+
     crm_ipcs_send_ack(c, id, flags, "ack", __FUNCTION__, __LINE__);
     if (msg == NULL) {
         return 0;
@@ -661,6 +669,7 @@ update_process_clients(crm_client_t *client)
     if(client) {
         crm_trace("Sending process list to client %s", client->id);
         crm_ipcs_send(client, 0, update, crm_ipc_server_event);
+        pcmk__ipcs_reply_sent(client);
 
     } else {
         crm_trace("Sending process list to %d clients", crm_hash_table_size(client_connections));
@@ -1275,6 +1284,9 @@ main(int argc, char **argv)
     crm_ipc_close(old_instance);
     crm_ipc_destroy(old_instance);
 
+    // No cluster is running, so clean up after any that exited abnormally
+    pcmk__ipc_shm_sweep();
+
     if (mcp_read_config() == FALSE) {
         crm_notice("Could not obtain corosync config data, exiting");
         crm_exit(CRM_EX_UNAVAILABLE);
@@ -0,0 +1,363 @@
+/*
+ * Copyright 2019 the Pacemaker project contributors
+ *
+ * The version control history for this file may have further details.
+ *
+ * This source code is licensed under the GNU General Public License version 2
+ * or later (GPLv2+) WITHOUT ANY WARRANTY.
+ */
+
+#include <crm_internal.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <crm/crm.h>
+#include <crm/msg_xml.h>
+#include <crm/common/ipc.h>
+#include <crm/common/xml.h>
+
+/* Exercise the scheduler's input session protocol, the way the controller uses
+ * it: a full input that the scheduler keeps a replica of, followed by v2
+ * patchsets against that replica, with a resynchronization whenever the
+ * scheduler cannot apply a patchset.
+ */
+
+#define CONNECT_TIMEOUT_S   10
+#define REPLY_TIMEOUT_MS    60000
+
+/* *INDENT-OFF* */
+static struct crm_option long_options[] = {
+    {"help",     0, 0, '?', "\tThis text"},
+    {"version",  0, 0, '$', "\tVersion information"},
+    {"verbose",  0, 0, 'V', "\tIncrease debug output"},
+    {"xml-file", 1, 0, 'x', "Scheduler input to start the session with"},
+
+    {0, 0, 0, 0}
+};
+/* *INDENT-ON* */
+
+static crm_ipc_t *ipc = NULL;
+static xmlNode *last_input = NULL;  // Input the scheduler should have kept
+static int update = 0;              // Number of inputs changed so far
+
+/*!
+ * \internal
+ * \brief Wait for the scheduler's reply to a request
+ *
+ * \param[in] ref  Reference of request
+ *
+ * \return Reply (which the caller must free with free_xml()), or NULL if none
+ *         arrived in time
+ */
+static xmlNode *
+get_reply(const char *ref)
+{
+    struct pollfd pfd = { crm_ipc_get_fd(ipc), POLLIN, 0 };
+    int waited_ms = 0;
+
+    while (waited_ms < REPLY_TIMEOUT_MS) {
+        if (poll(&pfd, 1, 1000) <= 0) {
+            waited_ms += 1000;
+            continue;
+        }
+        while (crm_ipc_read(ipc) > 0) {
+            xmlNode *msg = string2xml(crm_ipc_buffer(ipc));
+
+            if (safe_str_eq(crm_element_value(msg, XML_ATTR_REFERENCE), ref)) {
+                return msg;
+            }
+            free_xml(msg);
+        }
+        if (crm_ipc_connected(ipc) == FALSE) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Send the scheduler a calculation request and wait for its reply
+ *
+ * \param[in] data  Full input or patchset
+ * \param[in] keep  Whether to ask the scheduler to keep a replica of \p data
+ *
+ * \return Reply (which the caller must free with free_xml()), or NULL if none
+ */
+static xmlNode *
+calculate(xmlNode *data, bool keep)
+{
+    xmlNode *cmd = create_request(CRM_OP_PECALC, data, NULL, CRM_SYSTEM_PENGINE,
+                                  crm_system_name, NULL);
+    xmlNode *reply = NULL;
+
+    if (keep) {
+        crm_xml_add(cmd, F_CRM_SCHED_REPLICA, XML_BOOLEAN_TRUE);
+    }
+    if (crm_ipc_send(ipc, cmd, 0, 0, NULL) > 0) {
+        reply = get_reply(crm_element_value(cmd, XML_ATTR_REFERENCE));
+    }
+    free_xml(cmd);
+    return reply;
+}
+
+/*!
+ * \internal
+ * \brief Create a patchset the way the controller does
+ *
+ * \param[in]     source  Input the changes are against
+ * \param[in,out] target  New input
+ *
+ * \return Newly created patchset
+ */
+static xmlNode *
+create_input_patchset(xmlNode *source, xmlNode *target)
+{
+    xmlNode *patchset = NULL;
+
+    xml_calculate_changes(source, target);
+    patchset = xml_create_patchset(2, source, target, NULL, FALSE);
+    xml_accept_changes(target);
+
+    if (patchset == NULL) {
+        xmlNode *version = NULL;
+        xmlNode *v = NULL;
+
+        patchset = create_xml_node(NULL, XML_TAG_DIFF);
+        crm_xml_add_int(patchset, "format", 2);
+        version = create_xml_node(patchset, XML_DIFF_VERSION);
+
+        v = create_xml_node(version, XML_DIFF_VSOURCE);
+        crm_copy_xml_element(source, v, XML_ATTR_GENERATION_ADMIN);
+        crm_copy_xml_element(source, v, XML_ATTR_GENERATION);
+        crm_copy_xml_element(source, v, XML_ATTR_NUMUPDATES);
+        v = create_xml_node(version, XML_DIFF_VTARGET);
+        crm_copy_xml_element(target, v, XML_ATTR_GENERATION_ADMIN);
+        crm_copy_xml_element(target, v, XML_ATTR_GENERATION);
+        crm_copy_xml_element(target, v, XML_ATTR_NUMUPDATES);
+    }
+    patchset_process_digest(patchset, source, target, TRUE);
+    return patchset;
+}
+
+/*!
+ * \internal
+ * \brief Make a new input by changing a cluster option and the version
+ *
+ * \param[in] base  Input to change
+ *
+ * \return Newly allocated changed copy of \p base
+ */
+static xmlNode *
+change_input(xmlNode *base)
+{
+    xmlNode *input = copy_xml(base);
+    xmlNode *section = first_named_child(input, XML_CIB_TAG_CONFIGURATION);
+    xmlNode *nvpair = NULL;
+    int num_updates = 0;
+
+    crm_element_value_int(input, XML_ATTR_NUMUPDATES, &num_updates);
+    crm_xml_add_int(input, XML_ATTR_NUMUPDATES, num_updates + 1);
+
+    if (first_named_child(section, XML_CIB_TAG_CRMCONFIG) == NULL) {
+        create_xml_node(section, XML_CIB_TAG_CRMCONFIG);
+    }
+    section = first_named_child(section, XML_CIB_TAG_CRMCONFIG);
+    section = create_xml_node(section, XML_CIB_TAG_PROPSET);
+    crm_xml_set_id(section, "cts-sched-helper-%d", ++update);
+    nvpair = create_xml_node(section, XML_CIB_TAG_NVPAIR);
+    crm_xml_set_id(nvpair, "cts-sched-helper-%d-nvpair", update);
+    crm_xml_add(nvpair, XML_NVPAIR_ATTR_NAME, "cts-sched-helper");
+    crm_xml_add_int(nvpair, XML_NVPAIR_ATTR_VALUE, update);
+    return input;
+}
+
+/*!
+ * \internal
+ * \brief Check a scheduler reply
+ *
+ * \param[in] reply   Reply to check (will be freed)
+ * \param[in] resync  Whether the scheduler should have asked for a resync
+ *
+ * \return TRUE if \p reply is as expected, otherwise FALSE
+ */
+static bool
+check_reply(xmlNode *reply, bool resync)
+{
+    bool ok = FALSE;
+
+    if (reply == NULL) {
+        crm_err("No reply from scheduler");
+
+    } else if (crm_is_true(crm_element_value(reply, F_CRM_SCHED_RESYNC))) {
+        ok = resync;
+        if (!ok) {
+            crm_err("Scheduler unexpectedly asked for full input");
+        }
+
+    } else if (resync) {
+        crm_err("Scheduler unexpectedly accepted input");
+
+    } else if (get_message_xml(reply, F_CRM_DATA) == NULL) {
+        crm_err("Scheduler reply has no transition graph");
+
+    } else if (!crm_is_true(crm_element_value(reply, F_CRM_SCHED_REPLICA))) {
+        crm_err("Scheduler did not keep a replica of its input");
+
+    } else {
+        ok = TRUE;
+    }
+    free_xml(reply);
+    return ok;
+}
+
+/*!
+ * \internal
+ * \brief Send an input in full, and expect it to be kept
+ *
+ * \param[in] input  Input to send (will be kept as the last input)
+ */
+static bool
+test_full(xmlNode *input)
+{
+    free_xml(last_input);
+    last_input = input;
+    return check_reply(calculate(input, TRUE), FALSE);
+}
+
+/*!
+ * \internal
+ * \brief Send an input as changes against a base, and check the result
+ *
+ * \param[in] base    Input the changes are against
+ * \param[in] input   Input to send (will be kept as the last input if
+ *                    accepted, otherwise freed)
+ * \param[in] resync  Whether the scheduler should ask for a resync
+ */
+static bool
+test_changes(xmlNode *base, xmlNode *input, bool resync)
+{
+    xmlNode *patchset = create_input_patchset(base, input);
+    bool ok = check_reply(calculate(patchset, FALSE), resync);
+
+    free_xml(patchset);
+    if (resync) {
+        free_xml(input);
+    } else {
+        free_xml(last_input);
+        last_input = input;
+    }
+    return ok;
+}
+
+#define run_test(desc, test) do {                                   \
+        if (test) {                                                 \
+            crm_info("SUCCESS - %s", (desc));                       \
+        } else {                                                    \
+            crm_err("FAILURE - %s", (desc));                        \
+            rc = CRM_EX_ERROR;                                      \
+        }                                                           \
+    } while (0)
+
+int
+main(int argc, char **argv)
+{
+    int argerr = 0;
+    int flag;
+    int option_index = 0;
+    int rc = CRM_EX_OK;
+    int verbose = 0;
+    const char *xml_file = NULL;
+    xmlNode *original = NULL;
+    xmlNode *base = NULL;
+
+    crm_log_cli_init("cts-sched-helper");
+    crm_set_options(NULL, "-x <file> [options]", long_options,
+                    "Test the scheduler's input session protocol"
+                    " against a running pacemaker-schedulerd");
+
+    while (1) {
+        flag = crm_get_option(argc, argv, &option_index);
+        if (flag == -1) {
+            break;
+        }
+
+        switch (flag) {
+            case 'V':
+                verbose = 1;
+                break;
+            case '$':
+            case '?':
+                crm_help(flag, CRM_EX_OK);
+                break;
+            case 'x':
+                xml_file = optarg;
+                break;
+            default:
+                ++argerr;
+                break;
+        }
+    }
+
+    crm_log_init(NULL, LOG_INFO, TRUE, (verbose? TRUE : FALSE), argc, argv,
+                 FALSE);
+
+    if ((xml_file == NULL) || (optind < argc)) {
+        ++argerr;
+    }
+    if (argerr) {
+        crm_help('?', CRM_EX_USAGE);
+    }
+
+    original = filename2xml(xml_file);
+    if (original == NULL) {
+        crm_err("Could not read scheduler input from %s", xml_file);
+        crm_exit(CRM_EX_NOINPUT);
+    }
+
+    ipc = crm_ipc_new(CRM_SYSTEM_PENGINE, 0);
+    for (int lpc = 0; !crm_ipc_connect(ipc); lpc++) {
+        if (lpc == CONNECT_TIMEOUT_S) {
+            crm_err("Could not connect to scheduler");
+            crm_exit(CRM_EX_UNAVAILABLE);
+        }
+        sleep(1);
+    }
+
+    run_test("Full input is kept", test_full(copy_xml(original)));
+
+    run_test("Changes apply to kept input",
+             test_changes(last_input, change_input(last_input), FALSE));
+
+    run_test("Unchanged input applies to kept input",
+             test_changes(last_input, copy_xml(last_input), FALSE));
+
+    // Changes against an older version must not be applied
+    run_test("Changes against another version cause resync",
+             test_changes(original, change_input(original), TRUE));
+
+    // The replica is dropped after a failed update, until a full input
+    run_test("Changes without kept input cause resync",
+             test_changes(last_input, change_input(last_input), TRUE));
+    run_test("Full input is kept after resync", test_full(copy_xml(original)));
+    run_test("Changes apply after resync",
+             test_changes(last_input, change_input(last_input), FALSE));
+
+    // Same version, but not the same content (as if a change were missed)
+    base = change_input(last_input);
+    crm_xml_add(base, XML_ATTR_NUMUPDATES,
+                crm_element_value(last_input, XML_ATTR_NUMUPDATES));
+    run_test("Changes against diverged input cause resync",
+             test_changes(base, change_input(base), TRUE));
+    free_xml(base);
+
+    free_xml(original);
+    free_xml(last_input);
+    crm_ipc_close(ipc);
+    crm_ipc_destroy(ipc);
+    crm_exit(rc);
+    return rc;
+}
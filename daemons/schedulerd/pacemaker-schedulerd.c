@@ -33,6 +33,12 @@ static GMainLoop *mainloop = NULL;
 static qb_ipcs_service_t *ipcs = NULL;
 static pe_working_set_t *sched_data_set = NULL;
 
+/* Where to save inputs and sequence numbers (overridable via the environment
+ * only so that regression tests can run a scheduler without touching the
+ * production state)
+ */
+static const char *state_dir = PE_STATE_DIR;
+
 #define get_series() 	was_processing_error?1:was_processing_warning?2:3
 
 typedef struct series_s {
@@ -50,12 +56,310 @@ series_t series[] = {
 
 void pengine_shutdown(int nsig);
 
+/*!
+ * \internal
+ * \brief Get the full input for a calculation request
+ *
+ * A client (i.e. the controller) may ask us to keep a replica of a full input,
+ * and then send later inputs as v2 patchsets against it. The replica is kept
+ * as the client's user data for as long as the connection lasts.
+ *
+ * \param[in]     msg       Calculation request
+ * \param[in]     xml_data  Data from \p msg (full CIB or patchset)
+ * \param[in,out] sender    Client that sent \p msg
+ *
+ * \return Full input to use, or NULL if a patchset could not be applied
+ */
+static xmlNode *
+sched_request_input(xmlNode *msg, xmlNode *xml_data, crm_client_t *sender)
+{
+    xmlNode *replica = sender->userdata;
+    int add[] = { 0, 0, 0 };
+    int del[] = { 0, 0, 0 };
+    int rc = pcmk_ok;
+
+    if (safe_str_neq(crm_element_name(xml_data), XML_TAG_DIFF)) {
+        free_xml(replica);
+        sender->userdata = NULL;
+        if (crm_is_true(crm_element_value(msg, F_CRM_SCHED_REPLICA))) {
+            sender->userdata = copy_xml(xml_data);
+        }
+        return xml_data;
+    }
+
+    if (replica == NULL) {
+        crm_info("Requesting full input from %s: no previous input to update",
+                 crm_client_name(sender));
+        return NULL;
+    }
+
+    /* The patchset must be based on exactly the CIB version we have. A
+     * patchset without versions (which has no changes) is taken to apply to
+     * the current version, since the digest check still guards against
+     * anything having been missed.
+     */
+    del[0] = crm_parse_int(crm_element_value(replica, XML_ATTR_GENERATION_ADMIN), "0");
+    del[1] = crm_parse_int(crm_element_value(replica, XML_ATTR_GENERATION), "0");
+    del[2] = crm_parse_int(crm_element_value(replica, XML_ATTR_NUMUPDATES), "0");
+    add[0] = del[0];
+    add[1] = del[1];
+    add[2] = del[2];
+    xml_patch_versions(xml_data, add, del);
+    if ((del[0] != crm_parse_int(crm_element_value(replica, XML_ATTR_GENERATION_ADMIN), "0"))
+        || (del[1] != crm_parse_int(crm_element_value(replica, XML_ATTR_GENERATION), "0"))
+        || (del[2] != crm_parse_int(crm_element_value(replica, XML_ATTR_NUMUPDATES), "0"))) {
+        rc = -pcmk_err_diff_resync;
+
+    } else {
+        // Versions may legitimately be unchanged, so rely on the digest
+        rc = xml_apply_patchset(replica, xml_data, FALSE);
+    }
+
+    if (rc != pcmk_ok) {
+        crm_info("Requesting full input from %s: could not apply changes "
+                 "to %d.%d.%d: %s " CRM_XS " rc=%d", crm_client_name(sender),
+                 del[0], del[1], del[2], pcmk_strerror(rc), rc);
+        free_xml(replica);
+        sender->userdata = NULL;
+        return NULL;
+    }
+    crm_trace("Updated input from %d.%d.%d to %d.%d.%d",
+              del[0], del[1], del[2], add[0], add[1], add[2]);
+    return replica;
+}
+
+/* Speculative calculations
+ *
+ * The controller may ask for the next transition before the current one has
+ * finished, based on the results it expects in-flight actions to have. Such a
+ * calculation is held here, without saving its input or using up a transition
+ * ID, until the controller either adopts it (once it has checked that the
+ * results it assumed were the ones recorded) or sends any other request (which
+ * discards it).
+ */
+static struct held_calc_s {
+    char *ref;              // Reference of speculative request
+    int transition_id;      // Transition ID used by calculation
+    xmlNode *input;         // Input to save if adopted
+    char *digest;           // Digest of input (or NULL if not processed)
+    xmlNode *graph;         // Calculated transition graph
+    int series_wrap;        // Number of inputs to keep in series
+    gboolean errors;        // Values of processing flags after calculation
+    gboolean warnings;
+    gboolean config_errors;
+    gboolean config_warnings;
+} held = { NULL, -1, NULL, NULL, NULL, 0, FALSE, FALSE, FALSE, FALSE };
+
+static char *last_digest = NULL;
+static char *filename = NULL;
+
+static void
+held_calc_reset(void)
+{
+    free(held.ref);
+    held.ref = NULL;
+    free_xml(held.input);
+    held.input = NULL;
+    free(held.digest);
+    held.digest = NULL;
+    free_xml(held.graph);
+    held.graph = NULL;
+}
+
+/*!
+ * \internal
+ * \brief Ask a client to send the full input for a calculation request
+ *
+ * \param[in] msg     Calculation request
+ * \param[in] sender  Client that sent \p msg
+ */
+static void
+send_resync_reply(xmlNode *msg, crm_client_t *sender)
+{
+    xmlNode *reply = create_reply(msg, NULL);
+
+    CRM_ASSERT(reply != NULL);
+    crm_xml_add(reply, F_CRM_SCHED_RESYNC, XML_BOOLEAN_TRUE);
+    crm_ipcs_send(sender, 0, reply, crm_ipc_server_event);
+    pcmk__ipcs_reply_sent(sender);
+    free_xml(reply);
+}
+
+/*!
+ * \internal
+ * \brief Get how many inputs to keep for the series of the last calculation
+ *
+ * \param[in] data_set  Cluster working set of the last calculation
+ *
+ * \return Number of inputs to keep (or 0 to keep none)
+ */
+static int
+get_series_wrap(pe_working_set_t *data_set)
+{
+    int series_id = get_series();
+    int series_wrap = series[series_id].wrap;
+    const char *value = pe_pref(data_set->config_hash,
+                                series[series_id].param);
+
+    if (value != NULL) {
+        series_wrap = crm_int_helper(value, NULL);
+        if (errno != 0) {
+            series_wrap = series[series_id].wrap;
+        }
+
+    } else {
+        crm_config_warn("No value specified for cluster"
+                        " preference: %s", series[series_id].param);
+    }
+    return series_wrap;
+}
+
+/*!
+ * \internal
+ * \brief Reply to a calculation request with a transition graph
+ *
+ * \param[in] msg       Calculation request
+ * \param[in] graph     Transition graph
+ * \param[in] filename  Where input is saved (or NULL if not saved)
+ * \param[in] sender    Client that sent \p msg
+ */
+static void
+send_graph_reply(xmlNode *msg, xmlNode *graph, const char *filename,
+                 crm_client_t *sender)
+{
+    xmlNode *reply = create_reply(msg, graph);
+
+    CRM_ASSERT(reply != NULL);
+    crm_xml_add(reply, F_CRM_TGRAPH_INPUT, filename);
+    crm_xml_add_int(reply, "graph-errors", was_processing_error);
+    crm_xml_add_int(reply, "graph-warnings", was_processing_warning);
+    crm_xml_add_int(reply, "config-errors", crm_config_error);
+    crm_xml_add_int(reply, "config-warnings", crm_config_warning);
+    crm_xml_add(reply, F_CRM_SCHED_REPLICA,
+                (sender->userdata? XML_BOOLEAN_TRUE : XML_BOOLEAN_FALSE));
+
+    if (crm_ipcs_send(sender, 0, reply, crm_ipc_server_event) == FALSE) {
+        int graph_file_fd = 0;
+        char *graph_file = NULL;
+        umask(S_IWGRP | S_IWOTH | S_IROTH);
+
+        graph_file = crm_strdup_printf("%s/pengine.graph.XXXXXX",
+                                       state_dir);
+        graph_file_fd = mkstemp(graph_file);
+
+        crm_err("Couldn't send transition graph to peer, writing to %s instead",
+                graph_file);
+
+        crm_xml_add(reply, F_CRM_TGRAPH, graph_file);
+        write_xml_fd(graph, graph_file, graph_file_fd, FALSE);
+
+        free(graph_file);
+        free_xml(first_named_child(reply, F_CRM_DATA));
+        CRM_ASSERT(crm_ipcs_send(sender, 0, reply, crm_ipc_server_event));
+    }
+    pcmk__ipcs_reply_sent(sender);
+    free_xml(reply);
+}
+
+/*!
+ * \internal
+ * \brief Reply with a calculated transition and save its input
+ *
+ * \param[in]     msg          Calculation request
+ * \param[in,out] input        Input that transition was calculated from
+ * \param[in]     digest       Digest of \p input, or NULL if it could not be
+ *                             processed (will be freed or kept)
+ * \param[in]     graph        Calculated transition graph
+ * \param[in]     series_wrap  Number of inputs to keep in series
+ * \param[in]     sender       Client that sent \p msg
+ */
+static void
+record_calculation(xmlNode *msg, xmlNode *input, char *digest, xmlNode *graph,
+                   int series_wrap, crm_client_t *sender)
+{
+    int series_id = get_series();
+    int seq = -1;
+    time_t execution_date = time(NULL);
+    gboolean is_repoke = FALSE;
+
+    if (digest == NULL) {
+        // Input could not be processed
+
+    } else if (safe_str_eq(digest, last_digest)) {
+        crm_info("Input has not changed since last time, not saving to disk");
+        is_repoke = TRUE;
+        free(digest);
+
+    } else {
+        free(last_digest);
+        last_digest = digest;
+    }
+
+    seq = get_last_sequence(state_dir, series[series_id].name);
+    crm_trace("Series %s: wrap=%d, seq=%d",
+              series[series_id].name, series_wrap, seq);
+
+    if (is_repoke == FALSE) {
+        free(filename);
+        filename = generate_series_filename(state_dir,
+                                            series[series_id].name, seq,
+                                            TRUE);
+    }
+
+    send_graph_reply(msg, graph, filename, sender);
+    pcmk__log_transition_summary(filename);
+
+    if (is_repoke == FALSE && series_wrap != 0) {
+        unlink(filename);
+        crm_xml_add_ll(input, "execution-date", (long long) execution_date);
+        write_xml_file(input, filename, TRUE);
+
+        // Don't let this leak into any replica kept for the next input
+        xml_remove_prop(input, "execution-date");
+        write_last_sequence(state_dir, series[series_id].name, seq + 1, series_wrap);
+    } else {
+        crm_trace("Not writing out %s: %d & %d", filename, is_repoke, series_wrap);
+    }
+}
+
+/*!
+ * \internal
+ * \brief Use a held speculative calculation as the current transition
+ *
+ * \param[in] msg     Adoption request
+ * \param[in] sender  Client that sent \p msg
+ */
+static void
+adopt_calculation(xmlNode *msg, crm_client_t *sender)
+{
+    const char *ref = crm_element_value(msg, F_CRM_SCHED_ADOPT);
+
+    if ((held.ref == NULL) || safe_str_neq(ref, held.ref)) {
+        crm_info("Requesting full input from %s: no speculative "
+                 "calculation %s to use", crm_client_name(sender), ref);
+        held_calc_reset();
+        send_resync_reply(msg, sender);
+        return;
+    }
+
+    // The calculation now takes the transition ID it would have used
+    pcmk__set_last_transition_id(held.transition_id);
+    was_processing_error = held.errors;
+    was_processing_warning = held.warnings;
+    crm_config_error = held.config_errors;
+    crm_config_warning = held.config_warnings;
+
+    crm_info("Using speculative calculation %s as transition %d",
+             held.ref, held.transition_id);
+    record_calculation(msg, held.input, held.digest, held.graph,
+                       held.series_wrap, sender);
+    held.digest = NULL; // Now freed or kept as last_digest
+    held_calc_reset();
+}
+
 static gboolean
 process_pe_message(xmlNode * msg, xmlNode * xml_data, crm_client_t * sender)
 {
-    static char *last_digest = NULL;
-    static char *filename = NULL;
-
     const char *sys_to = crm_element_value(msg, F_CRM_SYS_TO);
     const char *op = crm_element_value(msg, F_CRM_TASK);
     const char *ref = crm_element_value(msg, F_CRM_REFERENCE);
@@ -76,16 +380,27 @@ process_pe_message(xmlNode * msg, xmlNode * xml_data, crm_client_t * sender)
         return FALSE;
 
     } else if (strcasecmp(op, CRM_OP_PECALC) == 0) {
-        int seq = -1;
-        int series_id = 0;
+        int last_id = pcmk__last_transition_id();
         int series_wrap = 0;
         char *digest = NULL;
-        const char *value = NULL;
-        time_t execution_date = time(NULL);
         xmlNode *converted = NULL;
-        xmlNode *reply = NULL;
-        gboolean is_repoke = FALSE;
-        gboolean process = TRUE;
+        gboolean speculative = FALSE;
+
+        if (crm_element_value(msg, F_CRM_SCHED_ADOPT) != NULL) {
+            adopt_calculation(msg, sender);
+            return TRUE;
+        }
+
+        // Any other request makes a held calculation obsolete
+        held_calc_reset();
+        speculative = crm_is_true(crm_element_value(msg,
+                                                    F_CRM_SCHED_SPECULATIVE));
+
+        xml_data = sched_request_input(msg, xml_data, sender);
+        if (xml_data == NULL) {
+            send_resync_reply(msg, sender);
+            return TRUE;
+        }
 
         crm_config_error = FALSE;
         crm_config_warning = FALSE;
@@ -98,98 +413,46 @@ process_pe_message(xmlNode * msg, xmlNode * xml_data, crm_client_t * sender)
             CRM_ASSERT(sched_data_set != NULL);
         }
 
-        digest = calculate_xml_versioned_digest(xml_data, FALSE, FALSE, CRM_FEATURE_SET);
         converted = copy_xml(xml_data);
         if (cli_config_update(&converted, NULL, TRUE) == FALSE) {
             sched_data_set->graph = create_xml_node(NULL, XML_TAG_GRAPH);
             crm_xml_add_int(sched_data_set->graph, "transition_id", 0);
             crm_xml_add_int(sched_data_set->graph, "cluster-delay", 0);
-            process = FALSE;
-            free(digest);
-
-        } else if (safe_str_eq(digest, last_digest)) {
-            crm_info("Input has not changed since last time, not saving to disk");
-            is_repoke = TRUE;
-            free(digest);
 
         } else {
-            free(last_digest);
-            last_digest = digest;
-        }
-
-        if (process) {
+            digest = calculate_xml_versioned_digest(xml_data, FALSE, FALSE,
+                                                    CRM_FEATURE_SET);
             pcmk__schedule_actions(sched_data_set, converted, NULL);
         }
 
-        series_id = get_series();
-        series_wrap = series[series_id].wrap;
-        value = pe_pref(sched_data_set->config_hash, series[series_id].param);
-
-        if (value != NULL) {
-            series_wrap = crm_int_helper(value, NULL);
-            if (errno != 0) {
-                series_wrap = series[series_id].wrap;
-            }
-
-        } else {
-            crm_config_warn("No value specified for cluster"
-                            " preference: %s", series[series_id].param);
-        }
-
-        seq = get_last_sequence(PE_STATE_DIR, series[series_id].name);
-        crm_trace("Series %s: wrap=%d, seq=%d, pref=%s",
-                  series[series_id].name, series_wrap, seq, value);
-
+        series_wrap = get_series_wrap(sched_data_set);
         sched_data_set->input = NULL;
-        reply = create_reply(msg, sched_data_set->graph);
-        CRM_ASSERT(reply != NULL);
-
-        if (is_repoke == FALSE) {
-            free(filename);
-            filename = generate_series_filename(PE_STATE_DIR,
-                                                series[series_id].name, seq,
-                                                TRUE);
-        }
-
-        crm_xml_add(reply, F_CRM_TGRAPH_INPUT, filename);
-        crm_xml_add_int(reply, "graph-errors", was_processing_error);
-        crm_xml_add_int(reply, "graph-warnings", was_processing_warning);
-        crm_xml_add_int(reply, "config-errors", crm_config_error);
-        crm_xml_add_int(reply, "config-warnings", crm_config_warning);
-
-        if (crm_ipcs_send(sender, 0, reply, crm_ipc_server_event) == FALSE) {
-            int graph_file_fd = 0;
-            char *graph_file = NULL;
-            umask(S_IWGRP | S_IWOTH | S_IROTH);
-
-            graph_file = crm_strdup_printf("%s/pengine.graph.XXXXXX",
-                                           PE_STATE_DIR);
-            graph_file_fd = mkstemp(graph_file);
 
-            crm_err("Couldn't send transition graph to peer, writing to %s instead",
-                    graph_file);
+        if (speculative) {
+            held.ref = crm_element_value_copy(msg, F_CRM_REFERENCE);
+            held.transition_id = pcmk__last_transition_id();
+            held.input = copy_xml(xml_data);
+            held.digest = digest;
+            held.graph = sched_data_set->graph;
+            sched_data_set->graph = NULL;
+            held.series_wrap = series_wrap;
+            held.errors = was_processing_error;
+            held.warnings = was_processing_warning;
+            held.config_errors = crm_config_error;
+            held.config_warnings = crm_config_warning;
+
+            // Nothing is used up unless the calculation is adopted
+            pcmk__set_last_transition_id(last_id);
+            crm_debug("Holding speculative calculation %s of transition %d",
+                      held.ref, held.transition_id);
+            send_graph_reply(msg, held.graph, NULL, sender);
 
-            crm_xml_add(reply, F_CRM_TGRAPH, graph_file);
-            write_xml_fd(sched_data_set->graph, graph_file, graph_file_fd, FALSE);
-
-            free(graph_file);
-            free_xml(first_named_child(reply, F_CRM_DATA));
-            CRM_ASSERT(crm_ipcs_send(sender, 0, reply, crm_ipc_server_event));
-        }
-
-        free_xml(reply);
-        pe_reset_working_set(sched_data_set);
-        pcmk__log_transition_summary(filename);
-
-        if (is_repoke == FALSE && series_wrap != 0) {
-            unlink(filename);
-            crm_xml_add_ll(xml_data, "execution-date", (long long) execution_date);
-            write_xml_file(xml_data, filename, TRUE);
-            write_last_sequence(PE_STATE_DIR, series[series_id].name, seq + 1, series_wrap);
         } else {
-            crm_trace("Not writing out %s: %d & %d", filename, is_repoke, series_wrap);
+            record_calculation(msg, xml_data, digest, sched_data_set->graph,
+                               series_wrap, sender);
         }
 
+        pe_reset_working_set(sched_data_set);
         free_xml(converted);
     }
 
@@ -222,6 +485,11 @@ pe_ipc_dispatch(qb_ipcs_connection_t * qbc, void *data, size_t size)
     crm_client_t *c = crm_client_get(qbc);
     xmlNode *msg = crm_ipcs_recv(c, data, size, &id, &flags);
 
+    if (pcmk__ipc_handle_stats_request(c, msg, id, flags)) {
+        free_xml(msg);
+        return 0;
+    }
+
     crm_ipcs_send_ack(c, id, flags, "ack", __FUNCTION__, __LINE__);
     if (msg != NULL) {
         xmlNode *data_xml = get_message_xml(msg, F_CRM_DATA);
@@ -242,6 +510,9 @@ pe_ipc_closed(qb_ipcs_connection_t * c)
         return 0;
     }
     crm_trace("Connection %p", c);
+    free_xml(client->userdata); // Replica of last input (if any)
+    client->userdata = NULL;
+    held_calc_reset(); // Only the controller asks for speculative runs
     crm_client_destroy(client);
     return 0;
 }
@@ -318,10 +589,17 @@ main(int argc, char **argv)
     crm_log_init(NULL, LOG_INFO, TRUE, FALSE, argc, argv, FALSE);
     crm_notice("Starting Pacemaker scheduler");
 
-    if (pcmk__daemon_can_write(PE_STATE_DIR, NULL) == FALSE) {
-        crm_err("Terminating due to bad permissions on " PE_STATE_DIR);
+    if ((getenv("PCMK_scheduler_state_dir") != NULL)
+        && (strlen(getenv("PCMK_scheduler_state_dir")) > 0)) {
+        state_dir = getenv("PCMK_scheduler_state_dir");
+        crm_notice("Saving scheduler inputs in %s", state_dir);
+    }
+
+    if (pcmk__daemon_can_write(state_dir, NULL) == FALSE) {
+        crm_err("Terminating due to bad permissions on %s", state_dir);
         fprintf(stderr,
-                "ERROR: Bad permissions on " PE_STATE_DIR " (see logs for details)\n");
+                "ERROR: Bad permissions on %s (see logs for details)\n",
+                state_dir);
         fflush(stderr);
         return CRM_EX_FATAL;
     }
@@ -129,6 +129,19 @@ typedef struct cib_api_operations_s {
                                        void (*callback)(xmlNode *, int, int,
                                                         xmlNode *, void *),
                                        void (*free_func)(void *));
+
+    /*!
+     * \brief Restrict diff notifications to changes within matching elements
+     *
+     * \param[in] cib    CIB connection
+     * \param[in] xpath  XPath of elements of interest (or NULL for all changes)
+     *
+     * \return Legacy Pacemaker return code (-EINVAL if \p xpath is invalid, in
+     *         which case any previous filter remains in effect)
+     * \note Changes are matched against the CIB after the change, and legacy
+     *       (v1) diffs are never filtered.
+     */
+    int (*set_notify_filter)(cib_t *cib, const char *xpath);
 } cib_api_operations_t;
 
 struct cib_s {
@@ -145,6 +158,8 @@ struct cib_s {
     void (*op_callback) (const xmlNode *msg, int call_id, int rc,
                          xmlNode *output);
     cib_api_operations_t *cmds;
+
+    char *notify_filter; // XPath filter for diff notifications
 };
 
 #ifdef __cplusplus
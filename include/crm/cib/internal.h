@@ -52,11 +52,14 @@
 #  define F_CIB_CLIENTNAME	"cib_clientname"
 #  define F_CIB_NOTIFY_TYPE	"cib_notify_type"
 #  define F_CIB_NOTIFY_ACTIVATE	"cib_notify_activate"
+#  define F_CIB_NOTIFY_FILTER	"cib_notify_filter"
 #  define F_CIB_UPDATE_DIFF	"cib_update_diff"
 #  define F_CIB_USER		"cib_user"
 #  define F_CIB_LOCAL_NOTIFY_ID	"cib_local_notify_id"
 #  define F_CIB_PING_ID         "cib_ping_id"
 #  define F_CIB_SCHEMA_MAX      "cib_schema_max"
+#  define F_CIB_SYNC_HOSTS      "cib_sync_hosts"
+#  define F_CIB_SYNC_BATCH      "cib_sync_batch"
 
 #  define T_CIB			"cib"
 #  define T_CIB_NOTIFY		"cib_notify"
@@ -297,6 +297,19 @@ gboolean check_message_sanity(const AIS_Message * msg, const char *data);
 
 gboolean send_cpg_iov(struct iovec * iov);
 
+/* Statistics for the outbound CPG message queue */
+typedef struct pcmk__cpg_queue_stats_s {
+    unsigned int depth;         // Messages currently queued
+    unsigned int max_depth;     // Most messages ever queued at once
+    unsigned long long queued;  // Messages queued since start-up
+    unsigned long long sent;    // Messages accepted by corosync
+    unsigned long long batched; // Messages sent packed with others
+    unsigned long long flow_control; // Sends refused due to flow control
+    unsigned long long max_wait_ms;  // Longest time a message was queued
+} pcmk__cpg_queue_stats_t;
+
+void pcmk__cpg_queue_stats(pcmk__cpg_queue_stats_t *stats);
+
 char *get_corosync_uuid(crm_node_t *peer);
 char *corosync_node_name(uint64_t /*cmap_handle_t */ cmap_handle, uint32_t nodeid);
 char *corosync_cluster_name(void);
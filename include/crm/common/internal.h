@@ -87,6 +87,36 @@ char *generate_transition_key(int action, int transition_id, int target_rc,
 void filter_action_parameters(xmlNode *param_set, const char *version);
 
 
+// internal main loop utilities (from mainloop.c)
+
+/* Main loop priority lanes. Sources added with a priority in a lane are
+ * accounted to that lane. Library connections use their lane's priority only
+ * in daemons that call pcmk__mainloop_enable_lanes(), where bulk sources also
+ * yield after a bounded batch of messages.
+ */
+#define PCMK__PRIORITY_CRITICAL G_PRIORITY_HIGH         // fencing, membership
+#define PCMK__PRIORITY_OPS      (G_PRIORITY_HIGH / 2)   // operation results
+#define PCMK__PRIORITY_BULK     G_PRIORITY_DEFAULT      // CIB, scheduler
+
+struct trigger_s *pcmk__mainloop_add_named_trigger(const char *name,
+                                                   int priority,
+                                                   int (*dispatch) (gpointer user_data),
+                                                   gpointer userdata);
+void pcmk__mainloop_enable_lanes(void);
+int pcmk__mainloop_lane_priority(int lane_priority, int usual_priority);
+xmlNode *pcmk__mainloop_lane_stats(xmlNode *parent);
+xmlNode *pcmk__mainloop_source_stats(xmlNode *parent);
+void pcmk__mainloop_log_source_stats(void);
+
+
+/* internal resource agent functions (from agents.c) */
+
+char *pcmk__cached_agent_metadata(const char *standard, const char *provider,
+                                  const char *type);
+void pcmk__cache_agent_metadata(const char *standard, const char *provider,
+                                const char *type, const char *metadata);
+
+
 // miscellaneous utilities (from utils.c)
 
 const char *pcmk_message_name(const char *name);
@@ -41,14 +41,18 @@ enum crm_ipc_flags
     crm_ipc_flags_none      = 0x00000000,
 
     crm_ipc_compressed      = 0x00000001, /* Message has been compressed */
+    crm_ipc_shm             = 0x00000002, /* Message payload is in a shared memory file */
+    crm_ipc_shm_capable     = 0x00000004, /* Sender accepts shared memory payloads */
 
     crm_ipc_proxied         = 0x00000100, /* _ALL_ replies to proxied connections need to be sent as events */
     crm_ipc_client_response = 0x00000200, /* A Response is expected in reply */
+    crm_ipc_client_async    = 0x00000400, /* Send the Response as an Event (sender has other requests in flight) */
 
     /* These options are just options for crm_ipcs_sendv() */
     crm_ipc_server_event    = 0x00010000, /* Send an Event instead of a Response */
     crm_ipc_server_free     = 0x00020000, /* Free the iovec after sending */
     crm_ipc_proxied_relay_response = 0x00040000, /* all replies to proxied connections are sent as events, this flag preserves whether the event should be treated as an actual event, or a response.*/
+    crm_ipc_async_response  = 0x00080000, /* Event is the Response to the (crm_ipc_client_async) request with the same ID */
 
     crm_ipc_server_info     = 0x00100000, /* Log failures as LOG_INFO */
     crm_ipc_server_error    = 0x00200000, /* Log failures as LOG_ERR */
@@ -14,6 +14,8 @@
 
 #include <crm_config.h>  /* US_AUTH_GETPEEREID */
 
+#include <crm/common/ipc.h>
+
 
 /* denotes "non yieldable PID" on FreeBSD, or actual PID1 in scenarios that
    require a delicate handling anyway (socket-based activation with systemd);
@@ -66,4 +68,25 @@
 int pcmk__ipc_is_authentic_process_active(const char *name, uid_t refuid,
                                           gid_t refgid, pid_t *gotpid);
 
+void pcmk__ipc_shm_sweep(void);
+
+/*!
+ * \internal
+ * \brief Callback for the reply to an asynchronous IPC request
+ *
+ * \param[in] ipc         Connection request was sent on
+ * \param[in] request_id  ID of request (as returned when it was sent)
+ * \param[in] rc          pcmk_ok if reply was received, otherwise -errno
+ * \param[in] reply       Reply (or NULL on failure), freed after callback
+ * \param[in] user_data   Caller data given when request was sent
+ */
+typedef void (*pcmk__ipc_reply_cb_t)(crm_ipc_t *ipc, uint32_t request_id,
+                                     int rc, xmlNode *reply, void *user_data);
+
+int pcmk__ipc_send_async(crm_ipc_t *client, xmlNode *message,
+                         enum crm_ipc_flags flags, int32_t ms_timeout,
+                         pcmk__ipc_reply_cb_t callback, void *user_data,
+                         uint32_t *request_id);
+unsigned int pcmk__ipc_pending_replies(crm_ipc_t *client);
+
 #endif
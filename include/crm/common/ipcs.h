@@ -58,8 +58,26 @@ enum crm_client_flags
 {
     crm_client_flag_ipc_proxied    = 0x00001, /* ipc_proxy code only */
     crm_client_flag_ipc_privileged = 0x00002, /* root or cluster user */
+    crm_client_flag_ipc_shm        = 0x00004, /* accepts shared memory payloads */
 };
 
+/* Per-client IPC accounting (see pcmk__ipc_handle_stats_request()) */
+typedef struct crm_client_stats_s {
+    time_t connected;           /* When client connected */
+    uint64_t recv_msgs;         /* Messages received from client */
+    uint64_t recv_bytes;        /* Bytes received (as transferred) */
+    uint64_t recv_raw_bytes;    /* Bytes received (uncompressed) */
+    uint64_t sent_msgs;         /* Responses and events sent to client */
+    uint64_t sent_bytes;        /* Bytes sent (as transferred) */
+    uint64_t sent_raw_bytes;    /* Bytes sent (uncompressed) */
+    uint64_t replies;           /* Responses sent to requests we timed */
+    uint64_t service_ns;        /* Total time from request to response */
+    uint64_t service_max_ns;    /* Longest time from request to response */
+    uint64_t request_ns;        /* When request awaiting response arrived */
+    unsigned int queue_high;    /* Longest event queue seen */
+    unsigned int blocked;       /* Event flushes that found client full */
+} crm_client_stats_t;
+
 struct crm_client_s {
     uint pid;
 
@@ -92,6 +110,13 @@ struct crm_client_s {
 
     unsigned int queue_backlog; /* IPC queue length after last flush */
     unsigned int queue_max;     /* Evict client whose queue grows this big */
+    unsigned int flush_delay;   /* Current event queue retry delay (ms) */
+    time_t backlog_since;       /* When queue last went over queue_max */
+
+    crm_client_stats_t stats;   /* IPC accounting */
+
+    GList *shm_files;           /* Shared memory payloads sent (maybe unread) */
+    GHashTable *async_requests; /* IDs of requests to answer with events */
 };
 
 extern GHashTable *client_connections;
@@ -121,6 +146,10 @@ xmlNode *crm_ipcs_recv(crm_client_t * c, void *data, size_t size, uint32_t * id,
 
 int crm_ipcs_client_pid(qb_ipcs_connection_t * c);
 
+bool pcmk__ipc_handle_stats_request(crm_client_t *c, xmlNode *request,
+                                    uint32_t id, uint32_t flags);
+void pcmk__ipcs_reply_sent(crm_client_t *c);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2019 the Pacemaker project contributors
+ *
+ * The version control history for this file may have further details.
+ *
+ * This source code is licensed under the GNU Lesser General Public License
+ * version 2.1 or later (LGPLv2.1+) WITHOUT ANY WARRANTY.
+ */
+
+#ifndef PCMK__TRACE_INTERNAL__H
+#  define PCMK__TRACE_INTERNAL__H
+
+/*
+ * Binary trace ring buffer
+ *
+ * Hot paths record fixed-size binary events (a timestamp, an event ID, and up
+ * to three integer arguments) in an in-memory ring buffer. Recording costs a
+ * clock read and a few stores, so it is enabled by default (set
+ * PCMK_trace_ring=no to disable it). The ring is written to a file whenever
+ * the blackbox is dumped, and can be decoded with crm_trace_decode.
+ */
+
+#  include <stdint.h>
+
+#  define PCMK__TRACE_MAGIC     0x50434d54  /* "PCMT" */
+#  define PCMK__TRACE_VERSION   1
+
+/* Number of records kept (must be a power of 2) */
+#  define PCMK__TRACE_RECORDS   16384
+
+/* New events must be added at the end, so existing dumps remain decodable */
+enum pcmk__trace_event {
+    pcmk__trace_none = 0,
+    pcmk__trace_ipcs_recv,          /* client PID, bytes, request ID */
+    pcmk__trace_ipcs_send,          /* client PID, bytes, flags */
+    pcmk__trace_ipcc_send,          /* request ID, bytes, flags */
+    pcmk__trace_cib_op_start,       /* call ID, operation type, options */
+    pcmk__trace_cib_op_done,        /* call ID, operation type, rc */
+    pcmk__trace_transition_start,   /* transition ID, synapses, actions */
+    pcmk__trace_transition_done,    /* transition ID, completed, status */
+    pcmk__trace_action_fire,        /* transition ID, action ID, type */
+    pcmk__trace_exec_start,         /* call ID, interval (ms), timeout (ms) */
+    pcmk__trace_exec_done,          /* call ID, rc, operation status */
+    pcmk__trace_event_max           /* Must be last */
+};
+
+typedef struct pcmk__trace_record_s {
+    uint64_t timestamp_ns;          /* Monotonic clock */
+    uint32_t event;                 /* enum pcmk__trace_event */
+    uint32_t args[3];
+} pcmk__trace_record_t;
+
+/* Dump file layout: this header, then records from oldest to newest */
+typedef struct pcmk__trace_header_s {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t pid;
+    uint32_t count;                 /* Number of records that follow */
+    uint64_t dump_mono_ns;          /* Monotonic clock at time of dump */
+    uint64_t dump_real_ns;          /* Wall clock at time of dump */
+    uint64_t lost;                  /* Records overwritten before dump */
+    char name[32];                  /* Name of process (nul-terminated) */
+} pcmk__trace_header_t;
+
+void pcmk__trace(enum pcmk__trace_event event, uint32_t arg0, uint32_t arg1,
+                 uint32_t arg2);
+int pcmk__trace_dump(const char *filename);
+const char *pcmk__trace_event_name(uint32_t event);
+const char *pcmk__trace_arg_names(uint32_t event);
+
+#endif
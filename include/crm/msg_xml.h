@@ -67,9 +67,15 @@ extern "C" {
 #  define F_CRM_ELECTION_OWNER		"election-owner"
 #  define F_CRM_TGRAPH			"crm-tgraph-file"
 #  define F_CRM_TGRAPH_INPUT		"crm-tgraph-in"
+#  define F_CRM_SCHED_REPLICA		"crm-sched-replica"
+#  define F_CRM_SCHED_RESYNC		"crm-sched-resync"
+#  define F_CRM_SCHED_SPECULATIVE	"crm-sched-speculative"
+#  define F_CRM_SCHED_ADOPT		"crm-sched-adopt"
 
 #  define F_CRM_THROTTLE_MODE		"crm-limit-mode"
 #  define F_CRM_THROTTLE_MAX		"crm-limit-max"
+#  define F_CRM_THROTTLE_LIMIT		"crm-limit-jobs"
+#  define F_CRM_THROTTLE_MIGRATE		"crm-limit-migrate"
 
 /*---- Common tags/attrs */
 #  define XML_DIFF_MARKER		"__crm_diff_marker__"
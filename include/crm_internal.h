@@ -211,6 +211,10 @@ pid_t pcmk_locate_sbd(void);
 #  define ATTRD_OP_SYNC_RESPONSE "sync-response"
 #  define ATTRD_OP_CLEAR_FAILURE "clear-failure"
 
+xmlNode *pcmk__attrd_clear_op(const char *host, const char *resource,
+                              const char *operation, const char *interval_spec,
+                              const char *user_name, int options);
+
 #  define PCMK_ENV_PHYSICAL_HOST "physical_host"
 
 
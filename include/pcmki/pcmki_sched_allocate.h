@@ -183,6 +183,8 @@ gboolean update_action_flags(action_t * action, enum pe_action_flags flags, cons
 gboolean update_action(pe_action_t *action, pe_working_set_t *data_set);
 void complex_set_cmds(resource_t * rsc);
 void pcmk__log_transition_summary(const char *filename);
+int pcmk__last_transition_id(void);
+void pcmk__set_last_transition_id(int id);
 void clone_create_pseudo_actions(
     resource_t * rsc, GListPtr children, notify_data_t **start_notify, notify_data_t **stop_notify,  pe_working_set_t * data_set);
 #endif
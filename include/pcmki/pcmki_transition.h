@@ -39,6 +39,14 @@ typedef struct synapse_s {
 
     GListPtr actions;           /* crm_action_t* */
     GListPtr inputs;            /* crm_action_t* */
+
+    /* Expected time (in ms) to complete this synapse and everything that
+     * depends on it (set only when the graph is prioritized)
+     */
+    guint critical_ms;
+
+    int position;               /* index in graph's synapse list */
+    int inputs_pending;         /* number of inputs not yet confirmed */
 } synapse_t;
 
 typedef struct crm_action_s {
@@ -101,6 +109,15 @@ struct crm_graph_s {
     GListPtr synapses;          /* synapse_t* */
 
     int migration_limit;
+
+    gboolean prioritized;       /* synapses are ordered by critical path */
+
+    /* Indexes built the first time the graph is run or updated */
+    GHashTable *actions_by_id;  /* action ID -> crm_action_t* */
+    GHashTable *dependents;     /* action ID -> GList of inputs referring to it */
+    GSequence *ready;           /* synapse_t* with all inputs confirmed */
+    GListPtr in_flight;         /* synapse_t* executed but not confirmed */
+    int num_confirmed;          /* synapses confirmed so far */
 };
 
 typedef struct crm_graph_functions_s {
@@ -109,6 +126,9 @@ typedef struct crm_graph_functions_s {
     gboolean(*crmd) (crm_graph_t * graph, crm_action_t * action);
     gboolean(*stonith) (crm_graph_t * graph, crm_action_t * action);
     gboolean(*allowed) (crm_graph_t * graph, crm_action_t * action);
+
+    /* Optional: expected duration of an action in ms (0 if unknown) */
+    guint(*duration) (crm_graph_t * graph, crm_action_t * action);
 } crm_graph_functions_t;
 
 enum transition_status {
@@ -126,6 +146,7 @@ void set_graph_functions(crm_graph_functions_t * fns);
 crm_graph_t *unpack_graph(xmlNode * xml_graph, const char *reference);
 int run_graph(crm_graph_t * graph);
 gboolean update_graph(crm_graph_t * graph, crm_action_t * action);
+crm_action_t *find_graph_action(crm_graph_t * graph, int id);
 void destroy_graph(crm_graph_t * graph);
 const char *transition_status(enum transition_status state);
 void print_graph(unsigned int log_level, crm_graph_t * graph);
@@ -34,6 +34,8 @@ int cib_client_add_notify_callback(cib_t * cib, const char *event,
 int cib_client_del_notify_callback(cib_t * cib, const char *event,
                                    void (*callback) (const char *event, xmlNode * msg));
 
+int cib_client_set_notify_filter(cib_t *cib, const char *xpath);
+
 gint ciblib_GCompareFunc(gconstpointer a, gconstpointer b);
 
 #define op_common(cib) do {                                             \
@@ -366,6 +368,7 @@ cib_new_variant(void)
     new_cib->cmds->del_notify_callback = cib_client_del_notify_callback;
     new_cib->cmds->register_callback = cib_client_register_callback;
     new_cib->cmds->register_callback_full = cib_client_register_callback_full;
+    new_cib->cmds->set_notify_filter = cib_client_set_notify_filter;
 
     new_cib->cmds->noop = cib_client_noop;
     new_cib->cmds->ping = cib_client_ping;
@@ -427,6 +430,8 @@ cib_delete(cib_t *cib)
 {
     cib_free_callbacks(cib);
     if (cib) {
+        free(cib->notify_filter);
+        cib->notify_filter = NULL;
         cib->cmds->free(cib);
     }
 }
@@ -541,6 +546,33 @@ cib_client_del_notify_callback(cib_t * cib, const char *event,
     return pcmk_ok;
 }
 
+int
+cib_client_set_notify_filter(cib_t *cib, const char *xpath)
+{
+    if (cib->variant != cib_native && cib->variant != cib_remote) {
+        return -EPROTONOSUPPORT;
+    }
+
+    if (xpath != NULL) {
+        xmlXPathCompExprPtr compiled = xmlXPathCompile((const xmlChar *) xpath);
+
+        if (compiled == NULL) {
+            crm_err("Invalid diff notification filter: %s", xpath);
+            return -EINVAL;
+        }
+        xmlXPathFreeCompExpr(compiled);
+    }
+
+    free(cib->notify_filter);
+    cib->notify_filter = xpath? strdup(xpath) : NULL;
+
+    /* Re-register so the manager picks up the new filter */
+    if (get_notify_list_event_count(cib, T_CIB_DIFF_NOTIFY) > 0) {
+        return cib->cmds->register_notification(cib, T_CIB_DIFF_NOTIFY, 1);
+    }
+    return pcmk_ok;
+}
+
 gint
 ciblib_GCompareFunc(gconstpointer a, gconstpointer b)
 {
@@ -217,7 +217,10 @@ cib_native_signon_raw(cib_t * cib, const char *name, enum cib_conn_type type, in
 
     } else {
         native->source =
-            mainloop_add_ipc_client(channel, G_PRIORITY_HIGH, 512 * 1024 /* 512k */ , cib,
+            mainloop_add_ipc_client(channel,
+                                    pcmk__mainloop_lane_priority(PCMK__PRIORITY_BULK,
+                                                                 G_PRIORITY_HIGH),
+                                    512 * 1024 /* 512k */ , cib,
                                     &cib_callbacks);
         native->ipc = mainloop_get_ipc_client(native->source);
     }
@@ -490,20 +493,33 @@ cib_native_register_notification(cib_t * cib, const char *callback, int enabled)
 {
     int rc = pcmk_ok;
     xmlNode *notify_msg = create_xml_node(NULL, "cib-callback");
+    xmlNode *reply = NULL;
     cib_native_opaque_t *native = cib->variant_opaque;
 
     if (cib->state != cib_disconnected) {
         crm_xml_add(notify_msg, F_CIB_OPERATION, T_CIB_NOTIFY);
         crm_xml_add(notify_msg, F_CIB_NOTIFY_TYPE, callback);
         crm_xml_add_int(notify_msg, F_CIB_NOTIFY_ACTIVATE, enabled);
+        if (safe_str_eq(callback, T_CIB_DIFF_NOTIFY)) {
+            crm_xml_add(notify_msg, F_CIB_NOTIFY_FILTER, cib->notify_filter);
+        }
         rc = crm_ipc_send(native->ipc, notify_msg, crm_ipc_client_response,
-                          1000 * cib->call_timeout, NULL);
+                          1000 * cib->call_timeout, &reply);
         if (rc <= 0) {
             crm_trace("Notification not registered: %d", rc);
             rc = -ECOMM;
+
+        } else if (safe_str_eq(crm_element_name(reply), "nack")) {
+            // The manager rejected the registration (i.e. an invalid filter)
+            crm_trace("Notification registration rejected");
+            rc = -EINVAL;
+
+        } else {
+            rc = pcmk_ok;
         }
     }
 
+    free_xml(reply);
     free_xml(notify_msg);
     return rc;
 }
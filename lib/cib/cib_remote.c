@@ -96,6 +96,9 @@ cib_remote_register_notification(cib_t * cib, const char *callback, int enabled)
     crm_xml_add(notify_msg, F_CIB_OPERATION, T_CIB_NOTIFY);
     crm_xml_add(notify_msg, F_CIB_NOTIFY_TYPE, callback);
     crm_xml_add_int(notify_msg, F_CIB_NOTIFY_ACTIVATE, enabled);
+    if (safe_str_eq(callback, T_CIB_DIFF_NOTIFY)) {
+        crm_xml_add(notify_msg, F_CIB_NOTIFY_FILTER, cib->notify_filter);
+    }
     crm_remote_send(&private->callback, notify_msg);
     free_xml(notify_msg);
     return pcmk_ok;
@@ -298,7 +301,10 @@ cib_tls_signon(cib_t * cib, crm_remote_t * connection, gboolean event_channel)
 
     crm_trace("remote client connection established");
     connection->source =
-        mainloop_add_fd("cib-remote", G_PRIORITY_HIGH, sock, cib,
+        mainloop_add_fd("cib-remote",
+                        pcmk__mainloop_lane_priority(PCMK__PRIORITY_BULK,
+                                                     G_PRIORITY_HIGH),
+                        sock, cib,
                         &cib_fd_callbacks);
     return rc;
 }
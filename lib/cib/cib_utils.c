@@ -201,6 +201,107 @@ cib_acl_enabled(xmlNode *xml, const char *user)
     return rc;
 }
 
+/*!
+ * \internal
+ * \brief Check whether a CIB attribute can be changed without revalidation
+ *
+ * \param[in] name  Name of attribute of the cib element
+ *
+ * \return TRUE if the schema allows any value for \p name (or the value is
+ *         always managed by the CIB manager itself), otherwise FALSE
+ */
+static gboolean
+cib_attr_needs_no_validation(const char *name)
+{
+    static const char *unchecked[] = {
+        XML_ATTR_GENERATION_ADMIN,
+        XML_ATTR_GENERATION,
+        XML_ATTR_NUMUPDATES,
+        XML_CIB_ATTR_WRITTEN,
+        XML_ATTR_DC_UUID,
+        XML_ATTR_UPDATE_ORIG,
+        XML_ATTR_UPDATE_CLIENT,
+        XML_ATTR_UPDATE_USER,
+    };
+
+    for (int lpc = 0; lpc < DIMOF(unchecked); lpc++) {
+        if (safe_str_eq(name, unchecked[lpc])) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*!
+ * \internal
+ * \brief Check whether a patchset only touches schema-unconstrained content
+ *
+ * The schema accepts anything within the status section, so a change
+ * confined to it (plus version and bookkeeping attributes of the cib element)
+ * cannot make a valid CIB invalid.
+ *
+ * \param[in] patchset  Patchset describing the change to the CIB
+ *
+ * \return TRUE if validation of the result can be skipped, otherwise FALSE
+ * \note Only v2 patchsets are inspected; anything else requires validation.
+ */
+static gboolean
+cib_patchset_is_status_only(xmlNode *patchset)
+{
+    int format = 1;
+    xmlNode *change = NULL;
+    static const char *status_prefix = "/" XML_TAG_CIB "/" XML_CIB_TAG_STATUS "/";
+
+    if (patchset == NULL) {
+        return FALSE;
+    }
+    crm_element_value_int(patchset, "format", &format);
+    if (format != 2) {
+        return FALSE;
+    }
+
+    for (change = __xml_first_child(patchset); change != NULL;
+         change = __xml_next(change)) {
+
+        const char *op = crm_element_value(change, XML_DIFF_OP);
+        const char *path = crm_element_value(change, XML_DIFF_PATH);
+
+        if (safe_str_neq(crm_element_name(change), XML_DIFF_CHANGE)) {
+            continue; // version details
+
+        } else if (path == NULL) {
+            return FALSE;
+
+        } else if (strncmp(path, status_prefix, strlen(status_prefix)) == 0) {
+            continue;
+
+        } else if (safe_str_eq(op, "create")
+                   && safe_str_eq(path, "/" XML_TAG_CIB "/" XML_CIB_TAG_STATUS)) {
+            continue; // new node_state etc.
+
+        } else if (safe_str_eq(op, "modify")
+                   && safe_str_eq(path, "/" XML_TAG_CIB)) {
+            xmlNode *list = first_named_child(change, XML_DIFF_LIST);
+            xmlNode *attr = NULL;
+
+            if (list == NULL) {
+                return FALSE;
+            }
+            for (attr = first_named_child(list, XML_DIFF_ATTR); attr != NULL;
+                 attr = crm_next_same_xml(attr)) {
+                if (!cib_attr_needs_no_validation(crm_element_value(attr,
+                                                  XML_NVPAIR_ATTR_NAME))) {
+                    return FALSE;
+                }
+            }
+
+        } else {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
 int
 cib_perform_op(const char *op, int call_options, cib_op_t * fn, gboolean is_query,
                const char *section, xmlNode * req, xmlNode * input,
@@ -419,6 +520,13 @@ cib_perform_op(const char *op, int call_options, cib_op_t * fn, gboolean is_quer
          * b) we don't validate any of its contents at the moment anyway
          */
         check_schema = FALSE;
+
+    } else if (cib_patchset_is_status_only(local_diff)) {
+        /* Same as above, for requests that don't name the status section
+         * (such as patch applications) but only touch it anyway
+         */
+        crm_trace("Skipping validation of status-only %s change", op);
+        check_schema = FALSE;
     }
 
     /* === scratch must not be modified after this point ===
@@ -130,8 +130,20 @@ bail:
 }
 
 
-GListPtr cs_message_queue = NULL;
-int cs_message_timer = 0;
+/* Outbound CPG messages waiting for corosync to accept them */
+struct cs_queued_msg_s {
+    struct iovec *iov;
+    uint64_t queued_ns;     // When message was queued (monotonic)
+};
+
+static GQueue *cs_message_queue = NULL;
+static guint cs_message_timer = 0;
+static uint32_t cs_flush_delay_ms = 0;
+static pcmk__cpg_queue_stats_t cs_queue_stats = { 0, };
+
+/* Bounds of the delay before retrying after corosync refused a message */
+#define CS_FLUSH_DELAY_MIN  10
+#define CS_FLUSH_DELAY_MAX  1000
 
 static ssize_t crm_cs_flush(gpointer data);
 
@@ -143,22 +155,198 @@ crm_cs_flush_cb(gpointer data)
     return FALSE;
 }
 
+/*!
+ * \internal
+ * \brief Get statistics for the outbound CPG message queue
+ *
+ * \param[out] stats  Where to store copy of current statistics
+ */
+void
+pcmk__cpg_queue_stats(pcmk__cpg_queue_stats_t *stats)
+{
+    CRM_CHECK(stats != NULL, return);
+    *stats = cs_queue_stats;
+    stats->depth = cs_message_queue? g_queue_get_length(cs_message_queue) : 0;
+}
+
+static void
+free_queued_msg(struct cs_queued_msg_s *msg)
+{
+    free(msg->iov->iov_base);
+    free(msg->iov);
+    free(msg);
+}
+
+/*!
+ * \internal
+ * \brief Flush outbound CPG queue now if a retry is pending
+ *
+ * Corosync delivers our own messages back to us, so any dispatch is a sign
+ * that it has made progress and may be accepting messages again.
+ */
+static void
+cs_flush_if_waiting(void)
+{
+    if (cs_message_timer && (cs_flush_delay_ms > CS_FLUSH_DELAY_MIN)) {
+        g_source_remove(cs_message_timer);
+        cs_message_timer = 0;
+        crm_cs_flush(&pcmk_cpg_handle);
+    }
+}
+
+/* Message class used for envelopes holding several complete messages */
+#define CS_MSG_CLASS_BATCH  1
+
+/* Limits on how many queued messages are packed into one envelope */
+#define CS_BATCH_MAX_MSGS   32
+#define CS_BATCH_MAX_SIZE   (64 * 1024)
+
+/* Packed messages start on 8-byte boundaries within an envelope */
+#define CS_BATCH_ALIGN(len) (((len) + 7) & ~((size_t) 7))
+
+static bool cs_batch_enabled = FALSE;
+static cpg_deliver_fn_t cs_deliver_fn = NULL;
+
+/*!
+ * \internal
+ * \brief Pack messages at the head of the outbound queue into one envelope
+ *
+ * When batching is enabled, consecutive queued messages for the same
+ * destination daemon type are packed into a single envelope so they can be
+ * sent with one multicast.
+ *
+ * \param[out] count  Where to store number of queued messages packed
+ *
+ * \return Newly allocated envelope (which the caller must free), or NULL if
+ *         the message at the head of the queue should be sent on its own
+ */
+static AIS_Message *
+cs_batch_queued(unsigned int *count)
+{
+    GList *iter = NULL;
+    AIS_Message *first = NULL;
+    AIS_Message *batch = NULL;
+    unsigned int n = 0;
+    size_t total = 0;
+    char *pos = NULL;
+
+    *count = 1;
+    if (!cs_batch_enabled || (g_queue_get_length(cs_message_queue) < 2)) {
+        return NULL;
+    }
+
+    first = ((struct cs_queued_msg_s *)
+             g_queue_peek_head(cs_message_queue))->iov->iov_base;
+
+    for (iter = cs_message_queue->head;
+         (iter != NULL) && (n < CS_BATCH_MAX_MSGS); iter = iter->next) {
+
+        struct cs_queued_msg_s *queued = iter->data;
+        AIS_Message *msg = queued->iov->iov_base;
+        size_t len = CS_BATCH_ALIGN(queued->iov->iov_len);
+
+        if ((msg->header.id != crm_class_cluster)
+            || (msg->host.type != first->host.type)
+            || ((total + len) > CS_BATCH_MAX_SIZE)) {
+            break;
+        }
+        total += len;
+        n++;
+    }
+    if (n < 2) {
+        return NULL;
+    }
+
+    batch = calloc(1, sizeof(AIS_Message) + total);
+    CRM_ASSERT(batch != NULL);
+
+    // Each packed message carries its own destination, so address all nodes
+    batch->header.id = CS_MSG_CLASS_BATCH;
+    batch->header.size = sizeof(AIS_Message) + total;
+    batch->header.error = CS_OK;
+    batch->host.type = first->host.type;
+    batch->sender = first->sender;
+    batch->size = total;
+
+    pos = batch->data;
+    iter = cs_message_queue->head;
+    for (unsigned int i = 0; i < n; i++, iter = iter->next) {
+        struct iovec *iov = ((struct cs_queued_msg_s *) iter->data)->iov;
+
+        memcpy(pos, iov->iov_base, iov->iov_len);
+        pos += CS_BATCH_ALIGN(iov->iov_len);
+    }
+
+    *count = n;
+    return batch;
+}
+
+/*!
+ * \internal
+ * \brief Deliver a CPG message, unpacking it first if it is a batch envelope
+ *
+ * This wraps the daemon's own delivery callback, so batches are transparent
+ * to daemons. Envelopes are always accepted, even when sending them is not
+ * enabled locally.
+ */
+static void
+cs_deliver_unpacked(cpg_handle_t handle, const struct cpg_name *group_name,
+                    uint32_t nodeid, uint32_t pid, void *msg, size_t msg_len)
+{
+    AIS_Message *batch = msg;
+    size_t offset = 0;
+
+    if ((msg_len < sizeof(AIS_Message))
+        || (batch->header.id != CS_MSG_CLASS_BATCH)) {
+        cs_deliver_fn(handle, group_name, nodeid, pid, msg, msg_len);
+        return;
+    }
+
+    if ((batch->header.size != msg_len)
+        || (batch->size != (msg_len - sizeof(AIS_Message)))) {
+        crm_err("Discarding malformed CPG message batch from %u.%u "
+                CRM_XS " size=%llu payload=%u",
+                nodeid, pid, (unsigned long long) msg_len, batch->size);
+        return;
+    }
+
+    while ((offset + sizeof(AIS_Message)) <= batch->size) {
+        AIS_Message *packed = (AIS_Message *) (batch->data + offset);
+
+        if ((packed->header.size < sizeof(AIS_Message))
+            || ((offset + packed->header.size) > batch->size)) {
+            crm_err("Discarding remainder of malformed CPG message batch "
+                    "from %u.%u " CRM_XS " offset=%llu",
+                    nodeid, pid, (unsigned long long) offset);
+            return;
+        }
+        cs_deliver_fn(handle, group_name, nodeid, pid, packed,
+                      packed->header.size);
+        offset += CS_BATCH_ALIGN(packed->header.size);
+    }
+}
+
 #define CS_SEND_MAX 200
 static ssize_t
 crm_cs_flush(gpointer data)
 {
     int sent = 0;
     ssize_t rc = 0;
-    int queue_len = 0;
+    unsigned int queue_len = 0;
     static unsigned int last_sent = 0;
     cpg_handle_t *handle = (cpg_handle_t *)data;
+    uint64_t now_ns = 0;
 
     if (*handle == 0) {
         crm_trace("Connection is dead");
         return pcmk_ok;
     }
 
-    queue_len = g_list_length(cs_message_queue);
+    if (cs_message_queue == NULL) {
+        return pcmk_ok;
+    }
+
+    queue_len = g_queue_get_length(cs_message_queue);
     if ((queue_len % 1000) == 0 && queue_len > 1) {
         crm_err("CPG queue has grown to %d", queue_len);
 
@@ -168,32 +356,66 @@ crm_cs_flush(gpointer data)
 
     if (cs_message_timer) {
         /* There is already a timer, wait until it goes off */
-        crm_trace("Timer active %d", cs_message_timer);
+        crm_trace("Timer active %u", cs_message_timer);
         return pcmk_ok;
     }
 
-    while (cs_message_queue && sent < CS_SEND_MAX) {
-        struct iovec *iov = cs_message_queue->data;
+    now_ns = qb_util_nano_current_get();
+    while (sent < CS_SEND_MAX) {
+        struct cs_queued_msg_s *msg = g_queue_peek_head(cs_message_queue);
+        AIS_Message *batch = NULL;
+        unsigned int count = 1;
+
+        if (msg == NULL) {
+            break;
+        }
 
         errno = 0;
-        rc = cpg_mcast_joined(*handle, CPG_TYPE_AGREED, iov, 1);
+        batch = cs_batch_queued(&count);
+        if (batch != NULL) {
+            struct iovec batch_iov = {
+                .iov_base = batch,
+                .iov_len = batch->header.size,
+            };
+
+            rc = cpg_mcast_joined(*handle, CPG_TYPE_AGREED, &batch_iov, 1);
+            free(batch);
+        } else {
+            rc = cpg_mcast_joined(*handle, CPG_TYPE_AGREED, msg->iov, 1);
+        }
 
         if (rc != CS_OK) {
+            if (rc == CS_ERR_TRY_AGAIN) {
+                cs_queue_stats.flow_control++;
+            }
             break;
         }
 
-        sent++;
-        last_sent++;
-        crm_trace("CPG message sent, size=%llu",
-                  (unsigned long long) iov->iov_len);
+        if (count > 1) {
+            crm_trace("Sent %u CPG messages in one multicast", count);
+            cs_queue_stats.batched += count;
+        }
+
+        for (unsigned int i = 0; i < count; i++) {
+            uint64_t waited_ms = 0;
 
-        cs_message_queue = g_list_remove(cs_message_queue, iov);
-        free(iov->iov_base);
-        free(iov);
+            msg = g_queue_pop_head(cs_message_queue);
+            sent++;
+            last_sent++;
+            cs_queue_stats.sent++;
+            crm_trace("CPG message sent, size=%llu",
+                      (unsigned long long) msg->iov->iov_len);
+
+            waited_ms = (now_ns - msg->queued_ns) / QB_TIME_NS_IN_MSEC;
+            if (waited_ms > cs_queue_stats.max_wait_ms) {
+                cs_queue_stats.max_wait_ms = waited_ms;
+            }
+            free_queued_msg(msg);
+        }
     }
 
     queue_len -= sent;
-    if (sent > 1 || cs_message_queue) {
+    if (sent > 1 || queue_len) {
         crm_info("Sent %d CPG messages  (%d remaining, last=%u): %s (%lld)",
                  sent, queue_len, last_sent, ais_error2text(rc),
                  (long long) rc);
@@ -203,13 +425,28 @@ crm_cs_flush(gpointer data)
                   (long long) rc);
     }
 
-    if (cs_message_queue) {
-        uint32_t delay_ms = 100;
-        if(rc != CS_OK) {
-            /* Proportionally more if sending failed but cap at 1s */
-            delay_ms = QB_MIN(1000, CS_SEND_MAX + (10 * queue_len));
+    if (queue_len) {
+        uint32_t delay_ms = 0;
+
+        if (rc != CS_OK) {
+            /* Back off exponentially while corosync refuses messages. Sooner
+             * retries are triggered by incoming CPG traffic.
+             */
+            if (sent > 0 || cs_flush_delay_ms == 0) {
+                cs_flush_delay_ms = CS_FLUSH_DELAY_MIN;
+            } else {
+                cs_flush_delay_ms = QB_MIN(2 * cs_flush_delay_ms,
+                                           CS_FLUSH_DELAY_MAX);
+            }
+            delay_ms = cs_flush_delay_ms;
+        } else {
+            // Batch limit reached, so continue once the main loop allows
+            cs_flush_delay_ms = 0;
         }
         cs_message_timer = g_timeout_add(delay_ms, crm_cs_flush_cb, data);
+
+    } else {
+        cs_flush_delay_ms = 0;
     }
 
     return rc;
@@ -219,11 +456,28 @@ gboolean
 send_cpg_iov(struct iovec * iov)
 {
     static unsigned int queued = 0;
+    struct cs_queued_msg_s *msg = calloc(1, sizeof(struct cs_queued_msg_s));
+    unsigned int depth = 0;
+
+    CRM_ASSERT(msg != NULL);
+    msg->iov = iov;
+    msg->queued_ns = qb_util_nano_current_get();
+
+    if (cs_message_queue == NULL) {
+        cs_message_queue = g_queue_new();
+    }
 
     queued++;
     crm_trace("Queueing CPG message %u (%llu bytes)",
               queued, (unsigned long long) iov->iov_len);
-    cs_message_queue = g_list_append(cs_message_queue, iov);
+    g_queue_push_tail(cs_message_queue, msg);
+
+    cs_queue_stats.queued++;
+    depth = g_queue_get_length(cs_message_queue);
+    if (depth > cs_queue_stats.max_depth) {
+        cs_queue_stats.max_depth = depth;
+    }
+
     crm_cs_flush(&pcmk_cpg_handle);
     return TRUE;
 }
@@ -244,6 +498,8 @@ pcmk_cpg_dispatch(gpointer user_data)
         crm_err("Evicted from CPG membership");
         return -1;
     }
+
+    cs_flush_if_waiting();
     return 0;
 }
 
@@ -554,13 +810,19 @@ cluster_connect_cpg(crm_cluster_t *cluster)
     };
 
     cpg_callbacks_t cpg_callbacks = {
-        .cpg_deliver_fn = cluster->cpg.cpg_deliver_fn,
+        .cpg_deliver_fn = cs_deliver_unpacked,
         .cpg_confchg_fn = cluster->cpg.cpg_confchg_fn,
         /* .cpg_deliver_fn = pcmk_cpg_deliver, */
         /* .cpg_confchg_fn = pcmk_cpg_membership, */
     };
 
     cpg_evicted = FALSE;
+    cs_deliver_fn = cluster->cpg.cpg_deliver_fn;
+    if (cs_deliver_fn == NULL) {
+        cpg_callbacks.cpg_deliver_fn = NULL;
+    }
+    cs_batch_enabled = (crm_system_name != NULL)
+                       && daemon_option_enabled(crm_system_name, "cpg_batch");
     cluster->group.length = 0;
     cluster->group.value[0] = 0;
 
@@ -616,7 +878,10 @@ cluster_connect_cpg(crm_cluster_t *cluster)
 
     pcmk_cpg_handle = handle;
     cluster->cpg_handle = handle;
-    mainloop_add_fd("corosync-cpg", G_PRIORITY_MEDIUM, fd, cluster, &cpg_fd_callbacks);
+    mainloop_add_fd("corosync-cpg",
+                    pcmk__mainloop_lane_priority(PCMK__PRIORITY_CRITICAL,
+                                                 G_PRIORITY_MEDIUM),
+                    fd, cluster, &cpg_fd_callbacks);
 
   bail:
     if (rc != CS_OK) {
@@ -28,14 +28,37 @@
 typedef struct xml_acl_s {
         enum xml_private_flags mode;
         char *xpath;
+        xmlXPathCompExprPtr compiled;   // xpath compiled on unpacking
+        unsigned int refs;              // rules are shared via the user cache
 } xml_acl_t;
 
+/* Unpacked ACLs of each user (as lists of xml_acl_t), which remain valid for
+ * as long as the ACLs section they were unpacked from has the same text
+ */
+static GHashTable *user_acl_cache = NULL;
+static char *user_acl_cache_text = NULL;
+
+/* ACL matches of a user in a particular version of a document, cached in the
+ * document's private data so they are discarded along with the document
+ */
+struct acl_matches_s {
+    char *version;      // Document version matches are valid for
+    bool has_acls;      // Whether user has any ACLs (otherwise denied all)
+    GHashTable *flags;  // xmlNode * -> ACL flags set by user's rules
+};
+
 static void
 __xml_acl_free(void *data)
 {
     if (data) {
         xml_acl_t *acl = data;
 
+        if (--(acl->refs) > 0) {
+            return;
+        }
+        if (acl->compiled != NULL) {
+            xmlXPathFreeCompExpr(acl->compiled);
+        }
         free(acl->xpath);
         free(acl);
     }
@@ -47,6 +70,102 @@ pcmk__free_acls(GList *acls)
     g_list_free_full(acls, __xml_acl_free);
 }
 
+/*!
+ * \internal
+ * \brief Get a new reference to each rule in a list of ACLs
+ *
+ * \param[in] acls  List of ACLs
+ *
+ * \return New list with the same rules (which the caller must free with
+ *         pcmk__free_acls())
+ */
+static GList *
+__xml_acl_list_ref(GList *acls)
+{
+    GList *copy = NULL;
+
+    for (GList *iter = acls; iter != NULL; iter = iter->next) {
+        xml_acl_t *acl = iter->data;
+
+        acl->refs++;
+        copy = g_list_prepend(copy, acl);
+    }
+    return g_list_reverse(copy);
+}
+
+static void
+__xml_acl_list_free(gpointer data)
+{
+    pcmk__free_acls((GList *) data);
+}
+
+/*!
+ * \internal
+ * \brief Free the cached ACLs of all users
+ */
+void
+pcmk__free_acl_cache(void)
+{
+    if (user_acl_cache != NULL) {
+        g_hash_table_destroy(user_acl_cache);
+        user_acl_cache = NULL;
+    }
+    free(user_acl_cache_text);
+    user_acl_cache_text = NULL;
+}
+
+static void
+__xml_acl_matches_free(gpointer data)
+{
+    struct acl_matches_s *matches = data;
+
+    free(matches->version);
+    g_hash_table_destroy(matches->flags);
+    free(matches);
+}
+
+/*!
+ * \internal
+ * \brief Free the ACL matches cached for a document
+ *
+ * \param[in,out] matches  Table of cached matches by user (may be NULL)
+ */
+void
+pcmk__free_acl_matches(GHashTable *matches)
+{
+    if (matches != NULL) {
+        g_hash_table_destroy(matches);
+    }
+}
+
+/*!
+ * \internal
+ * \brief Search XML using an ACL's compiled xpath
+ *
+ * \param[in] acl  ACL whose xpath should be evaluated
+ * \param[in] xml  XML whose document should be searched
+ *
+ * \return XPath result object (which the caller must free with
+ *         freeXpathObject())
+ */
+static xmlXPathObjectPtr
+__xml_acl_search(xml_acl_t *acl, xmlNode *xml)
+{
+    xmlXPathContextPtr ctx = NULL;
+    xmlXPathObjectPtr result = NULL;
+
+    if (acl->compiled == NULL) {
+        // Let the usual search report the invalid expression
+        return xpath_search(xml, acl->xpath);
+    }
+
+    ctx = xmlXPathNewContext(getDocPtr(xml));
+    CRM_ASSERT(ctx != NULL);
+    result = xmlXPathCompiledEval(acl->compiled, ctx);
+    xmlXPathFreeContext(ctx);
+    return result;
+}
+
 static GList *
 __xml_acl_create(xmlNode *xml, GList *acls, enum xml_private_flags mode)
 {
@@ -77,6 +196,7 @@ __xml_acl_create(xmlNode *xml, GList *acls, enum xml_private_flags mode)
     CRM_ASSERT(acl != NULL);
 
     acl->mode = mode;
+    acl->refs = 1;
     if (xpath) {
         acl->xpath = strdup(xpath);
         CRM_ASSERT(acl->xpath != NULL);
@@ -129,6 +249,12 @@ __xml_acl_create(xmlNode *xml, GList *acls, enum xml_private_flags mode)
                   crm_element_name(xml), acl->xpath);
     }
 
+    // Compile once, since each rule is evaluated on every request
+    acl->compiled = xmlXPathCompile((pcmkXmlStr) acl->xpath);
+    if (acl->compiled == NULL) {
+        crm_warn("Could not compile ACL xpath %s", acl->xpath);
+    }
+
     return g_list_append(acls, acl);
 }
 
@@ -255,22 +381,27 @@ pcmk__apply_acl(xmlNode *xml)
         int max = 0, lpc = 0;
         xml_acl_t *acl = aIter->data;
 
-        xpathObj = xpath_search(xml, acl->xpath);
+        xpathObj = __xml_acl_search(acl, xml);
         max = numXpathResults(xpathObj);
 
         for (lpc = 0; lpc < max; lpc++) {
             xmlNode *match = getXpathResult(xpathObj, lpc);
-            char *path = xml_get_path(match);
 
+            /* Rules such as //nvpair can match much of the CIB, so avoid
+             * building each match's path just for logging
+             */
             p = match->_private;
-            crm_trace("Applying %s ACL to %s matched by %s",
-                      __xml_acl_to_text(acl->mode), path, acl->xpath);
+            crm_trace("Applying %s ACL to <%s id=%s> matched by %s",
+                      __xml_acl_to_text(acl->mode), crm_element_name(match),
+                      crm_str(ID(match)), acl->xpath);
 
 #ifdef SUSE_ACL_COMPAT
             if (is_not_set(p->flags, acl->mode)
                 && (is_set(p->flags, xpf_acl_read)
                     || is_set(p->flags, xpf_acl_write)
                     || is_set(p->flags, xpf_acl_deny))) {
+                char *path = xml_get_path(match);
+
                 crm_config_warn("Configuration element %s is matched by "
                                 "multiple ACL rules, only the first applies "
                                 "('%s' wins over '%s')",
@@ -281,7 +412,6 @@ pcmk__apply_acl(xmlNode *xml)
             }
 #endif
             p->flags |= acl->mode;
-            free(path);
         }
         crm_trace("Applied %s ACL %s (%d match%s)",
                   __xml_acl_to_text(acl->mode), acl->xpath, max,
@@ -301,6 +431,97 @@ pcmk__apply_acl(xmlNode *xml)
 
 }
 
+/*!
+ * \internal
+ * \brief Find the ACLs section of a CIB
+ *
+ * \param[in] source  XML with ACL definitions (normally an entire CIB)
+ *
+ * \return ACLs section of \p source, or NULL if there is none
+ * \note This walks the known path directly when possible, rather than
+ *       searching the entire document (which may be large) with XPath.
+ */
+static xmlNode *
+find_acls_section(xmlNode *source)
+{
+    xmlNode *config = NULL;
+
+    if (source == NULL) {
+        return NULL;
+
+    } else if (safe_str_eq(crm_element_name(source), XML_CIB_TAG_ACLS)) {
+        return source;
+
+    } else if (safe_str_eq(crm_element_name(source), XML_TAG_CIB)) {
+        config = first_named_child(source, XML_CIB_TAG_CONFIGURATION);
+        return config? first_named_child(config, XML_CIB_TAG_ACLS) : NULL;
+    }
+    return get_xpath_object("//" XML_CIB_TAG_ACLS, source, LOG_TRACE);
+}
+
+/*!
+ * \internal
+ * \brief Get the ACLs of a user, unpacking them if not already cached
+ *
+ * Unpacked rules (with their compiled xpaths) are shared by all requests
+ * from the same user until the ACLs section changes. Comparing the text of
+ * that (small) section detects any change, even one made without a version
+ * update.
+ *
+ * \param[in] source  XML with ACL definitions
+ * \param[in] user    Username whose ACLs are needed
+ *
+ * \return List of user's ACLs (which the caller must free with
+ *         pcmk__free_acls())
+ */
+static GList *
+__xml_acl_for_user(xmlNode *source, const char *user)
+{
+    xmlNode *acls = find_acls_section(source);
+    char *text = acls? dump_xml_unformatted(acls) : strdup("");
+    gpointer cached = NULL;
+    GList *result = NULL;
+
+    CRM_ASSERT(text != NULL);
+    if ((user_acl_cache != NULL) && safe_str_eq(text, user_acl_cache_text)
+        && g_hash_table_lookup_extended(user_acl_cache, user, NULL, &cached)) {
+        crm_trace("Using cached ACLs for user '%s'", user);
+        free(text);
+        return __xml_acl_list_ref((GList *) cached);
+    }
+
+    if (acls) {
+        xmlNode *child = NULL;
+
+        for (child = __xml_first_child_element(acls); child;
+             child = __xml_next_element(child)) {
+            const char *tag = crm_element_name(child);
+
+            if (!strcmp(tag, XML_ACL_TAG_USER)
+                || !strcmp(tag, XML_ACL_TAG_USERv1)) {
+                const char *id = crm_element_value(child, XML_ATTR_ID);
+
+                if (id && strcmp(id, user) == 0) {
+                    crm_debug("Unpacking ACLs for user '%s'", id);
+                    result = __xml_acl_parse_entry(acls, child, result);
+                }
+            }
+        }
+    }
+
+    if ((user_acl_cache == NULL) || safe_str_neq(text, user_acl_cache_text)) {
+        pcmk__free_acl_cache();
+        user_acl_cache = g_hash_table_new_full(crm_str_hash, g_str_equal, free,
+                                               __xml_acl_list_free);
+        user_acl_cache_text = text;
+        text = NULL;
+    }
+    g_hash_table_replace(user_acl_cache, strdup(user),
+                         __xml_acl_list_ref(result));
+    free(text);
+    return result;
+}
+
 /*!
  * \internal
  * \brief Unpack ACLs for a given user
@@ -326,30 +547,9 @@ pcmk__unpack_acl(xmlNode *source, xmlNode *target, const char *user)
                   user);
 
     } else if (p->acls == NULL) {
-        xmlNode *acls = get_xpath_object("//" XML_CIB_TAG_ACLS,
-                                         source, LOG_TRACE);
-
         free(p->user);
         p->user = strdup(user);
-
-        if (acls) {
-            xmlNode *child = NULL;
-
-            for (child = __xml_first_child_element(acls); child;
-                 child = __xml_next_element(child)) {
-                const char *tag = crm_element_name(child);
-
-                if (!strcmp(tag, XML_ACL_TAG_USER)
-                    || !strcmp(tag, XML_ACL_TAG_USERv1)) {
-                    const char *id = crm_element_value(child, XML_ATTR_ID);
-
-                    if (id && strcmp(id, user) == 0) {
-                        crm_debug("Unpacking ACLs for user '%s'", id);
-                        p->acls = __xml_acl_parse_entry(acls, child, p->acls);
-                    }
-                }
-            }
-        }
+        p->acls = __xml_acl_for_user(source, user);
     }
 #endif
 }
@@ -382,6 +582,38 @@ __xml_acl_mode_test(enum xml_private_flags allowed,
 /* rc = TRUE if orig_cib has been filtered
  * That means '*result' rather than 'xml' should be exploited afterwards
  */
+static bool
+__xml_purge_attributes(xmlNode *xml);
+
+/*!
+ * \internal
+ * \brief Purge the descendents of an element that ACLs deny access to
+ *
+ * \param[in,out] xml  Element whose children should be checked
+ *
+ * \note This relies on the flags set by pcmk__apply_acl(), so deny rules
+ *       do not need to be evaluated against the document a second time.
+ */
+static void
+__xml_purge_denied_children(xmlNode *xml)
+{
+    xmlNode *child = __xml_first_child_element(xml);
+
+    while (child != NULL) {
+        xmlNode *next = __xml_next_element(child);
+        xml_private_t *p = child->_private;
+
+        /* A readable element kept by the purge may still contain elements
+         * denied by other rules, so check what is left of it
+         */
+        if ((p == NULL) || is_not_set(p->flags, xpf_acl_deny)
+            || __xml_purge_attributes(child)) {
+            __xml_purge_denied_children(child);
+        }
+        child = next;
+    }
+}
+
 static bool
 __xml_purge_attributes(xmlNode *xml)
 {
@@ -422,6 +654,184 @@ __xml_purge_attributes(xmlNode *xml)
     return readable_children;
 }
 
+/*!
+ * \internal
+ * \brief Get the version of a CIB document, for caching ACL matches
+ *
+ * \param[in] xml  Root element of a document
+ *
+ * \return Newly allocated version string, or NULL if \p xml is not a CIB
+ *         with a complete version
+ */
+static char *
+__xml_acl_doc_version(xmlNode *xml)
+{
+    const char *admin_epoch = crm_element_value(xml, XML_ATTR_GENERATION_ADMIN);
+    const char *epoch = crm_element_value(xml, XML_ATTR_GENERATION);
+    const char *updates = crm_element_value(xml, XML_ATTR_NUMUPDATES);
+
+    if (safe_str_neq(crm_element_name(xml), XML_TAG_CIB)
+        || (admin_epoch == NULL) || (epoch == NULL) || (updates == NULL)) {
+        return NULL;
+    }
+    return crm_strdup_printf("%s.%s.%s", admin_epoch, epoch, updates);
+}
+
+/*!
+ * \internal
+ * \brief Find which elements of a document a user's ACLs apply to
+ *
+ * Every change to a CIB updates its version, so matches are cached with the
+ * document and reused for as long as its version stays the same (typically,
+ * for all queries between two CIB updates). Matches are not reused for a
+ * document with changes being tracked, since its version may not have been
+ * updated yet.
+ *
+ * \param[in]     acl_source  XML with ACL definitions
+ * \param[in,out] xml         Root element of document to match against
+ * \param[in]     user        Username whose ACLs should be used
+ *
+ * \return ACL matches (owned by the document's private data)
+ */
+static struct acl_matches_s *
+__xml_acl_matches(xmlNode *acl_source, xmlNode *xml, const char *user)
+{
+    xml_private_t *doc = xml->doc->_private;
+    char *version = __xml_acl_doc_version(xml);
+    struct acl_matches_s *matches = NULL;
+    GList *acls = NULL;
+    uint32_t flags = 0;
+
+    if (is_set(doc->flags, xpf_tracking) || is_set(doc->flags, xpf_dirty)) {
+        // Changes in progress might not be reflected in the version yet
+        free(version);
+        version = NULL;
+    }
+
+    if ((version != NULL) && (doc->acl_matches != NULL)) {
+        matches = g_hash_table_lookup(doc->acl_matches, user);
+        if ((matches != NULL) && safe_str_eq(matches->version, version)) {
+            crm_trace("Using cached ACL matches for user '%s' in CIB %s",
+                      user, version);
+            free(version);
+            return matches;
+        }
+    }
+
+    matches = calloc(1, sizeof(struct acl_matches_s));
+    CRM_ASSERT(matches != NULL);
+    matches->version = version;
+    matches->flags = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    acls = __xml_acl_for_user(acl_source, user);
+    matches->has_acls = (acls != NULL);
+
+    for (GList *iter = acls; iter != NULL; iter = iter->next) {
+        xml_acl_t *acl = iter->data;
+        xmlXPathObjectPtr xpathObj = __xml_acl_search(acl, xml);
+        int max = numXpathResults(xpathObj);
+
+        for (int lpc = 0; lpc < max; lpc++) {
+            xmlNode *match = getXpathResult(xpathObj, lpc);
+
+            if (match == NULL) {
+                continue;
+            }
+            flags = GPOINTER_TO_UINT(g_hash_table_lookup(matches->flags,
+                                                         match));
+#ifdef SUSE_ACL_COMPAT
+            if (is_not_set(flags, acl->mode)
+                && (is_set(flags, xpf_acl_read)
+                    || is_set(flags, xpf_acl_write)
+                    || is_set(flags, xpf_acl_deny))) {
+                continue; // Only the first matching rule applies
+            }
+#endif
+            g_hash_table_insert(matches->flags, match,
+                                GUINT_TO_POINTER(flags | acl->mode));
+        }
+        crm_trace("Matched %s ACL %s (%d match%s)",
+                  __xml_acl_to_text(acl->mode), acl->xpath, max,
+                  ((max == 1)? "" : "es"));
+        freeXpathObject(xpathObj);
+    }
+    pcmk__free_acls(acls);
+
+    // Deny by default when the top is not explicitly readable
+    flags = GPOINTER_TO_UINT(g_hash_table_lookup(matches->flags, xml));
+    if (is_not_set(flags, xpf_acl_read) && is_not_set(flags, xpf_acl_write)) {
+        g_hash_table_insert(matches->flags, xml,
+                            GUINT_TO_POINTER(flags | xpf_acl_deny));
+    }
+
+    if (doc->acl_matches == NULL) {
+        doc->acl_matches = g_hash_table_new_full(crm_str_hash, g_str_equal,
+                                                 free, __xml_acl_matches_free);
+    }
+    g_hash_table_replace(doc->acl_matches, strdup(user), matches);
+    return matches;
+}
+
+/*!
+ * \internal
+ * \brief Copy the parts of an XML subtree that ACLs allow a user to read
+ *
+ * This gives the same result as copying the subtree and then purging it of
+ * denied content, without copying anything that would be purged.
+ *
+ * Within an "open" region, everything is kept except elements denied by a
+ * rule. A denied element starts a "closed" region, where only elements
+ * readable via a rule are kept (reopening the region beneath them), along
+ * with the IDs of their ancestors in the closed region.
+ *
+ * \param[in]     src    XML to copy
+ * \param[in,out] doc    Document to create copy in
+ * \param[in]     flags  ACL flags of elements, as set by user's rules
+ * \param[in]     open   Whether \p src is in an open region
+ *
+ * \return Copy of readable parts of \p src, or NULL if none are readable
+ */
+static xmlNode *
+__xml_acl_filtered_node(xmlNode *src, xmlDoc *doc, GHashTable *flags,
+                        bool open)
+{
+    uint32_t src_flags = 0;
+    bool keep = FALSE;
+    bool readable_children = FALSE;
+    xmlNode *copy = NULL;
+
+    if (src->type != XML_ELEMENT_NODE) {
+        return open? xmlDocCopyNode(src, doc, 1) : NULL;
+    }
+
+    src_flags = GPOINTER_TO_UINT(g_hash_table_lookup(flags, src));
+    keep = (open && is_not_set(src_flags, xpf_acl_deny))
+           || __xml_acl_mode_test(src_flags, xpf_acl_read);
+
+    // Copy the element itself, with all attributes only if readable
+    copy = xmlDocCopyNode(src, doc, (keep? 2 : 0));
+    CRM_ASSERT(copy != NULL);
+    if (!keep && (ID(src) != NULL)) {
+        xmlSetProp(copy, (pcmkXmlStr) XML_ATTR_ID, (pcmkXmlStr) ID(src));
+    }
+
+    for (xmlNode *child = __xml_first_child(src); child != NULL;
+         child = __xml_next(child)) {
+        xmlNode *child_copy = __xml_acl_filtered_node(child, doc, flags, keep);
+
+        if (child_copy != NULL) {
+            xmlAddChild(copy, child_copy);
+            readable_children = TRUE;
+        }
+    }
+
+    if (!keep && !readable_children) {
+        xmlFreeNode(copy); // Nothing readable under here
+        return NULL;
+    }
+    return copy;
+}
+
 /*!
  * \internal
  * \brief Copy ACL-allowed portions of specified XML
@@ -437,7 +847,6 @@ bool
 xml_acl_filtered_copy(const char *user, xmlNode *acl_source, xmlNode *xml,
                       xmlNode **result)
 {
-    GListPtr aIter = NULL;
     xmlNode *target = NULL;
     xml_private_t *p = NULL;
     xml_private_t *doc = NULL;
@@ -450,6 +859,36 @@ xml_acl_filtered_copy(const char *user, xmlNode *acl_source, xmlNode *xml,
     }
 
     crm_trace("Filtering XML copy using user '%s' ACLs", user);
+
+    if ((xml->doc != NULL) && (xmlDocGetRootElement(xml->doc) == xml)) {
+        /* Copy only what is readable, using the (possibly cached) matches of
+         * the user's rules in the original document
+         */
+        struct acl_matches_s *matches = __xml_acl_matches(acl_source, xml,
+                                                          user);
+        xmlDoc *filtered = NULL;
+
+        if (!matches->has_acls) {
+            crm_trace("User '%s' without ACLs denied access to entire XML document",
+                      user);
+            return TRUE;
+        }
+
+        filtered = xmlNewDoc((pcmkXmlStr) "1.0");
+        CRM_ASSERT(filtered != NULL);
+        target = __xml_acl_filtered_node(xml, filtered, matches->flags, TRUE);
+        if (target == NULL) {
+            crm_trace("ACLs deny user '%s' access to entire XML document",
+                      user);
+            xmlFreeDoc(filtered);
+            return TRUE;
+        }
+        xmlDocSetRootElement(filtered, target);
+        *result = target;
+        return TRUE;
+    }
+
+    // Subtrees are matched against a full copy, as rules are absolute
     target = copy_xml(xml);
     if (target == NULL) {
         return TRUE;
@@ -460,33 +899,7 @@ xml_acl_filtered_copy(const char *user, xmlNode *acl_source, xmlNode *xml,
     pcmk__apply_acl(target);
 
     doc = target->doc->_private;
-    for(aIter = doc->acls; aIter != NULL && target; aIter = aIter->next) {
-        int max = 0;
-        xml_acl_t *acl = aIter->data;
-
-        if (acl->mode != xpf_acl_deny) {
-            /* Nothing to do */
-
-        } else if (acl->xpath) {
-            int lpc = 0;
-            xmlXPathObjectPtr xpathObj = xpath_search(target, acl->xpath);
-
-            max = numXpathResults(xpathObj);
-            for(lpc = 0; lpc < max; lpc++) {
-                xmlNode *match = getXpathResult(xpathObj, lpc);
-
-                if (__xml_purge_attributes(match) == FALSE && match == target) {
-                    crm_trace("ACLs deny user '%s' access to entire XML document",
-                              user);
-                    freeXpathObject(xpathObj);
-                    return TRUE;
-                }
-            }
-            crm_trace("ACLs deny user '%s' access to %s (%d match%s)",
-                      user, acl->xpath, max, ((max == 1)? "" : "es"));
-            freeXpathObject(xpathObj);
-        }
-    }
+    __xml_purge_denied_children(target);
 
     p = target->_private;
     if (is_set(p->flags, xpf_acl_deny)
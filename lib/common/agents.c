@@ -14,9 +14,15 @@
 #include <stdio.h>
 #include <string.h>
 #include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include <crm/crm.h>
+#include <crm/msg_xml.h>
 #include <crm/common/util.h>
+#include <crm/common/xml.h>
 
 /*!
  * \brief Get capabilities of a resource agent standard
@@ -144,3 +150,226 @@ crm_parse_agent_spec(const char *spec, char **standard, char **provider,
     *type = strdup(spec);
     return pcmk_ok;
 }
+
+/*
+ * Resource agent meta-data rarely changes, but collecting it means executing
+ * the agent. Meta-data is cached on disk so that it survives daemon restarts,
+ * keyed by the agent's standard, provider, and type, and validated against the
+ * modification time, size, and inode of the file implementing the agent.
+ * Standards whose agents are not single files are not cached.
+ *
+ * The cache directory is shared by daemons running as different users, so an
+ * entry is trusted only if it was written by the same user that reads it.
+ */
+
+#define XML_TAG_AGENT_METADATA "agent-metadata"
+
+/*!
+ * \internal
+ * \brief Get the path of the file implementing a resource agent
+ *
+ * \param[in] standard  Agent standard
+ * \param[in] provider  Agent provider (or NULL)
+ * \param[in] type      Agent type
+ *
+ * \return Newly allocated path, or NULL if agent meta-data cannot be cached
+ */
+static char *
+agent_path(const char *standard, const char *provider, const char *type)
+{
+    if ((standard == NULL) || (type == NULL) || (strchr(type, '/') != NULL)) {
+        return NULL;
+    }
+
+    if (!strcasecmp(standard, PCMK_RESOURCE_CLASS_OCF)) {
+        if ((provider == NULL) || (strchr(provider, '/') != NULL)) {
+            return NULL;
+        }
+        return crm_strdup_printf(OCF_RA_DIR "/%s/%s", provider, type);
+
+    } else if (!strcasecmp(standard, PCMK_RESOURCE_CLASS_STONITH)
+               && crm_starts_with(type, RH_STONITH_PREFIX)) {
+        return crm_strdup_printf(RH_STONITH_DIR "/%s", type);
+    }
+    return NULL;
+}
+
+static char *
+metadata_cache_file(const char *standard, const char *provider,
+                    const char *type)
+{
+    char *key = crm_generate_ra_key(standard, provider, type);
+    char *file = crm_strdup_printf(CRM_METADATA_DIR "/%s.xml", key);
+
+    free(key);
+    return file;
+}
+
+/*!
+ * \internal
+ * \brief Parse a meta-data cache entry, if it can be trusted
+ *
+ * \param[in] file  Path of cache entry
+ *
+ * \return Parsed entry (which the caller must free with free_xml()), or NULL if
+ *         the entry does not exist, is not a regular file owned by and only
+ *         writable by the effective user, or cannot be parsed
+ */
+static xmlNode *
+read_cache_entry(const char *file)
+{
+    int fd = open(file, O_RDONLY|O_NOFOLLOW|O_CLOEXEC);
+    FILE *stream = NULL;
+    char *contents = NULL;
+    xmlNode *xml = NULL;
+    struct stat sb;
+
+    if (fd < 0) {
+        return NULL;
+    }
+    if ((fstat(fd, &sb) < 0) || !S_ISREG(sb.st_mode)
+        || (sb.st_uid != geteuid())
+        || ((sb.st_mode & (S_IWGRP|S_IWOTH)) != 0)) {
+        crm_debug("Ignoring untrusted meta-data cache entry %s", file);
+        close(fd);
+        return NULL;
+    }
+
+    stream = fdopen(fd, "r");
+    if (stream == NULL) {
+        close(fd);
+        return NULL;
+    }
+    if (sb.st_size > 0) {
+        contents = calloc(1, sb.st_size + 1);
+        CRM_ASSERT(contents != NULL);
+        if (fread(contents, 1, sb.st_size, stream) == (size_t) sb.st_size) {
+            xml = string2xml(contents);
+        }
+        free(contents);
+    }
+    fclose(stream);
+    return xml;
+}
+
+/*!
+ * \internal
+ * \brief Get resource agent meta-data from the on-disk cache
+ *
+ * \param[in] standard  Agent standard
+ * \param[in] provider  Agent provider (or NULL)
+ * \param[in] type      Agent type
+ *
+ * \return Newly allocated meta-data, or NULL if no valid entry is cached
+ * \note The caller is responsible for freeing the result.
+ */
+char *
+pcmk__cached_agent_metadata(const char *standard, const char *provider,
+                            const char *type)
+{
+    char *path = agent_path(standard, provider, type);
+    char *file = NULL;
+    char *metadata = NULL;
+    xmlNode *xml = NULL;
+    struct stat sb;
+    long long value = 0;
+
+    if ((path == NULL) || (stat(path, &sb) < 0)) {
+        free(path);
+        return NULL;
+    }
+
+    file = metadata_cache_file(standard, provider, type);
+    xml = read_cache_entry(file);
+    if ((xml == NULL) || safe_str_neq(crm_element_name(xml),
+                                      XML_TAG_AGENT_METADATA)
+        || safe_str_neq(crm_element_value(xml, "path"), path)) {
+        crm_debug("Ignoring invalid meta-data cache entry %s", file);
+        goto done;
+    }
+
+    if ((crm_element_value_ll(xml, "mtime", &value) < 0)
+        || (value != (long long) sb.st_mtime)
+        || (crm_element_value_ll(xml, "size", &value) < 0)
+        || (value != (long long) sb.st_size)
+        || (crm_element_value_ll(xml, "inode", &value) < 0)
+        || (value != (long long) sb.st_ino)) {
+        crm_debug("Cached meta-data for %s is stale", path);
+        goto done;
+    }
+
+    if (__xml_first_child_element(xml) != NULL) {
+        metadata = dump_xml_formatted(__xml_first_child_element(xml));
+        crm_trace("Using cached meta-data for %s", path);
+    }
+
+done:
+    free_xml(xml);
+    free(file);
+    free(path);
+    return metadata;
+}
+
+/*!
+ * \internal
+ * \brief Store resource agent meta-data in the on-disk cache
+ *
+ * \param[in] standard  Agent standard
+ * \param[in] provider  Agent provider (or NULL)
+ * \param[in] type      Agent type
+ * \param[in] metadata  Meta-data as returned by the agent
+ */
+void
+pcmk__cache_agent_metadata(const char *standard, const char *provider,
+                           const char *type, const char *metadata)
+{
+    char *path = agent_path(standard, provider, type);
+    char *file = NULL;
+    char *tmp = NULL;
+    int fd = -1;
+    xmlNode *xml = NULL;
+    xmlNode *metadata_xml = NULL;
+    struct stat sb;
+
+    if ((path == NULL) || (metadata == NULL) || (stat(path, &sb) < 0)
+        || (access(CRM_METADATA_DIR, W_OK) < 0)) {
+        free(path);
+        return;
+    }
+
+    metadata_xml = string2xml(metadata);
+    if (metadata_xml == NULL) {
+        free(path);
+        return;
+    }
+
+    xml = create_xml_node(NULL, XML_TAG_AGENT_METADATA);
+    crm_xml_add(xml, "path", path);
+    crm_xml_add_ll(xml, "mtime", (long long) sb.st_mtime);
+    crm_xml_add_ll(xml, "size", (long long) sb.st_size);
+    crm_xml_add_ll(xml, "inode", (long long) sb.st_ino);
+    add_node_nocopy(xml, NULL, metadata_xml);
+
+    /* Write a temporary file first so readers never see a partial entry. The
+     * file is created exclusively (by mkstemp()), so nothing already in the
+     * directory can redirect the write.
+     */
+    file = metadata_cache_file(standard, provider, type);
+    tmp = crm_strdup_printf("%s.XXXXXX", file);
+    fd = mkstemp(tmp);
+    if (fd < 0) {
+        crm_perror(LOG_DEBUG, "Could not create temporary file %s", tmp);
+    } else if (write_xml_fd(xml, tmp, fd, FALSE) <= 0) {
+        unlink(tmp);
+    } else if (rename(tmp, file) < 0) {
+        crm_perror(LOG_DEBUG, "Could not cache meta-data in %s", file);
+        unlink(tmp);
+    } else {
+        crm_trace("Cached meta-data for %s in %s", path, file);
+    }
+
+    free_xml(xml);
+    free(tmp);
+    free(file);
+    free(path);
+}
@@ -221,6 +221,35 @@ done:
     return rc;
 }
 
+/*!
+ * \internal
+ * \brief Create a pacemaker-attrd request to clear resource failure
+ *
+ * \param[in] host           Affect only this host (or NULL for all hosts)
+ * \param[in] resource       Name of resource to clear (or NULL for all)
+ * \param[in] operation      Name of operation to clear (or NULL for all)
+ * \param[in] interval_spec  If operation is not NULL, its interval
+ * \param[in] user_name      ACL user to pass to pacemaker-attrd
+ * \param[in] options        attrd_opt_remote if host is a Pacemaker Remote node
+ *
+ * \return XML of pacemaker-attrd request (which the caller must free)
+ */
+xmlNode *
+pcmk__attrd_clear_op(const char *host, const char *resource,
+                     const char *operation, const char *interval_spec,
+                     const char *user_name, int options)
+{
+    xmlNode *clear_op = create_attrd_op(user_name);
+
+    crm_xml_add(clear_op, F_ATTRD_TASK, ATTRD_OP_CLEAR_FAILURE);
+    crm_xml_add(clear_op, F_ATTRD_HOST, host);
+    crm_xml_add(clear_op, F_ATTRD_RESOURCE, resource);
+    crm_xml_add(clear_op, F_ATTRD_OPERATION, operation);
+    crm_xml_add(clear_op, F_ATTRD_INTERVAL, interval_spec);
+    crm_xml_add_int(clear_op, F_ATTRD_IS_REMOTE, is_set(options, attrd_opt_remote));
+    return clear_op;
+}
+
 /*!
  * \brief Send a request to pacemaker-attrd to clear resource failure
  *
@@ -240,17 +269,11 @@ attrd_clear_delegate(crm_ipc_t *ipc, const char *host, const char *resource,
                      const char *user_name, int options)
 {
     int rc = pcmk_ok;
-    xmlNode *clear_op = create_attrd_op(user_name);
+    xmlNode *clear_op = pcmk__attrd_clear_op(host, resource, operation,
+                                             interval_spec, user_name, options);
     const char *interval_desc = NULL;
     const char *op_desc = NULL;
 
-    crm_xml_add(clear_op, F_ATTRD_TASK, ATTRD_OP_CLEAR_FAILURE);
-    crm_xml_add(clear_op, F_ATTRD_HOST, host);
-    crm_xml_add(clear_op, F_ATTRD_RESOURCE, resource);
-    crm_xml_add(clear_op, F_ATTRD_OPERATION, operation);
-    crm_xml_add(clear_op, F_ATTRD_INTERVAL, interval_spec);
-    crm_xml_add_int(clear_op, F_ATTRD_IS_REMOTE, is_set(options, attrd_opt_remote));
-
     rc = send_attrd_op(ipc, clear_op);
     free_xml(clear_op);
 
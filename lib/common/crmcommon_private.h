@@ -42,6 +42,7 @@ typedef struct xml_private_s {
         char *user;
         GListPtr acls;
         GListPtr deleted_objs;
+        GHashTable *acl_matches;    // Cached ACL matches by user (see acl.c)
 } xml_private_t;
 
 G_GNUC_INTERNAL
@@ -57,6 +58,12 @@ int pcmk__element_xpath(const char *prefix, xmlNode *xml, char *buffer,
 G_GNUC_INTERNAL
 void pcmk__free_acls(GList *acls);
 
+G_GNUC_INTERNAL
+void pcmk__free_acl_cache(void);
+
+G_GNUC_INTERNAL
+void pcmk__free_acl_matches(GHashTable *matches);
+
 G_GNUC_INTERNAL
 void pcmk__unpack_acl(xmlNode *source, xmlNode *target, const char *user);
 
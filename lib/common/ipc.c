@@ -32,14 +32,24 @@
 #include <fcntl.h>
 #include <bzlib.h>
 
+#include <qb/qbutil.h>
+
 #include <crm/crm.h>   /* indirectly: pcmk_err_generic */
 #include <crm/msg_xml.h>
 #include <crm/common/ipc.h>
 #include <crm/common/ipcs.h>
 
 #include <crm/common/ipc_internal.h>  /* PCMK__SPECIAL_PID* */
+#include <crm/common/trace_internal.h>
 
-#define PCMK_IPC_VERSION 1
+/* Newest message format understood. Messages are stamped with the oldest
+ * version able to parse them, so peers that predate shared memory payloads
+ * reject those rather than misreading them (though negotiation should
+ * prevent them from being sent such messages in the first place).
+ */
+#define PCMK_IPC_VERSION        2
+#define PCMK__IPC_VERSION_BASE  1   // Inline or compressed payload
+#define PCMK__IPC_VERSION_SHM   2   // Payload in shared memory file
 
 /* Evict clients whose event queue grows this large (by default) */
 #define PCMK_IPC_DEFAULT_QUEUE_MAX 500
@@ -56,6 +66,313 @@ static int hdr_offset = 0;
 static unsigned int ipc_buffer_max = 0;
 static unsigned int pick_ipc_buffer(unsigned int max);
 
+/* Messages too large for the IPC buffer are passed between privileged local
+ * processes via a file in this memory-backed directory instead of compressed
+ */
+#define PCMK__IPC_SHM_DIR       "/dev/shm"
+#define PCMK__IPC_SHM_PREFIX    "pcmk-ipc-"
+
+/* Shared memory files older than this (in seconds) when a cluster starts are
+ * left over from a process that exited without removing them
+ */
+#define PCMK__IPC_SHM_STALE_S   300
+
+/*!
+ * \internal
+ * \brief Check whether a user ID is trusted for shared memory IPC payloads
+ *
+ * \param[in] uid  User ID to check
+ *
+ * \return true if \p uid is root or the cluster user, otherwise false
+ */
+static bool
+ipc_shm_trusted_uid(uid_t uid)
+{
+    static uid_t cl_uid = 0;
+    static gid_t cl_gid = 0;
+    static bool looked_up = FALSE;
+
+    if (!looked_up) {
+        looked_up = TRUE;
+        if (crm_user_lookup(CRM_DAEMON_USER, &cl_uid, &cl_gid) < 0) {
+            cl_uid = 0;
+        }
+    }
+    return (uid == 0) || ((cl_uid != 0) && (uid == cl_uid));
+}
+
+/*!
+ * \internal
+ * \brief Check whether this process may exchange shared memory IPC payloads
+ *
+ * \return true if effective user is root or the cluster user, otherwise false
+ */
+static inline bool
+ipc_shm_capable(void)
+{
+    return ipc_shm_trusted_uid(geteuid());
+}
+
+/*!
+ * \internal
+ * \brief Forget sent shared memory files that their receiver has removed
+ *
+ * \param[in,out] files  List of sent file names
+ */
+static void
+ipc_shm_prune(GList **files)
+{
+    GList *iter = *files;
+
+    while (iter != NULL) {
+        GList *next = iter->next;
+        char *path = crm_strdup_printf(PCMK__IPC_SHM_DIR "/%s",
+                                       (const char *) iter->data);
+
+        if ((access(path, F_OK) < 0) && (errno == ENOENT)) {
+            free(iter->data);
+            *files = g_list_delete_link(*files, iter);
+        }
+        free(path);
+        iter = next;
+    }
+}
+
+/*!
+ * \internal
+ * \brief Remove all shared memory files a connection has sent
+ *
+ * Receivers remove files as they read them, so this removes only the files of
+ * messages that were never read, such as when a peer disconnects, times out,
+ * or is evicted with messages still queued.
+ *
+ * \param[in,out] files  List of sent file names (will be emptied)
+ */
+static void
+ipc_shm_remove_all(GList **files)
+{
+    for (GList *iter = *files; iter != NULL; iter = iter->next) {
+        char *path = crm_strdup_printf(PCMK__IPC_SHM_DIR "/%s",
+                                       (const char *) iter->data);
+
+        if (unlink(path) == 0) {
+            crm_trace("Removed unread shared memory IPC payload %s", path);
+        }
+        free(path);
+    }
+    g_list_free_full(*files, free);
+    *files = NULL;
+}
+
+/*!
+ * \internal
+ * \brief Remove shared memory IPC payloads left behind by exited processes
+ *
+ * Senders remove their unread files when a connection ends, but not if they
+ * exit abnormally, so this should be called once when the cluster starts.
+ */
+void
+pcmk__ipc_shm_sweep(void)
+{
+    DIR *dir = opendir(PCMK__IPC_SHM_DIR);
+    struct dirent *entry = NULL;
+    time_t cutoff = time(NULL) - PCMK__IPC_SHM_STALE_S;
+    int removed = 0;
+
+    if (dir == NULL) {
+        return;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat st;
+
+        if (!crm_starts_with(entry->d_name, PCMK__IPC_SHM_PREFIX)
+            || (fstatat(dirfd(dir), entry->d_name, &st,
+                        AT_SYMLINK_NOFOLLOW) < 0)
+            || !S_ISREG(st.st_mode) || (st.st_mtime > cutoff)
+            || !ipc_shm_trusted_uid(st.st_uid)) {
+            continue;
+        }
+        if (unlinkat(dirfd(dir), entry->d_name, 0) == 0) {
+            removed++;
+        }
+    }
+    closedir(dir);
+    if (removed > 0) {
+        crm_info("Removed %d stale shared memory IPC payload%s",
+                 removed, ((removed == 1)? "" : "s"));
+    }
+}
+
+/*!
+ * \internal
+ * \brief Write an IPC payload to a new shared memory file
+ *
+ * The file is readable only by the cluster user (and root), so this must be
+ * used only when both ends of the connection are privileged.
+ *
+ * \param[in]     buffer  Payload to write
+ * \param[in]     len     Number of bytes of \p buffer to write
+ * \param[in,out] files   List of files sent on this connection, to which the
+ *                        new file's name will be added
+ *
+ * \return Newly allocated name of file (relative to PCMK__IPC_SHM_DIR) on
+ *         success, otherwise NULL
+ */
+static char *
+ipc_shm_write(const char *buffer, size_t len, GList **files)
+{
+    char *path = strdup(PCMK__IPC_SHM_DIR "/" PCMK__IPC_SHM_PREFIX "XXXXXX");
+    char *name = NULL;
+    size_t offset = 0;
+    int fd = -1;
+
+    CRM_ASSERT(path != NULL);
+
+    fd = mkstemp(path);
+    if (fd < 0) {
+        crm_debug("Could not create shared memory file for IPC: %s "
+                  CRM_XS " errno=%d", strerror(errno), errno);
+        free(path);
+        return NULL;
+    }
+
+    if (geteuid() == 0) {
+        uid_t cl_uid = 0;
+        gid_t cl_gid = 0;
+
+        // Let a receiving cluster daemon read (and remove) the file
+        if ((crm_user_lookup(CRM_DAEMON_USER, &cl_uid, &cl_gid) < 0)
+            || (fchown(fd, cl_uid, cl_gid) < 0)) {
+            goto bail;
+        }
+    }
+
+    while (offset < len) {
+        ssize_t rc = write(fd, buffer + offset, len - offset);
+
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            crm_debug("Could not write shared memory file for IPC: %s "
+                      CRM_XS " errno=%d", strerror(errno), errno);
+            goto bail;
+        }
+        offset += rc;
+    }
+
+    close(fd);
+    name = strdup(path + strlen(PCMK__IPC_SHM_DIR "/"));
+    CRM_ASSERT(name != NULL);
+    free(path);
+
+    /* The sender remains responsible for the file until it is read, so
+     * remember it (forgetting any that have been read since the last send)
+     */
+    ipc_shm_prune(files);
+    *files = g_list_prepend(*files, strdup(name));
+    return name;
+
+  bail:
+    close(fd);
+    unlink(path);
+    free(path);
+    return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Read (and remove) a shared memory file holding an IPC payload
+ *
+ * \param[in]  name  Name of file (relative to PCMK__IPC_SHM_DIR)
+ * \param[out] dest  Where to store payload (must hold at least \p size bytes)
+ * \param[in]  size  Expected payload size, including terminating nul
+ *
+ * \return pcmk_ok on success, otherwise -errno
+ */
+static int
+ipc_shm_read(const char *name, char *dest, uint32_t size)
+{
+    char *path = NULL;
+    struct stat st;
+    size_t offset = 0;
+    int rc = pcmk_ok;
+    int fd = -1;
+
+    if ((name == NULL) || (size == 0)
+        || !crm_starts_with(name, PCMK__IPC_SHM_PREFIX)
+        || (strchr(name, '/') != NULL)) {
+        crm_err("Invalid shared memory IPC payload name");
+        return -EBADMSG;
+    }
+
+    path = crm_strdup_printf(PCMK__IPC_SHM_DIR "/%s", name);
+    fd = open(path, O_RDONLY|O_NOFOLLOW|O_CLOEXEC);
+    if (fd < 0) {
+        rc = -errno;
+        crm_err("Could not open shared memory IPC payload %s: %s",
+                path, pcmk_strerror(rc));
+        free(path);
+        return rc;
+    }
+
+    // The payload is consumed exactly once, so remove it right away
+    unlink(path);
+
+    if ((fstat(fd, &st) < 0) || !S_ISREG(st.st_mode)
+        || (st.st_size != size) || !ipc_shm_trusted_uid(st.st_uid)
+        || ((st.st_mode & (S_IRWXG|S_IRWXO)) != 0)) {
+        crm_err("Refusing unexpected shared memory IPC payload %s", path);
+        rc = -EBADMSG;
+        goto done;
+    }
+
+    while (offset < size) {
+        ssize_t n = read(fd, dest + offset, size - offset);
+
+        if ((n < 0) && (errno == EINTR)) {
+            continue;
+        } else if (n <= 0) {
+            rc = (n < 0)? -errno : -EBADMSG;
+            crm_err("Could not read shared memory IPC payload %s: %s",
+                    path, pcmk_strerror(rc));
+            goto done;
+        }
+        offset += n;
+    }
+
+    if (dest[size - 1] != '\0') {
+        crm_err("Shared memory IPC payload %s is not terminated", path);
+        rc = -EBADMSG;
+    }
+
+  done:
+    close(fd);
+    free(path);
+    return rc;
+}
+
+/*!
+ * \internal
+ * \brief Remove the shared memory file of an IPC message that was not sent
+ *
+ * \param[in] event  I/O vector of message
+ */
+static void
+ipc_shm_discard(struct iovec *event)
+{
+    struct crm_ipc_response_header *header = event[0].iov_base;
+
+    if (is_set(header->flags, crm_ipc_shm)) {
+        char *path = crm_strdup_printf(PCMK__IPC_SHM_DIR "/%s",
+                                       (const char *) event[1].iov_base);
+
+        unlink(path);
+        free(path);
+    }
+}
+
+
 static inline void
 crm_ipc_init(void)
 {
@@ -331,6 +648,7 @@ client_from_connection(qb_ipcs_connection_t *c, void *key, uid_t uid_client)
         }
     }
 
+    client->stats.connected = time(NULL);
     client->id = crm_generate_uuid();
     if (client->id == NULL) {
         crm_err("Could not generate UUID for client");
@@ -434,6 +752,8 @@ pcmk_free_ipc_event(struct iovec *event)
 static void
 free_event(gpointer data)
 {
+    // Only unsent events are freed this way
+    ipc_shm_discard((struct iovec *) data);
     pcmk_free_ipc_event((struct iovec *) data);
 }
 
@@ -444,6 +764,8 @@ add_event(crm_client_t *c, struct iovec *iov)
         c->event_queue = g_queue_new();
     }
     g_queue_push_tail(c->event_queue, iov);
+    c->stats.queue_high = QB_MAX(c->stats.queue_high,
+                                 g_queue_get_length(c->event_queue));
 }
 
 void
@@ -474,6 +796,10 @@ crm_client_destroy(crm_client_t * c)
         crm_debug("Destroying %d events", g_queue_get_length(c->event_queue));
         g_queue_free_full(c->event_queue, free_event);
     }
+    ipc_shm_remove_all(&(c->shm_files));
+    if (c->async_requests) {
+        g_hash_table_destroy(c->async_requests);
+    }
 
     free(c->id);
     free(c->name);
@@ -520,6 +846,24 @@ crm_ipcs_client_pid(qb_ipcs_connection_t * c)
     return stats.client_pid;
 }
 
+/* Number of clients evicted for not consuming events */
+static unsigned int ipc_evictions = 0;
+
+/* Most events to send to one client before yielding to the main loop */
+#define PCMK_IPC_FLUSH_BATCH        100
+
+/* Bounds (in ms) of the delay before retrying a client whose buffer is full */
+#define PCMK_IPC_FLUSH_DELAY_MIN    10
+#define PCMK_IPC_FLUSH_DELAY_MAX    1500
+
+/* Evict a client whose event queue stays over its threshold without shrinking
+ * for this long (in seconds), or grows to this multiple of its threshold
+ */
+#define PCMK_IPC_BACKLOG_GRACE_S    5
+#define PCMK_IPC_QUEUE_HARD_FACTOR  4
+
+static gboolean crm_ipcs_flush_events_cb(gpointer data);
+
 xmlNode *
 crm_ipcs_recv(crm_client_t * c, void *data, size_t size, uint32_t * id, uint32_t * flags)
 {
@@ -534,6 +878,32 @@ crm_ipcs_recv(crm_client_t * c, void *data, size_t size, uint32_t * id, uint32_t
     if (flags) {
         *flags = header->flags;
     }
+    pcmk__trace(pcmk__trace_ipcs_recv, c->pid, size,
+                ((struct qb_ipc_response_header *)data)->id);
+
+    c->stats.recv_msgs++;
+    c->stats.recv_bytes += size;
+    c->stats.recv_raw_bytes += header->size_uncompressed;
+    if (is_set(header->flags, crm_ipc_client_response)
+        || (c->stats.request_ns == 0)) {
+        /* Time synchronous requests individually. Other requests may be
+         * answered on the event channel (see pcmk__ipcs_reply_sent()), and are
+         * timed from the oldest one still awaiting a reply.
+         */
+        c->stats.request_ns = qb_util_nano_current_get();
+    }
+
+    if (is_set(header->flags, crm_ipc_client_async)) {
+        /* The client has other requests in flight, and will look for the
+         * response to this one on the event channel
+         */
+        if (c->async_requests == NULL) {
+            c->async_requests = g_hash_table_new(g_direct_hash, g_direct_equal);
+        }
+        g_hash_table_insert(c->async_requests,
+                            GUINT_TO_POINTER(header->qb.id),
+                            GUINT_TO_POINTER(header->qb.id));
+    }
 
     if (is_set(header->flags, crm_ipc_proxied)) {
         /* Mark this client as being the endpoint of a proxy connection.
@@ -543,13 +913,48 @@ crm_ipcs_recv(crm_client_t * c, void *data, size_t size, uint32_t * id, uint32_t
         c->flags |= crm_client_flag_ipc_proxied;
     }
 
+    if (c->event_timer && (c->flush_delay > PCMK_IPC_FLUSH_DELAY_MIN)) {
+        /* A client that sends us requests is evidently processing again, so
+         * don't make it wait out the rest of its event queue backoff. Flush
+         * from the main loop rather than here, since a flush may evict (and
+         * free) the client while the caller is still using it.
+         */
+        g_source_remove(c->event_timer);
+        c->flush_delay = 0;
+        c->event_timer = g_timeout_add(0, crm_ipcs_flush_events_cb, c);
+    }
+
     if(header->version > PCMK_IPC_VERSION) {
         crm_err("Filtering incompatible v%d IPC message, we only support versions <= %d",
                 header->version, PCMK_IPC_VERSION);
         return NULL;
     }
 
-    if (header->size_compressed) {
+    if (is_set(header->flags, crm_ipc_shm_capable)
+        && is_not_set(c->flags, crm_client_flag_ipc_shm)) {
+        crm_trace("Client %s accepts shared memory IPC payloads",
+                  crm_client_name(c));
+        set_bit(c->flags, crm_client_flag_ipc_shm);
+    }
+
+    if (is_set(header->flags, crm_ipc_shm)) {
+        if (is_not_set(c->flags, crm_client_flag_ipc_privileged)) {
+            crm_err("Filtering shared memory IPC message from unprivileged "
+                    "client %s", crm_client_name(c));
+            return NULL;
+        }
+
+        uncompressed = calloc(1, header->size_uncompressed);
+        CRM_ASSERT(uncompressed != NULL);
+        ((char *) data)[size - 1] = '\0'; // Guard name
+        if (ipc_shm_read(text, uncompressed,
+                         header->size_uncompressed) != pcmk_ok) {
+            free(uncompressed);
+            return NULL;
+        }
+        text = uncompressed;
+
+    } else if (header->size_compressed) {
         int rc = 0;
         unsigned int size_u = 1 + header->size_uncompressed;
         uncompressed = calloc(1, size_u);
@@ -591,20 +996,93 @@ crm_ipcs_flush_events_cb(gpointer data)
 
 /*!
  * \internal
- * \brief Add progressive delay before next event queue flush
+ * \brief Schedule the next event queue flush for a client
+ *
+ * If the last flush stopped only because it reached the batch limit, resume as
+ * soon as the main loop gets back to us. Otherwise, the client's buffer is
+ * full, so retry after a delay that starts small and doubles for as long as the
+ * client makes no progress, up to a maximum.
  *
- * \param[in,out] c          Client connection to add delay to
- * \param[in]     queue_len  Current event queue length
+ * \param[in,out] c        Client connection to schedule flush for
+ * \param[in]     blocked  Whether the last flush failed to send an event
  */
 static inline void
-delay_next_flush(crm_client_t *c, unsigned int queue_len)
+delay_next_flush(crm_client_t *c, bool blocked)
 {
-    /* Delay a maximum of 1.5 seconds */
-    guint delay = (queue_len < 5)? (1000 + 100 * queue_len) : 1500;
+    guint delay = 0;
 
+    if (blocked) {
+        if (c->flush_delay == 0) {
+            c->flush_delay = PCMK_IPC_FLUSH_DELAY_MIN;
+        } else {
+            c->flush_delay = QB_MIN(2 * c->flush_delay,
+                                    PCMK_IPC_FLUSH_DELAY_MAX);
+        }
+        delay = c->flush_delay;
+    }
     c->event_timer = g_timeout_add(delay, crm_ipcs_flush_events_cb, c);
 }
 
+/*!
+ * \internal
+ * \brief Evict a client if its event queue backlog is out of control
+ *
+ * Clients may briefly fall behind on processing incoming messages, but
+ * completely unresponsive or persistently slow clients are dropped so the
+ * connection doesn't consume resources indefinitely. A client is evicted if
+ * its queue grows past a hard limit, or if (as of a flush) its queue has been
+ * over the threshold for the grace period and has not shrunk since the
+ * previous flush. This does not depend on the flush backoff, so a client
+ * that reads only an occasional event cannot avoid eviction that way.
+ *
+ * \param[in,out] c          Client connection to check
+ * \param[in]     queue_len  Current length of client's event queue
+ * \param[in]     flushed    Whether a flush has just been attempted
+ *
+ * \return TRUE if client was evicted (and \p c must no longer be used),
+ *         otherwise FALSE
+ */
+static bool
+evict_backlogged_client(crm_client_t *c, unsigned int queue_len, bool flushed)
+{
+    unsigned int threshold = QB_MAX(c->queue_max, PCMK_IPC_DEFAULT_QUEUE_MAX);
+    time_t now = 0;
+
+    if (queue_len <= threshold) {
+        c->backlog_since = 0;
+        return FALSE;
+    }
+
+    now = time(NULL);
+    if (c->backlog_since == 0) {
+        c->backlog_since = now;
+        crm_warn("Client with process ID %u has a backlog of %u messages "
+                 CRM_XS " %p", c->pid, queue_len, c->ipcs);
+    }
+
+    if (queue_len <= (PCMK_IPC_QUEUE_HARD_FACTOR * threshold)) {
+        if (!flushed || ((now - c->backlog_since) < PCMK_IPC_BACKLOG_GRACE_S)
+            || (queue_len < c->queue_backlog)) {
+            /* Don't evict for a new or shrinking backlog */
+            return FALSE;
+        }
+    }
+
+    crm_err("Evicting client with process ID %u due to backlog of %u messages "
+             CRM_XS " %p", c->pid, queue_len, c->ipcs);
+    crm_info("Evicted client %s had received %llu messages "
+             "(%llu bytes) and been blocked %u times in %lds",
+             crm_client_name(c),
+             (unsigned long long) c->stats.sent_msgs,
+             (unsigned long long) c->stats.sent_bytes,
+             c->stats.blocked, (long) (now - c->backlog_since));
+    ipc_evictions++;
+    c->queue_backlog = 0;
+    c->backlog_since = 0;
+    qb_ipcs_disconnect(c->ipcs);
+    return TRUE;
+}
+
 ssize_t
 crm_ipcs_flush_events(crm_client_t * c)
 {
@@ -614,17 +1092,24 @@ crm_ipcs_flush_events(crm_client_t * c)
 
     if (c == NULL) {
         return pcmk_ok;
+    }
+
+    if (c->event_queue) {
+        queue_len = g_queue_get_length(c->event_queue);
+    }
+
+    /* Enforce the hard limit even while backing off, since events keep being
+     * queued in the meantime
+     */
+    if (evict_backlogged_client(c, queue_len, FALSE)) {
+        return -ENOBUFS;
 
     } else if (c->event_timer) {
         /* There is already a timer, wait until it goes off */
         crm_trace("Timer active for %p - %d", c->ipcs, c->event_timer);
         return pcmk_ok;
     }
-
-    if (c->event_queue) {
-        queue_len = g_queue_get_length(c->event_queue);
-    }
-    while (sent < 100) {
+    while (sent < PCMK_IPC_FLUSH_BATCH) {
         struct crm_ipc_response_header *header = NULL;
         struct iovec *event = NULL;
 
@@ -638,6 +1123,7 @@ crm_ipcs_flush_events(crm_client_t * c)
 
         rc = qb_ipcs_event_sendv(c->ipcs, event, 2);
         if (rc < 0) {
+            c->stats.blocked++;
             break;
         }
         event = g_queue_pop_head(c->event_queue);
@@ -662,44 +1148,55 @@ crm_ipcs_flush_events(crm_client_t * c)
                   pcmk_strerror(rc < 0 ? rc : 0), (long long) rc);
     }
 
-    if (queue_len) {
+    if (sent > 0) {
+        /* The client is consuming events, so retry promptly if it blocks */
+        c->flush_delay = 0;
+    }
 
-        /* Allow clients to briefly fall behind on processing incoming messages,
-         * but drop completely unresponsive clients so the connection doesn't
-         * consume resources indefinitely.
-         */
-        if (queue_len > QB_MAX(c->queue_max, PCMK_IPC_DEFAULT_QUEUE_MAX)) {
-            if ((c->queue_backlog <= 1) || (queue_len < c->queue_backlog)) {
-                /* Don't evict for a new or shrinking backlog */
-                crm_warn("Client with process ID %u has a backlog of %u messages "
-                         CRM_XS " %p", c->pid, queue_len, c->ipcs);
-            } else {
-                crm_err("Evicting client with process ID %u due to backlog of %u messages "
-                         CRM_XS " %p", c->pid, queue_len, c->ipcs);
-                c->queue_backlog = 0;
-                qb_ipcs_disconnect(c->ipcs);
-                return rc;
-            }
+    if (queue_len) {
+        if (evict_backlogged_client(c, queue_len, TRUE)) {
+            return rc;
         }
-
         c->queue_backlog = queue_len;
-        delay_next_flush(c, queue_len);
+        delay_next_flush(c, (rc < 0));
 
     } else {
         /* Event queue is empty, there is no backlog */
         c->queue_backlog = 0;
+        c->backlog_since = 0;
+        c->flush_delay = 0;
     }
 
     return rc;
 }
 
-ssize_t
-crm_ipc_prepare(uint32_t request, xmlNode * message, struct iovec ** result, uint32_t max_send_size)
+/*!
+ * \internal
+ * \brief Create an I/O vector for sending an IPC XML message
+ *
+ * \param[in]  request        Identifier for libqb response header
+ * \param[in]  message        XML message to send
+ * \param[out] result         Where to store prepared I/O vector
+ * \param[in]  max_send_size  Maximum message size (or 0 for default)
+ * \param[in]  shm_files      If not NULL, a payload too large for
+ *                            \p max_send_size may be passed via shared memory
+ *                            instead of being compressed, and the file name
+ *                            will be added to this list of the connection's
+ *                            sent files
+ *
+ * \return Size of message on success, otherwise -errno
+ * \note Only pass \p shm_files if the peer has advertised (via
+ *       crm_ipc_shm_capable) that it accepts shared memory payloads.
+ */
+static ssize_t
+ipc_prepare(uint32_t request, xmlNode *message, struct iovec **result,
+            uint32_t max_send_size, GList **shm_files)
 {
     static unsigned int biggest = 0;
     struct iovec *iov;
     unsigned int total = 0;
     char *compressed = NULL;
+    char *shm_name = NULL;
     char *buffer = dump_xml_unformatted(message);
     struct crm_ipc_response_header *header = calloc(1, sizeof(struct crm_ipc_response_header));
 
@@ -718,7 +1215,11 @@ crm_ipc_prepare(uint32_t request, xmlNode * message, struct iovec ** result, uin
     iov[0].iov_len = hdr_offset;
     iov[0].iov_base = header;
 
-    header->version = PCMK_IPC_VERSION;
+    header->version = PCMK__IPC_VERSION_BASE;
+    if (ipc_shm_capable()) {
+        // Advertise on every message, so the peer learns it from the first
+        header->flags |= crm_ipc_shm_capable;
+    }
     header->size_uncompressed = 1 + strlen(buffer);
     total = iov[0].iov_len + header->size_uncompressed;
 
@@ -726,6 +1227,18 @@ crm_ipc_prepare(uint32_t request, xmlNode * message, struct iovec ** result, uin
         iov[1].iov_base = buffer;
         iov[1].iov_len = header->size_uncompressed;
 
+    } else if ((shm_files != NULL)
+               && ((shm_name = ipc_shm_write(buffer, header->size_uncompressed,
+                                             shm_files)) != NULL)) {
+
+        crm_trace("Passing %u-byte IPC message via %s",
+                  header->size_uncompressed, shm_name);
+        header->version = PCMK__IPC_VERSION_SHM;
+        header->flags |= crm_ipc_shm;
+        iov[1].iov_base = shm_name;
+        iov[1].iov_len = strlen(shm_name) + 1;
+        free(buffer);
+
     } else {
         unsigned int new_size = 0;
 
@@ -767,6 +1280,38 @@ crm_ipc_prepare(uint32_t request, xmlNode * message, struct iovec ** result, uin
     return header->qb.size;
 }
 
+ssize_t
+crm_ipc_prepare(uint32_t request, xmlNode * message, struct iovec ** result, uint32_t max_send_size)
+{
+    return ipc_prepare(request, message, result, max_send_size, NULL);
+}
+
+/*!
+ * \internal
+ * \brief Record that a reply to a client's request has been sent
+ *
+ * Replies on the response channel (and relayed or asynchronous replies sent
+ * as events) are accounted for automatically. Daemons that answer requests
+ * with ordinary events must call this once they have sent the reply, so that
+ * the client's service time statistics include those requests.
+ *
+ * \param[in,out] c  Client that reply was sent to
+ */
+void
+pcmk__ipcs_reply_sent(crm_client_t *c)
+{
+    uint64_t elapsed = 0;
+
+    if ((c == NULL) || (c->stats.request_ns == 0)) {
+        return;
+    }
+    elapsed = qb_util_nano_current_get() - c->stats.request_ns;
+    c->stats.replies++;
+    c->stats.service_ns += elapsed;
+    c->stats.service_max_ns = QB_MAX(c->stats.service_max_ns, elapsed);
+    c->stats.request_ns = 0;
+}
+
 ssize_t
 crm_ipcs_sendv(crm_client_t * c, struct iovec * iov, enum crm_ipc_flags flags)
 {
@@ -774,6 +1319,15 @@ crm_ipcs_sendv(crm_client_t * c, struct iovec * iov, enum crm_ipc_flags flags)
     static uint32_t id = 1;
     struct crm_ipc_response_header *header = iov[0].iov_base;
 
+    if (is_not_set(flags, crm_ipc_server_event) && (c->async_requests != NULL)
+        && g_hash_table_remove(c->async_requests,
+                               GUINT_TO_POINTER(header->qb.id))) {
+        /* Responses to asynchronous requests are sent as events, keeping the
+         * request ID so the client can match them up
+         */
+        flags |= crm_ipc_server_event|crm_ipc_async_response;
+    }
+
     if (c->flags & crm_client_flag_ipc_proxied) {
         /* _ALL_ replies to proxied connections need to be sent as events */
         if (is_not_set(flags, crm_ipc_server_event)) {
@@ -785,8 +1339,20 @@ crm_ipcs_sendv(crm_client_t * c, struct iovec * iov, enum crm_ipc_flags flags)
     }
 
     header->flags |= flags;
+    pcmk__trace(pcmk__trace_ipcs_send, c->pid, header->qb.size, flags);
+
+    c->stats.sent_msgs++;
+    c->stats.sent_bytes += header->qb.size;
+    c->stats.sent_raw_bytes += header->size_uncompressed;
+    if (is_not_set(flags, crm_ipc_server_event)
+        || is_set(flags, crm_ipc_proxied_relay_response)
+        || is_set(flags, crm_ipc_async_response)) {
+        pcmk__ipcs_reply_sent(c);
+    }
     if (flags & crm_ipc_server_event) {
-        header->qb.id = id++;   /* We don't really use it, but doesn't hurt to set one */
+        if (is_not_set(flags, crm_ipc_async_response)) {
+            header->qb.id = id++;   /* We don't really use it, but doesn't hurt to set one */
+        }
 
         if (flags & crm_ipc_server_free) {
             crm_trace("Sending the original to %p[%d]", c->ipcs, c->pid);
@@ -812,6 +1378,7 @@ crm_ipcs_sendv(crm_client_t * c, struct iovec * iov, enum crm_ipc_flags flags)
 
         rc = qb_ipcs_response_sendv(c->ipcs, iov, 2);
         if (rc < header->qb.size) {
+            ipc_shm_discard(iov);
             crm_notice("Response %d to pid %d failed: %s "
                        CRM_XS " bytes=%u rc=%lld ipcs=%p",
                        header->qb.id, c->pid, pcmk_strerror(rc),
@@ -852,7 +1419,13 @@ crm_ipcs_send(crm_client_t * c, uint32_t request, xmlNode * message,
     }
     crm_ipc_init();
 
-    rc = crm_ipc_prepare(request, message, &iov, ipc_buffer_max);
+    /* Large payloads can skip compression when the client may read the
+     * (cluster-user-owned) shared memory file, and has said it can
+     */
+    rc = ipc_prepare(request, message, &iov, ipc_buffer_max,
+                     (is_set(c->flags, crm_client_flag_ipc_privileged)
+                      && is_set(c->flags, crm_client_flag_ipc_shm))?
+                     &(c->shm_files) : NULL);
     if (rc > 0) {
         rc = crm_ipcs_sendv(c, iov, flags | crm_ipc_server_free);
     } else {
@@ -869,16 +1442,120 @@ crm_ipcs_send_ack(crm_client_t * c, uint32_t request, uint32_t flags, const char
 {
     if (flags & crm_ipc_client_response) {
         xmlNode *ack = create_xml_node(NULL, tag);
+        uint64_t request_ns = c->stats.request_ns;
 
         crm_trace("Ack'ing msg from %s (%p)", crm_client_name(c), c);
         c->request_id = 0;
         crm_xml_add(ack, "function", function);
         crm_xml_add_int(ack, "line", line);
+
+        /* An ack only says the request arrived, so it is not counted as a
+         * reply, and the request is still timed until an actual reply
+         */
+        c->stats.request_ns = 0;
         crm_ipcs_send(c, request, ack, flags);
+        c->stats.request_ns = request_ns;
         free_xml(ack);
     }
 }
 
+static void
+add_client_stats_xml(xmlNode *parent, crm_client_t *c)
+{
+    xmlNode *node = create_xml_node(parent, "client");
+    uint64_t avg_us = 0;
+
+    if (c->stats.replies > 0) {
+        avg_us = c->stats.service_ns / c->stats.replies / QB_TIME_NS_IN_USEC;
+    }
+
+    crm_xml_add(node, XML_ATTR_ID, c->id);
+    crm_xml_add(node, XML_ATTR_NAME, crm_client_name(c));
+    crm_xml_add(node, "type", crm_client_type_text(c->kind));
+    crm_xml_add_int(node, "pid", c->pid);
+    crm_xml_add(node, "user", c->user);
+    crm_xml_add_ll(node, "connected", (long long) c->stats.connected);
+    crm_xml_add_ll(node, "recv-msgs", (long long) c->stats.recv_msgs);
+    crm_xml_add_ll(node, "recv-bytes", (long long) c->stats.recv_bytes);
+    crm_xml_add_ll(node, "recv-raw-bytes",
+                   (long long) c->stats.recv_raw_bytes);
+    crm_xml_add_ll(node, "sent-msgs", (long long) c->stats.sent_msgs);
+    crm_xml_add_ll(node, "sent-bytes", (long long) c->stats.sent_bytes);
+    crm_xml_add_ll(node, "sent-raw-bytes",
+                   (long long) c->stats.sent_raw_bytes);
+    crm_xml_add_ll(node, "replies", (long long) c->stats.replies);
+    crm_xml_add_ll(node, "service-avg-us", (long long) avg_us);
+    crm_xml_add_ll(node, "service-max-us",
+                   (long long) (c->stats.service_max_ns / QB_TIME_NS_IN_USEC));
+    crm_xml_add_int(node, "queue-length",
+                    c->event_queue? g_queue_get_length(c->event_queue) : 0);
+    crm_xml_add_int(node, "queue-high", c->stats.queue_high);
+    crm_xml_add_int(node, "queue-max",
+                    QB_MAX(c->queue_max, PCMK_IPC_DEFAULT_QUEUE_MAX));
+    crm_xml_add_int(node, "blocked", c->stats.blocked);
+    crm_xml_add_int(node, "flush-delay-ms", c->flush_delay);
+}
+
+/*!
+ * \internal
+ * \brief Answer a request for per-client IPC statistics, if that's what it is
+ *
+ * Any daemon that accepts IPC connections can pass each request it receives
+ * here before processing it normally. Only privileged clients may view the
+ * statistics, because they reveal who else is connected.
+ *
+ * \param[in] c        Client that sent \p request
+ * \param[in] request  Request XML (may be NULL)
+ * \param[in] id       IPC request ID of \p request
+ * \param[in] flags    IPC flags of \p request
+ *
+ * \return TRUE if \p request was a statistics request (and has been answered),
+ *         otherwise FALSE
+ */
+bool
+pcmk__ipc_handle_stats_request(crm_client_t *c, xmlNode *request, uint32_t id,
+                               uint32_t flags)
+{
+    GHashTableIter iter;
+    crm_client_t *client = NULL;
+    xmlNode *reply = NULL;
+
+    if ((c == NULL) || (request == NULL)
+        || safe_str_neq(crm_element_value(request, F_CRM_TASK),
+                        CRM_OP_IPC_STATS)) {
+        return FALSE;
+    }
+
+    if (is_not_set(c->flags, crm_client_flag_ipc_privileged)) {
+        crm_warn("Rejecting IPC statistics request from unprivileged client %s",
+                 crm_client_name(c));
+        crm_ipcs_send_ack(c, id, flags, "nack", __FUNCTION__, __LINE__);
+        return TRUE;
+    }
+
+    reply = create_xml_node(NULL, "ipc-stats");
+    crm_xml_add(reply, "server", crm_system_name);
+    crm_xml_add_int(reply, "pid", getpid());
+    crm_xml_add_int(reply, "evictions", ipc_evictions);
+    crm_xml_add_int(reply, "clients", crm_hash_table_size(client_connections));
+
+    if (client_connections != NULL) {
+        g_hash_table_iter_init(&iter, client_connections);
+        while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &client)) {
+            add_client_stats_xml(reply, client);
+        }
+    }
+
+    crm_trace("Sending IPC statistics to %s", crm_client_name(c));
+    if (is_set(flags, crm_ipc_client_response)) {
+        crm_ipcs_send(c, id, reply, flags);
+    } else {
+        crm_ipcs_send(c, 0, reply, crm_ipc_server_event);
+    }
+    free_xml(reply);
+    return TRUE;
+}
+
 /* Client... */
 
 #define MIN_MSG_SIZE    12336   /* sizeof(struct qb_ipc_connection_response) */
@@ -898,8 +1575,29 @@ struct crm_ipc_s {
 
     qb_ipcc_connection_t *ipc;
 
+    bool peer_shm;          /* Server accepts shared memory payloads */
+    GList *shm_files;       /* Shared memory payloads sent (maybe unread) */
+
+    GHashTable *pending;    /* Outstanding asynchronous requests, by ID */
 };
 
+/* Request IDs are shared by all connections (and by synchronous and
+ * asynchronous requests), so that replies are never ambiguous
+ */
+static uint32_t ipc_request_id = 0;
+
+static inline uint32_t
+next_request_id(void)
+{
+    ipc_request_id++;
+    CRM_LOG_ASSERT(ipc_request_id != 0); /* Crude wrap-around detection */
+    return ipc_request_id;
+}
+
+static void ipc_complete_pending(crm_ipc_t *client, uint32_t request_id,
+                                 int rc, xmlNode *reply);
+static void ipc_fail_pending(crm_ipc_t *client, int rc);
+
 static unsigned int
 pick_ipc_buffer(unsigned int max)
 {
@@ -1031,6 +1729,9 @@ crm_ipc_close(crm_ipc_t * client)
             client->ipc = NULL;
             qb_ipcc_disconnect(ipc);
         }
+        ipc_fail_pending(client, -ENOTCONN);
+        ipc_shm_remove_all(&(client->shm_files));
+        client->peer_shm = FALSE;
     }
 }
 
@@ -1051,6 +1752,10 @@ crm_ipc_destroy(crm_ipc_t * client)
             /* crm_ipc_close(client); */
         }
         crm_trace("Destroying IPC connection to %s: %p", client->name, client);
+        if (client->pending) {
+            g_hash_table_destroy(client->pending);
+        }
+        ipc_shm_remove_all(&(client->shm_files));
         free(client->buffer);
         free(client->name);
         free(client);
@@ -1124,6 +1829,11 @@ crm_ipc_decompress(crm_ipc_t * client)
 {
     struct crm_ipc_response_header *header = (struct crm_ipc_response_header *)(void*)client->buffer;
 
+    if (is_set(header->flags, crm_ipc_shm_capable) && !client->peer_shm) {
+        crm_trace("%s IPC server accepts shared memory payloads", client->name);
+        client->peer_shm = TRUE;
+    }
+
     if (header->size_compressed) {
         int rc = 0;
         unsigned int size_u = 1 + header->size_uncompressed;
@@ -1160,6 +1870,28 @@ crm_ipc_decompress(crm_ipc_t * client)
         free(client->buffer);
         client->buf_size = new_buf_size;
         client->buffer = uncompressed;
+
+    } else if (is_set(header->flags, crm_ipc_shm)) {
+        unsigned int new_buf_size = QB_MAX(hdr_offset + header->size_uncompressed,
+                                           client->max_buf_size);
+        char *payload = calloc(1, new_buf_size);
+        int rc = pcmk_ok;
+
+        CRM_ASSERT(payload != NULL);
+        client->buffer[client->buf_size - 1] = '\0'; // Guard name
+        rc = ipc_shm_read(client->buffer + hdr_offset, payload + hdr_offset,
+                          header->size_uncompressed);
+        if (rc != pcmk_ok) {
+            free(payload);
+            return rc;
+        }
+
+        memcpy(payload, client->buffer, hdr_offset);    /* Preserve the header */
+        header = (struct crm_ipc_response_header *)(void*)payload;
+
+        free(client->buffer);
+        client->buf_size = new_buf_size;
+        client->buffer = payload;
     }
 
     CRM_ASSERT(client->buffer[hdr_offset + header->size_uncompressed - 1] == 0);
@@ -1177,12 +1909,19 @@ crm_ipc_read(crm_ipc_t * client)
 
     crm_ipc_init();
 
-    client->buffer[0] = 0;
-    client->msg_size = qb_ipcc_event_recv(client->ipc, client->buffer,
-                                          client->buf_size, 0);
-    if (client->msg_size >= 0) {
-        int rc = crm_ipc_decompress(client);
+    while (TRUE) {
+        uint32_t reply_id = 0;
+        int rc = pcmk_ok;
+
+        client->buffer[0] = 0;
+        client->msg_size = qb_ipcc_event_recv(client->ipc, client->buffer,
+                                              client->buf_size, 0);
+        if (client->msg_size < 0) {
+            crm_trace("No message from %s received: %s", client->name, pcmk_strerror(client->msg_size));
+            break;
+        }
 
+        rc = crm_ipc_decompress(client);
         if (rc != pcmk_ok) {
             return rc;
         }
@@ -1194,12 +1933,25 @@ crm_ipc_read(crm_ipc_t * client)
             return -EBADMSG;
         }
 
-        crm_trace("Received %s event %d, size=%u, rc=%d, text: %.100s",
-                  client->name, header->qb.id, header->qb.size, client->msg_size,
-                  client->buffer + hdr_offset);
+        if (is_not_set(header->flags, crm_ipc_async_response)) {
+            crm_trace("Received %s event %d, size=%u, rc=%d, text: %.100s",
+                      client->name, header->qb.id, header->qb.size, client->msg_size,
+                      client->buffer + hdr_offset);
+            break;
+        }
 
-    } else {
-        crm_trace("No message from %s received: %s", client->name, pcmk_strerror(client->msg_size));
+        /* Replies to asynchronous requests go to their callbacks rather than
+         * to the caller, who gets the next actual event (if any)
+         */
+        reply_id = header->qb.id;
+        header = NULL;
+        crm_trace("Received %s reply to asynchronous request %u",
+                  client->name, reply_id);
+        ipc_complete_pending(client, reply_id, pcmk_ok,
+                             string2xml(crm_ipc_buffer(client)));
+        if (crm_ipc_connected(client) == FALSE) {
+            break;
+        }
     }
 
     if (crm_ipc_connected(client) == FALSE || client->msg_size == -ENOTCONN) {
@@ -1250,6 +2002,13 @@ internal_ipc_send_recv(crm_ipc_t * client, const void *iov)
         rc = qb_ipcc_sendv_recv(client->ipc, iov, 2, client->buffer, client->buf_size, -1);
     } while (rc == -EAGAIN && crm_ipc_connected(client));
 
+    if (rc > 0) {
+        int decompress_rc = crm_ipc_decompress(client);
+
+        if (decompress_rc != pcmk_ok) {
+            return decompress_rc;
+        }
+    }
     return rc;
 }
 
@@ -1292,6 +2051,15 @@ internal_ipc_get_reply(crm_ipc_t * client, int request_id, int ms_timeout)
             if (hdr->qb.id == request_id) {
                 /* Got it */
                 break;
+            } else if ((client->pending != NULL)
+                       && (g_hash_table_lookup(client->pending,
+                                               GUINT_TO_POINTER(hdr->qb.id)) != NULL)) {
+                /* Reply to an asynchronous request sent earlier, from a
+                 * server that does not send such replies as events
+                 */
+                ipc_complete_pending(client, hdr->qb.id, pcmk_ok,
+                                     string2xml(crm_ipc_buffer(client)));
+
             } else if (hdr->qb.id < request_id) {
                 xmlNode *bad = string2xml(crm_ipc_buffer(client));
 
@@ -1322,7 +2090,7 @@ crm_ipc_send(crm_ipc_t * client, xmlNode * message, enum crm_ipc_flags flags, in
 {
     long rc = 0;
     struct iovec *iov;
-    static uint32_t id = 0;
+    uint32_t id = 0;
     static int factor = 8;
     struct crm_ipc_response_header *header;
 
@@ -1357,9 +2125,13 @@ crm_ipc_send(crm_ipc_t * client, xmlNode * message, enum crm_ipc_flags flags, in
         }
     }
 
-    id++;
-    CRM_LOG_ASSERT(id != 0); /* Crude wrap-around detection */
-    rc = crm_ipc_prepare(id, message, &iov, client->max_buf_size);
+    id = next_request_id();
+    /* Servers are authenticated on connect, so only our own identity and
+     * whether the server has advertised support matter
+     */
+    rc = ipc_prepare(id, message, &iov, client->max_buf_size,
+                     ((client->peer_shm && ipc_shm_capable())?
+                      &(client->shm_files) : NULL));
     if(rc < 0) {
         return rc;
     }
@@ -1383,6 +2155,7 @@ crm_ipc_send(crm_ipc_t * client, xmlNode * message, enum crm_ipc_flags flags, in
 
     crm_trace("Sending from client: %s request id: %d bytes: %u timeout:%d msg...",
               client->name, header->qb.id, header->qb.size, ms_timeout);
+    pcmk__trace(pcmk__trace_ipcc_send, header->qb.id, header->qb.size, flags);
 
     if (ms_timeout > 0 || is_not_set(flags, crm_ipc_client_response)) {
 
@@ -1391,6 +2164,7 @@ crm_ipc_send(crm_ipc_t * client, xmlNode * message, enum crm_ipc_flags flags, in
         if (rc <= 0) {
             crm_trace("Failed to send from client %s request %d with %u bytes...",
                       client->name, header->qb.id, header->qb.size);
+            ipc_shm_discard(iov);
             goto send_cleanup;
 
         } else if (is_not_set(flags, crm_ipc_client_response)) {
@@ -1448,6 +2222,218 @@ crm_ipc_send(crm_ipc_t * client, xmlNode * message, enum crm_ipc_flags flags, in
     return rc;
 }
 
+struct ipc_pending_s {
+    crm_ipc_t *client;
+    uint32_t request_id;
+    guint timer;                // Fails request if no reply in time (or 0)
+    pcmk__ipc_reply_cb_t callback;
+    void *user_data;
+};
+
+static void
+ipc_pending_free(gpointer data)
+{
+    struct ipc_pending_s *pending = data;
+
+    if (pending->timer != 0) {
+        g_source_remove(pending->timer);
+    }
+    free(pending);
+}
+
+/*!
+ * \internal
+ * \brief Finish an outstanding asynchronous request
+ *
+ * \param[in] client      Connection request was sent on
+ * \param[in] request_id  ID of request to finish
+ * \param[in] rc          Result of request (pcmk_ok if reply received)
+ * \param[in] reply       Reply received, if any (will be freed)
+ */
+static void
+ipc_complete_pending(crm_ipc_t *client, uint32_t request_id, int rc,
+                     xmlNode *reply)
+{
+    struct ipc_pending_s *pending = NULL;
+
+    if (client->pending != NULL) {
+        pending = g_hash_table_lookup(client->pending,
+                                      GUINT_TO_POINTER(request_id));
+    }
+    if (pending == NULL) {
+        crm_debug("Discarding reply to unknown or expired request %u from %s",
+                  request_id, client->name);
+        free_xml(reply);
+        return;
+    }
+
+    g_hash_table_steal(client->pending, GUINT_TO_POINTER(request_id));
+    crm_trace("Completing request %u to %s: %s",
+              request_id, client->name, pcmk_strerror(rc));
+    if (pending->callback != NULL) {
+        pending->callback(client, request_id, rc, reply, pending->user_data);
+    }
+    ipc_pending_free(pending);
+    free_xml(reply);
+}
+
+/*!
+ * \internal
+ * \brief Fail all outstanding asynchronous requests
+ *
+ * \param[in] client  Connection requests were sent on
+ * \param[in] rc      Result to pass to callbacks
+ */
+static void
+ipc_fail_pending(crm_ipc_t *client, int rc)
+{
+    GList *ids = NULL;
+
+    if ((client->pending == NULL) || (g_hash_table_size(client->pending) == 0)) {
+        return;
+    }
+
+    /* Collect IDs first, because callbacks may send new requests */
+    ids = g_hash_table_get_keys(client->pending);
+    for (GList *iter = ids; iter != NULL; iter = iter->next) {
+        uint32_t request_id = GPOINTER_TO_UINT(iter->data);
+
+        crm_info("Request %u to %s failed: %s",
+                 request_id, client->name, pcmk_strerror(rc));
+        ipc_complete_pending(client, request_id, rc, NULL);
+    }
+    g_list_free(ids);
+}
+
+static gboolean
+ipc_pending_timeout_cb(gpointer data)
+{
+    struct ipc_pending_s *pending = data;
+
+    pending->timer = 0;
+    crm_info("Request %u to %s failed: %s",
+             pending->request_id, pending->client->name,
+             pcmk_strerror(-ETIMEDOUT));
+    ipc_complete_pending(pending->client, pending->request_id, -ETIMEDOUT,
+                         NULL);
+    return FALSE;
+}
+
+/*!
+ * \internal
+ * \brief Send an IPC request without waiting for its reply
+ *
+ * Any number of requests may be outstanding on one connection. The server
+ * sends each reply on the event channel, tagged with the request's ID, and
+ * crm_ipc_read() passes it to the request's callback instead of returning it
+ * as an event. For a connection attached to the main loop with
+ * mainloop_add_ipc_client(), that happens whenever the connection's file
+ * descriptor becomes readable; other callers must read events themselves
+ * (see crm_ipc_ready()). Synchronous requests may still be sent on the same
+ * connection, since their replies come on the response channel.
+ *
+ * \param[in]  client      Connection to send request on
+ * \param[in]  message     XML request to send
+ * \param[in]  flags       Bitmask of crm_ipc_flags for request
+ * \param[in]  ms_timeout  Fail request if no reply after this long (or 0 for
+ *                         the default of 5s, or -1 for no timeout)
+ * \param[in]  callback    Function to call with reply (or failure)
+ * \param[in]  user_data   Caller data to pass to \p callback
+ * \param[out] request_id  If not NULL, where to store ID of request
+ *
+ * \return pcmk_ok on success, otherwise -errno (in which case \p callback
+ *         will not be called)
+ * \note Timeouts are detected by the main loop, so requests without a
+ *       timeout should be used when the main loop is not running.
+ */
+int
+pcmk__ipc_send_async(crm_ipc_t *client, xmlNode *message,
+                     enum crm_ipc_flags flags, int32_t ms_timeout,
+                     pcmk__ipc_reply_cb_t callback, void *user_data,
+                     uint32_t *request_id)
+{
+    struct iovec *iov = NULL;
+    struct crm_ipc_response_header *header = NULL;
+    struct ipc_pending_s *pending = NULL;
+    uint32_t id = 0;
+    ssize_t rc = 0;
+
+    crm_ipc_init();
+
+    if (crm_ipc_connected(client) == FALSE) {
+        crm_notice("Connection to %s closed", (client? client->name : "server"));
+        return -ENOTCONN;
+    }
+
+    if (ms_timeout == 0) {
+        ms_timeout = 5000;
+    }
+
+    id = next_request_id();
+    rc = ipc_prepare(id, message, &iov, client->max_buf_size,
+                     ((client->peer_shm && ipc_shm_capable())?
+                      &(client->shm_files) : NULL));
+    if (rc < 0) {
+        return rc;
+    }
+
+    header = iov[0].iov_base;
+    header->flags |= (flags | crm_ipc_client_response | crm_ipc_client_async);
+    pcmk__trace(pcmk__trace_ipcc_send, id, header->qb.size, header->flags);
+
+    rc = internal_ipc_send_request(client, iov,
+                                   (ms_timeout > 0)? ms_timeout : 5000);
+    if (rc <= 0) {
+        crm_warn("Request %u to %s failed: %s",
+                 id, client->name, pcmk_strerror(rc));
+        ipc_shm_discard(iov);
+        pcmk_free_ipc_event(iov);
+        return (rc < 0)? (int) rc : -ECOMM;
+    }
+    pcmk_free_ipc_event(iov);
+
+    if (client->pending == NULL) {
+        client->pending = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                                NULL, ipc_pending_free);
+    }
+
+    pending = calloc(1, sizeof(struct ipc_pending_s));
+    CRM_ASSERT(pending != NULL);
+    pending->client = client;
+    pending->request_id = id;
+    pending->callback = callback;
+    pending->user_data = user_data;
+    if (ms_timeout > 0) {
+        pending->timer = g_timeout_add(ms_timeout, ipc_pending_timeout_cb,
+                                       pending);
+    }
+    g_hash_table_insert(client->pending, GUINT_TO_POINTER(id), pending);
+
+    crm_trace("Sent asynchronous request %u to %s (%u outstanding)",
+              id, client->name, g_hash_table_size(client->pending));
+    if (request_id != NULL) {
+        *request_id = id;
+    }
+    return pcmk_ok;
+}
+
+/*!
+ * \internal
+ * \brief Get number of outstanding asynchronous requests on a connection
+ *
+ * \param[in] client  Connection to check
+ *
+ * \return Number of requests awaiting a reply
+ */
+unsigned int
+pcmk__ipc_pending_replies(crm_ipc_t *client)
+{
+    if ((client == NULL) || (client->pending == NULL)) {
+        return 0;
+    }
+    return g_hash_table_size(client->pending);
+}
+
 int
 crm_ipc_is_authentic_process(int sock, uid_t refuid, gid_t refgid,
                              pid_t *gotpid, uid_t *gotuid, gid_t *gotgid) {
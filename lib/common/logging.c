@@ -14,6 +14,9 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <sys/utsname.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 
 #include <stdio.h>
 #include <unistd.h>
@@ -27,11 +30,16 @@
 #include <libgen.h>
 #include <signal.h>
 #include <bzlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 #include <qb/qbdefs.h>
 
 #include <crm/crm.h>
 #include <crm/common/mainloop.h>
+#include <crm/common/trace_internal.h>
 
 unsigned int crm_log_priority = LOG_NOTICE;
 unsigned int crm_log_level = LOG_INFO;
@@ -179,12 +187,20 @@ crm_log_deinit(void)
     g_log_set_default_handler(glib_log_default, NULL);
 }
 
+#ifdef QB_FEATURE_LOG_HIRES_TIMESTAMPS
+typedef struct timespec *log_time_t;
+#else
+typedef time_t log_time_t;
+#endif
+
+static int async_syslog_target = -1;
+
 #define FMT_MAX 256
 
 static void
 set_format_string(int method, const char *daemon)
 {
-    if (method == QB_LOG_SYSLOG) {
+    if ((method == QB_LOG_SYSLOG) || (method == async_syslog_target)) {
         // The system log gets a simplified, user-friendly format
         crm_extended_logging(method, QB_FALSE);
         qb_log_format_set(method, "%g %p: %b");
@@ -225,6 +241,442 @@ set_format_string(int method, const char *daemon)
     }
 }
 
+/*
+ * Asynchronous log writing
+ *
+ * When enabled (via PCMK_log_async), messages for the log file and syslog are
+ * formatted in the main loop as usual, then appended to a bounded
+ * single-producer/single-consumer queue that is drained by a dedicated writer
+ * thread. A slow disk or a stuck syslog daemon then cannot stall the main
+ * loop; if the queue fills up, messages are dropped and counted instead.
+ *
+ * Pacemaker forks a lot, so the writer thread never takes a lock (it only
+ * calls writev() and send()), and forked children simply log synchronously.
+ */
+
+#define ASYNC_LOG_SLOTS     2048    // Must be a power of 2
+#define ASYNC_LOG_LINE_MAX  (QB_LOG_MAX_LEN + 128)
+#define ASYNC_LOG_BATCH     64      // Maximum lines per writev()
+
+typedef struct async_log_entry_s {
+    int fd;                         // Log file descriptor, or -1 for syslog
+    size_t len;
+    char text[ASYNC_LOG_LINE_MAX];
+} async_log_entry_t;
+
+static async_log_entry_t *async_log_ring = NULL;
+static volatile gint async_log_head = 0;        // Next slot to fill
+static volatile gint async_log_tail = 0;        // Next slot to write
+static volatile gint async_log_dropped = 0;     // Messages lost so far
+static guint async_log_reported = 0;            // Losses already logged
+static sem_t async_log_ready;
+static bool async_log_threaded = FALSE;         // Writer active in this process
+static int async_log_fds[QB_LOG_TARGET_MAX];
+static int async_syslog_fd = -1;
+static int async_syslog_facility = LOG_DAEMON;
+
+static void
+async_syslog_connect(void)
+{
+    struct sockaddr_un addr;
+
+    if (async_syslog_fd >= 0) {
+        close(async_syslog_fd);
+    }
+    async_syslog_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (async_syslog_fd < 0) {
+        return;
+    }
+    fcntl(async_syslog_fd, F_SETFD, FD_CLOEXEC);
+    fcntl(async_syslog_fd, F_SETFL, O_NONBLOCK);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, "/dev/log", sizeof(addr.sun_path) - 1);
+    if (connect(async_syslog_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        close(async_syslog_fd);
+        async_syslog_fd = -1;
+    }
+}
+
+// Send one message to syslog without ever blocking
+static void
+async_syslog_send(const char *text, size_t len)
+{
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (async_syslog_fd < 0) {
+            async_syslog_connect();
+            if (async_syslog_fd < 0) {
+                break;
+            }
+        }
+        if (send(async_syslog_fd, text, len, MSG_DONTWAIT|MSG_NOSIGNAL) >= 0) {
+            return;
+        }
+        if ((errno != ECONNREFUSED) && (errno != ENOTCONN)
+            && (errno != ECONNRESET)) {
+            break; // Most likely EAGAIN, i.e. the syslog daemon is stuck
+        }
+        close(async_syslog_fd); // The syslog daemon was restarted
+        async_syslog_fd = -1;
+    }
+    g_atomic_int_inc(&async_log_dropped);
+}
+
+static void
+async_log_writev(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        ssize_t rc = writev(fd, iov, iovcnt);
+
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return; // There is nowhere to report the error
+        }
+        while ((iovcnt > 0) && ((size_t) rc >= iov->iov_len)) {
+            rc -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *) iov->iov_base + rc;
+            iov->iov_len -= rc;
+        }
+    }
+}
+
+static void *
+async_log_writer(void *user_data)
+{
+    struct iovec iov[ASYNC_LOG_BATCH];
+
+    while (TRUE) {
+        guint tail = (guint) g_atomic_int_get(&async_log_tail);
+        guint head = 0;
+
+        if (sem_wait(&async_log_ready) < 0) {
+            continue; // EINTR
+        }
+
+        /* Write everything queued so far, batching consecutive lines for the
+         * same log file into a single writev()
+         */
+        head = (guint) g_atomic_int_get(&async_log_head);
+        while (tail != head) {
+            async_log_entry_t *entry = &async_log_ring[tail & (ASYNC_LOG_SLOTS - 1)];
+            int fd = entry->fd;
+            int n = 0;
+
+            if (fd < 0) {
+                async_syslog_send(entry->text, entry->len);
+                n = 1;
+
+            } else {
+                do {
+                    entry = &async_log_ring[(tail + n) & (ASYNC_LOG_SLOTS - 1)];
+                    iov[n].iov_base = entry->text;
+                    iov[n].iov_len = entry->len;
+                    n++;
+                } while ((n < ASYNC_LOG_BATCH) && ((tail + n) != head)
+                         && (async_log_ring[(tail + n) & (ASYNC_LOG_SLOTS - 1)].fd == fd));
+                async_log_writev(fd, iov, n);
+            }
+
+            // Only now may the main loop reuse the slots
+            tail += n;
+            g_atomic_int_set(&async_log_tail, (gint) tail);
+        }
+    }
+    return NULL;
+}
+
+static void
+async_log_atfork_child(void)
+{
+    // The writer thread does not exist in the child
+    async_log_threaded = FALSE;
+}
+
+/*!
+ * \internal
+ * \brief Start the asynchronous log writer thread
+ *
+ * \return TRUE if the writer thread was started, otherwise FALSE
+ */
+static bool
+async_log_start(void)
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+    sigset_t all_signals, old_signals;
+    int rc = 0;
+
+    async_log_ring = calloc(ASYNC_LOG_SLOTS, sizeof(async_log_entry_t));
+    if ((async_log_ring == NULL) || (sem_init(&async_log_ready, 0, 0) < 0)) {
+        free(async_log_ring);
+        async_log_ring = NULL;
+        return FALSE;
+    }
+    for (int lpc = 0; lpc < QB_LOG_TARGET_MAX; lpc++) {
+        async_log_fds[lpc] = -1;
+    }
+
+    // Leave all signal handling to the main loop thread
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &old_signals);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    rc = pthread_create(&thread, &attr, async_log_writer, NULL);
+    pthread_attr_destroy(&attr);
+
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+
+    if (rc != 0) {
+        sem_destroy(&async_log_ready);
+        free(async_log_ring);
+        async_log_ring = NULL;
+        return FALSE;
+    }
+    pthread_atfork(NULL, NULL, async_log_atfork_child);
+    async_log_threaded = TRUE;
+    return TRUE;
+}
+
+static bool
+async_log_enqueue(int fd, const char *text, size_t len)
+{
+    guint head = (guint) g_atomic_int_get(&async_log_head);
+    guint tail = (guint) g_atomic_int_get(&async_log_tail);
+    async_log_entry_t *entry = NULL;
+
+    if ((head - tail) >= ASYNC_LOG_SLOTS) {
+        g_atomic_int_inc(&async_log_dropped);
+        return FALSE;
+    }
+
+    entry = &async_log_ring[head & (ASYNC_LOG_SLOTS - 1)];
+    entry->fd = fd;
+    entry->len = QB_MIN(len, sizeof(entry->text));
+    memcpy(entry->text, text, entry->len);
+
+    g_atomic_int_set(&async_log_head, (gint) (head + 1));
+    sem_post(&async_log_ready);
+    return TRUE;
+}
+
+static void
+async_log_write_sync(int fd, const char *text, size_t len)
+{
+    if (fd < 0) {
+        async_syslog_send(text, len);
+    } else {
+        struct iovec iov = { (void *) text, len };
+
+        async_log_writev(fd, &iov, 1);
+    }
+}
+
+static size_t
+async_syslog_format(char *buffer, int priority, time_t when, const char *msg)
+{
+    char stamp[32];
+    struct tm tm;
+    int len = 0;
+
+    localtime_r(&when, &tm);
+    strftime(stamp, sizeof(stamp), "%b %e %H:%M:%S", &tm);
+    len = snprintf(buffer, ASYNC_LOG_LINE_MAX, "<%d>%s %s[%lu]: %s",
+                   async_syslog_facility | priority, stamp, crm_system_name,
+                   (unsigned long) getpid(), msg);
+    return QB_MIN((size_t) len, ASYNC_LOG_LINE_MAX - 1);
+}
+
+/*!
+ * \internal
+ * \brief Queue a formatted log line, or write it directly in forked children
+ *
+ * \param[in] fd        Log file descriptor, or -1 for syslog
+ * \param[in] when      Time of message
+ * \param[in] text      Formatted message
+ * \param[in] len       Length of \p text
+ */
+static void
+async_log_submit(int fd, time_t when, const char *text, size_t len)
+{
+    guint dropped = 0;
+
+    if (!async_log_threaded) {
+        async_log_write_sync(fd, text, len);
+        return;
+    }
+
+    // Note any messages lost since the last time, before this one
+    dropped = (guint) g_atomic_int_get(&async_log_dropped);
+    if (dropped != async_log_reported) {
+        char note[ASYNC_LOG_LINE_MAX];
+        char *msg = crm_strdup_printf("Dropped %u log messages because "
+                                      "logging could not keep up",
+                                      dropped - async_log_reported);
+        size_t note_len = 0;
+
+        if (fd < 0) {
+            note_len = async_syslog_format(note, LOG_WARNING, when, msg);
+        } else {
+            note_len = snprintf(note, sizeof(note), "%s[%lu]: %s\n",
+                                crm_system_name, (unsigned long) getpid(),
+                                msg);
+            note_len = QB_MIN(note_len, sizeof(note) - 1);
+        }
+        free(msg);
+        if (async_log_enqueue(fd, note, note_len)) {
+            async_log_reported = dropped;
+        }
+    }
+    async_log_enqueue(fd, text, len);
+}
+
+static time_t
+log_time_secs(log_time_t timestamp)
+{
+#ifdef QB_FEATURE_LOG_HIRES_TIMESTAMPS
+    return timestamp->tv_sec;
+#else
+    return timestamp;
+#endif
+}
+
+static void
+async_file_logger(int32_t target, struct qb_log_callsite *cs,
+                  log_time_t timestamp, const char *msg)
+{
+    char line[ASYNC_LOG_LINE_MAX];
+    size_t len = 0;
+
+    if ((target < 0) || (target >= QB_LOG_TARGET_MAX)
+        || (async_log_fds[target] < 0)) {
+        return;
+    }
+
+    qb_log_target_format(target, cs, timestamp, msg, line);
+    len = strnlen(line, sizeof(line) - 1);
+    line[len++] = '\n';
+    async_log_submit(async_log_fds[target], log_time_secs(timestamp), line,
+                     len);
+}
+
+static void
+async_syslog_logger(int32_t target, struct qb_log_callsite *cs,
+                    log_time_t timestamp, const char *msg)
+{
+    char formatted[ASYNC_LOG_LINE_MAX];
+    char line[ASYNC_LOG_LINE_MAX];
+    time_t when = log_time_secs(timestamp);
+    size_t len = 0;
+
+    qb_log_target_format(target, cs, timestamp, msg, formatted);
+    len = async_syslog_format(line, cs->priority, when, formatted);
+    async_log_submit(-1, when, line, len);
+}
+
+/*!
+ * \internal
+ * \brief Wait (briefly) for the writer thread to empty the queue
+ *
+ * \return TRUE if the queue is empty, otherwise FALSE
+ */
+static bool
+async_log_drain(void)
+{
+    for (int lpc = 0; async_log_threaded && (lpc < 1000); lpc++) {
+        if (g_atomic_int_get(&async_log_head) == g_atomic_int_get(&async_log_tail)) {
+            return TRUE;
+        }
+        usleep(1000);
+    }
+    return !async_log_threaded;
+}
+
+static void
+async_log_flush(int32_t target)
+{
+    async_log_drain();
+}
+
+static void
+async_log_close(int32_t target)
+{
+    if (!async_log_drain()) {
+        return; // Leak the descriptor rather than risk a write to a reused one
+    }
+    if (target == async_syslog_target) {
+        async_syslog_target = -1;
+
+    } else if ((target >= 0) && (target < QB_LOG_TARGET_MAX)
+               && (async_log_fds[target] >= 0)) {
+        close(async_log_fds[target]);
+        async_log_fds[target] = -1;
+    }
+}
+
+/*!
+ * \internal
+ * \brief Open a log file target that is written by the writer thread
+ *
+ * \param[in] filename  Log file to append to
+ *
+ * \return libqb log target ID on success, otherwise negative errno
+ */
+static int
+async_log_file_open(const char *filename)
+{
+    int target = 0;
+    int fd = open(filename, O_WRONLY|O_APPEND|O_CREAT|O_CLOEXEC, 0660);
+
+    if (fd < 0) {
+        return -errno;
+    }
+    target = qb_log_custom_open(async_file_logger, async_log_flush,
+                                async_log_close, NULL);
+    if ((target < 0) || (target >= QB_LOG_TARGET_MAX)) {
+        close(fd);
+        return (target < 0)? target : -ENOSPC;
+    }
+    async_log_fds[target] = fd;
+    qb_log_ctl(target, QB_LOG_CONF_THREADED, QB_FALSE);
+    set_format_string(target, crm_system_name);
+    return target;
+}
+
+/*!
+ * \internal
+ * \brief Replace the libqb syslog target with one written by the writer thread
+ *
+ * \param[in] facility  Syslog facility to use
+ *
+ * \return TRUE on success, otherwise FALSE
+ */
+static bool
+async_syslog_open(int facility)
+{
+    int target = qb_log_custom_open(async_syslog_logger, async_log_flush,
+                                    async_log_close, NULL);
+
+    if (target < 0) {
+        return FALSE;
+    }
+    async_syslog_facility = facility;
+    async_syslog_target = target;
+    qb_log_ctl(target, QB_LOG_CONF_THREADED, QB_FALSE);
+    set_format_string(target, crm_system_name);
+    qb_log_filter_ctl(target, QB_LOG_FILTER_ADD, QB_LOG_FILTER_FILE, "*",
+                      crm_log_priority);
+    qb_log_ctl(target, QB_LOG_CONF_ENABLED, QB_TRUE);
+    return TRUE;
+}
+
 gboolean
 crm_add_logfile(const char *filename)
 {
@@ -322,9 +774,13 @@ crm_add_logfile(const char *filename)
         }
     }
 
-    /* Close and reopen with libqb */
+    /* Close and reopen with libqb (or our own writer thread) */
     fclose(logfile);
-    fd = qb_log_file_open(filename);
+    if (async_log_threaded) {
+        fd = async_log_file_open(filename);
+    } else {
+        fd = qb_log_file_open(filename);
+    }
 
     if (fd < 0) {
         crm_perror(LOG_WARNING, "Couldn't send additional logging to %s", filename);
@@ -363,12 +819,6 @@ crm_add_logfile(const char *filename)
 static int blackbox_trigger = 0;
 static volatile char *blackbox_file_prefix = NULL;
 
-#ifdef QB_FEATURE_LOG_HIRES_TIMESTAMPS
-typedef struct timespec *log_time_t;
-#else
-typedef time_t log_time_t;
-#endif
-
 static void
 blackbox_logger(int32_t t, struct qb_log_callsite *cs, log_time_t timestamp,
                 const char *msg)
@@ -489,7 +939,14 @@ crm_write_blackbox(int nsig, struct qb_log_callsite *cs)
             }
 
             last = now;
+            pcmk__mainloop_log_source_stats();
             qb_log_blackbox_write_to_file(buffer);
+            {
+                char *trace_file = crm_strdup_printf("%s.trace", buffer);
+
+                pcmk__trace_dump(trace_file);
+                free(trace_file);
+            }
 
             /* Flush the existing contents
              * A size change would also work
@@ -552,7 +1009,8 @@ crm_log_filter_source(int source, const char *trace_files, const char *trace_fns
             free(key);
         }
 
-    } else if (source == QB_LOG_SYSLOG) {       /* No tracing to syslog */
+    } else if ((source == QB_LOG_SYSLOG)
+               || (source == async_syslog_target)) { /* No tracing to syslog */
         if (cs->priority <= crm_log_priority && cs->priority <= crm_log_level) {
             qb_bit_set(cs->targets, source);
         }
@@ -817,6 +1275,11 @@ crm_log_init(const char *entity, uint8_t level, gboolean daemon, gboolean to_std
         set_daemon_option("logfacility", facility);
     }
 
+    if (crm_is_daemon && daemon_option_enabled(crm_system_name, "log_async")
+        && !async_log_threaded && !async_log_start()) {
+        crm_warn("Could not start asynchronous logging, logging synchronously");
+    }
+
     if (safe_str_eq(facility, "none")) {
         quiet = TRUE;
 
@@ -842,7 +1305,13 @@ crm_log_init(const char *entity, uint8_t level, gboolean daemon, gboolean to_std
 
     // Log to syslog unless requested to be quiet
     if (!quiet) {
-        qb_log_ctl(QB_LOG_SYSLOG, QB_LOG_CONF_ENABLED, QB_TRUE);
+        if (async_log_threaded
+            && ((async_syslog_target >= 0)
+                || async_syslog_open(qb_log_facility2int(facility)))) {
+            crm_trace("Logging to syslog asynchronously");
+        } else {
+            qb_log_ctl(QB_LOG_SYSLOG, QB_LOG_CONF_ENABLED, QB_TRUE);
+        }
     }
 
     /* Should we log to stderr */ 
@@ -20,11 +20,13 @@
 #include <sys/wait.h>
 
 #include <crm/crm.h>
+#include <crm/msg_xml.h>
 #include <crm/common/xml.h>
 #include <crm/common/mainloop.h>
 #include <crm/common/ipcs.h>
 
 #include <qb/qbarray.h>
+#include <qb/qbutil.h>
 
 struct mainloop_child_s {
     pid_t pid;
@@ -39,6 +41,394 @@ struct mainloop_child_s {
     void (*callback) (mainloop_child_t * p, pid_t pid, int core, int signo, int exitcode);
 };
 
+enum mainloop_lane {
+    lane_critical,
+    lane_ops,
+    lane_bulk,
+};
+
+#define LANE_COUNT          (lane_bulk + 1)
+
+/* Latencies are counted in power-of-2 millisecond buckets: under 1ms, under
+ * 2ms, under 4ms, and so on, with the last bucket holding everything longer
+ */
+#define LANE_HIST_BUCKETS   12
+
+struct lane_stats_s {
+    unsigned long long dispatches;
+    unsigned long long run_max_us;
+    unsigned long long run_hist[LANE_HIST_BUCKETS];   // Dispatch durations
+    unsigned long long waits;
+    unsigned long long wait_max_us;
+    unsigned long long wait_hist[LANE_HIST_BUCKETS];  // Trigger set->dispatch
+};
+
+static const char *lane_names[LANE_COUNT] = { "critical", "ops", "bulk" };
+static struct lane_stats_s lane_stats[LANE_COUNT];
+
+// Whether this process uses lane priorities for library connections
+static bool lanes_enabled = FALSE;
+
+/* With lanes enabled, a bulk IPC connection handles messages for at most this
+ * long per dispatch (but at least one), so that any higher-priority sources
+ * that became ready meanwhile do not wait for its entire backlog
+ */
+#define LANE_BULK_BATCH_MS  5
+
+static enum mainloop_lane
+lane_for_priority(int priority)
+{
+    if (priority <= PCMK__PRIORITY_CRITICAL) {
+        return lane_critical;
+    } else if (priority <= PCMK__PRIORITY_OPS) {
+        return lane_ops;
+    }
+    return lane_bulk;
+}
+
+static void
+lane_hist_add(unsigned long long *hist, unsigned long long *max,
+              unsigned long long us)
+{
+    unsigned long long ms = us / 1000;
+    int bucket = 0;
+
+    while ((ms > 0) && (bucket < (LANE_HIST_BUCKETS - 1))) {
+        ms >>= 1;
+        bucket++;
+    }
+    hist[bucket]++;
+    if (us > *max) {
+        *max = us;
+    }
+}
+
+static void
+lane_record_run(enum mainloop_lane lane, uint64_t start_ns)
+{
+    struct lane_stats_s *stats = &lane_stats[lane];
+
+    stats->dispatches++;
+    lane_hist_add(stats->run_hist, &stats->run_max_us,
+                  (qb_util_nano_current_get() - start_ns) / QB_TIME_NS_IN_USEC);
+}
+
+static void
+lane_record_wait(enum mainloop_lane lane, uint64_t set_ns, uint64_t now_ns)
+{
+    struct lane_stats_s *stats = &lane_stats[lane];
+
+    if ((set_ns == 0) || (now_ns < set_ns)) {
+        return;
+    }
+    stats->waits++;
+    lane_hist_add(stats->wait_hist, &stats->wait_max_us,
+                  (now_ns - set_ns) / QB_TIME_NS_IN_USEC);
+}
+
+static char *
+lane_hist_text(const unsigned long long *hist)
+{
+    char *text = NULL;
+    int len = 0;
+
+    for (int i = 0; i < LANE_HIST_BUCKETS; i++) {
+        len += snprintf(NULL, 0, "%s%llu", (i? "," : ""), hist[i]);
+    }
+    text = calloc(1, len + 1);
+    CRM_ASSERT(text != NULL);
+    for (int i = 0, offset = 0; i < LANE_HIST_BUCKETS; i++) {
+        offset += snprintf(text + offset, len + 1 - offset, "%s%llu",
+                           (i? "," : ""), hist[i]);
+    }
+    return text;
+}
+
+/*!
+ * \internal
+ * \brief Use priority lanes for this process' library connections
+ *
+ * By default, library connections (to the CIB, fencer, executor, and cluster
+ * layer) keep their usual main loop priorities. A daemon whose responsiveness
+ * to fencing and membership events matters more than to CIB traffic may call
+ * this before connecting, so those connections get their lane's priority
+ * instead, and bulk connections yield after a bounded batch of messages.
+ */
+void
+pcmk__mainloop_enable_lanes(void)
+{
+    lanes_enabled = TRUE;
+}
+
+/*!
+ * \internal
+ * \brief Choose a library connection's main loop priority
+ *
+ * \param[in] lane_priority   Priority of connection's lane
+ * \param[in] usual_priority  Priority to use if lanes are not enabled
+ *
+ * \return \p lane_priority if pcmk__mainloop_enable_lanes() has been called,
+ *         otherwise \p usual_priority
+ */
+int
+pcmk__mainloop_lane_priority(int lane_priority, int usual_priority)
+{
+    return lanes_enabled? lane_priority : usual_priority;
+}
+
+/*!
+ * \internal
+ * \brief Add main loop priority lane statistics to XML
+ *
+ * \param[in,out] parent  XML node to add statistics to (or NULL)
+ *
+ * \return Newly created XML element with statistics
+ * \note Histograms are comma-separated counts of power-of-2 millisecond
+ *       buckets (under 1ms, under 2ms, under 4ms, ...).
+ */
+xmlNode *
+pcmk__mainloop_lane_stats(xmlNode *parent)
+{
+    xmlNode *lanes = create_xml_node(parent, "mainloop_lanes");
+
+    for (int i = 0; i < LANE_COUNT; i++) {
+        xmlNode *lane = create_xml_node(lanes, "lane");
+        char *hist = NULL;
+
+        crm_xml_add(lane, XML_ATTR_ID, lane_names[i]);
+        crm_xml_add_ll(lane, "dispatches", lane_stats[i].dispatches);
+        crm_xml_add_ll(lane, "run_max_us", lane_stats[i].run_max_us);
+        hist = lane_hist_text(lane_stats[i].run_hist);
+        crm_xml_add(lane, "run_histogram_ms", hist);
+        free(hist);
+
+        crm_xml_add_ll(lane, "waits", lane_stats[i].waits);
+        crm_xml_add_ll(lane, "wait_max_us", lane_stats[i].wait_max_us);
+        hist = lane_hist_text(lane_stats[i].wait_hist);
+        crm_xml_add(lane, "wait_histogram_ms", hist);
+        free(hist);
+    }
+    return lanes;
+}
+
+/* Per-source dispatch statistics, keyed by source name. Sources that are
+ * recreated with the same name (such as on reconnection) share an entry.
+ * Entries are reference-counted: the table holds one reference, and each
+ * source holds one until it is destroyed, so the table can be cleared while
+ * sources are still live.
+ */
+struct source_stats_s {
+    char *name;
+    unsigned int refs;
+    unsigned long long calls;
+    unsigned long long total_us;
+    unsigned long long max_us;
+    unsigned long long waits;
+    unsigned long long wait_total_us;  // Poll wake-up to dispatch (fds only)
+    unsigned long long wait_max_us;
+};
+
+static GHashTable *source_stats = NULL;
+static GPollFunc default_poll_fn = NULL;
+static uint64_t last_poll_ns = 0;
+
+static void
+source_stats_unref(gpointer data)
+{
+    struct source_stats_s *stats = data;
+
+    if ((stats == NULL) || (--(stats->refs) > 0)) {
+        return;
+    }
+    free(stats->name);
+    free(stats);
+}
+
+/*!
+ * \internal
+ * \brief Get the statistics entry for a source name
+ *
+ * \param[in] name  Source name
+ *
+ * \return Statistics entry for \p name (owned by the table)
+ */
+static struct source_stats_s *
+get_source_stats(const char *name)
+{
+    struct source_stats_s *stats = NULL;
+
+    if (source_stats == NULL) {
+        source_stats = g_hash_table_new_full(crm_str_hash, g_str_equal, NULL,
+                                             source_stats_unref);
+    }
+
+    stats = g_hash_table_lookup(source_stats, name);
+    if (stats == NULL) {
+        stats = calloc(1, sizeof(struct source_stats_s));
+        CRM_ASSERT(stats != NULL);
+        stats->name = strdup(name);
+        CRM_ASSERT(stats->name != NULL);
+        stats->refs = 1;
+        g_hash_table_insert(source_stats, stats->name, stats);
+    }
+    return stats;
+}
+
+/*!
+ * \internal
+ * \brief Get a reference to the statistics entry for a source
+ *
+ * \param[in] name  Source name
+ *
+ * \return Statistics entry for \p name (which the source must release with
+ *         source_stats_unref() when it is destroyed)
+ */
+static struct source_stats_s *
+hold_source_stats(const char *name)
+{
+    struct source_stats_s *stats = get_source_stats(name);
+
+    stats->refs++;
+    return stats;
+}
+
+/*!
+ * \internal
+ * \brief Wrap the default main context's poll function to note wake-up time
+ *
+ * The time between poll() returning and a file descriptor source being
+ * dispatched is how long that source waited behind other sources.
+ */
+static gint
+instrumented_poll(GPollFD *ufds, guint nfds, gint timeout)
+{
+    gint rc = default_poll_fn(ufds, nfds, timeout);
+
+    last_poll_ns = qb_util_nano_current_get();
+    return rc;
+}
+
+static void
+instrument_poll(void)
+{
+    if (default_poll_fn == NULL) {
+        default_poll_fn = g_main_context_get_poll_func(NULL);
+        g_main_context_set_poll_func(NULL, instrumented_poll);
+    }
+}
+
+/*!
+ * \internal
+ * \brief Record a completed dispatch of a main loop source
+ *
+ * \param[in,out] stats     Statistics for source
+ * \param[in]     start_ns  When dispatch started
+ * \param[in]     fd        Whether source is a file descriptor source
+ */
+static void
+source_record_run(struct source_stats_s *stats, uint64_t start_ns, bool fd)
+{
+    unsigned long long us = (qb_util_nano_current_get() - start_ns)
+                            / QB_TIME_NS_IN_USEC;
+
+    stats->calls++;
+    stats->total_us += us;
+    if (us > stats->max_us) {
+        stats->max_us = us;
+    }
+
+    if (fd && (last_poll_ns != 0) && (start_ns >= last_poll_ns)) {
+        us = (start_ns - last_poll_ns) / QB_TIME_NS_IN_USEC;
+        stats->waits++;
+        stats->wait_total_us += us;
+        if (us > stats->wait_max_us) {
+            stats->wait_max_us = us;
+        }
+    }
+}
+
+static gint
+compare_source_stats(gconstpointer a, gconstpointer b)
+{
+    const struct source_stats_s *stats_a = a;
+    const struct source_stats_s *stats_b = b;
+
+    // Most expensive first
+    if (stats_a->total_us > stats_b->total_us) {
+        return -1;
+    } else if (stats_a->total_us < stats_b->total_us) {
+        return 1;
+    }
+    return strcmp(stats_a->name, stats_b->name);
+}
+
+static GList *
+sorted_source_stats(void)
+{
+    GList *list = NULL;
+
+    if (source_stats != NULL) {
+        list = g_list_sort(g_hash_table_get_values(source_stats),
+                           compare_source_stats);
+    }
+    return list;
+}
+
+/*!
+ * \internal
+ * \brief Add per-source main loop dispatch statistics to XML
+ *
+ * \param[in,out] parent  XML node to add statistics to (or NULL)
+ *
+ * \return Newly created XML element with statistics
+ */
+xmlNode *
+pcmk__mainloop_source_stats(xmlNode *parent)
+{
+    xmlNode *sources = create_xml_node(parent, "mainloop_sources");
+    GList *list = sorted_source_stats();
+
+    for (GList *iter = list; iter != NULL; iter = iter->next) {
+        struct source_stats_s *stats = iter->data;
+        xmlNode *source = create_xml_node(sources, "source");
+
+        crm_xml_add(source, XML_ATTR_ID, stats->name);
+        crm_xml_add_ll(source, "calls", stats->calls);
+        crm_xml_add_ll(source, "total_us", stats->total_us);
+        crm_xml_add_ll(source, "max_us", stats->max_us);
+        if (stats->waits > 0) {
+            crm_xml_add_ll(source, "wait_avg_us",
+                           stats->wait_total_us / stats->waits);
+            crm_xml_add_ll(source, "wait_max_us", stats->wait_max_us);
+        }
+    }
+    g_list_free(list);
+    return sources;
+}
+
+/*!
+ * \internal
+ * \brief Log per-source main loop dispatch statistics
+ *
+ * \note This is called when the blackbox is dumped, so that the statistics
+ *       are included in it.
+ */
+void
+pcmk__mainloop_log_source_stats(void)
+{
+    GList *list = sorted_source_stats();
+
+    for (GList *iter = list; iter != NULL; iter = iter->next) {
+        struct source_stats_s *stats = iter->data;
+
+        crm_info("Main loop source %s: %llu calls, %lluus total, "
+                 "%lluus max, %lluus max wait",
+                 stats->name, stats->calls, stats->total_us, stats->max_us,
+                 stats->wait_max_us);
+    }
+    g_list_free(list);
+}
+
 struct trigger_s {
     GSource source;
     gboolean running;
@@ -46,6 +436,9 @@ struct trigger_s {
     void *user_data;
     guint id;
 
+    enum mainloop_lane lane;
+    uint64_t set_ns;            // When trigger was last set
+    struct source_stats_s *stats;
 };
 
 static gboolean
@@ -96,7 +489,15 @@ crm_trigger_dispatch(GSource * source, GSourceFunc callback, gpointer userdata)
     trig->trigger = FALSE;
 
     if (callback) {
+        uint64_t start_ns = qb_util_nano_current_get();
+
+        lane_record_wait(trig->lane, trig->set_ns, start_ns);
+        trig->set_ns = 0;
         rc = callback(trig->user_data);
+        lane_record_run(trig->lane, start_ns);
+        if (trig->stats != NULL) {
+            source_record_run(trig->stats, start_ns, FALSE);
+        }
         if (rc < 0) {
             crm_trace("Trigger handler %p not yet complete", trig);
             trig->running = TRUE;
@@ -109,7 +510,11 @@ crm_trigger_dispatch(GSource * source, GSourceFunc callback, gpointer userdata)
 static void
 crm_trigger_finalize(GSource * source)
 {
+    crm_trigger_t *trig = (crm_trigger_t *) source;
+
     crm_trace("Trigger %p destroyed", source);
+    source_stats_unref(trig->stats);
+    trig->stats = NULL;
 }
 
 #if 0
@@ -162,8 +567,8 @@ static GSourceFuncs crm_trigger_funcs = {
 };
 
 static crm_trigger_t *
-mainloop_setup_trigger(GSource * source, int priority, int (*dispatch) (gpointer user_data),
-                       gpointer userdata)
+mainloop_setup_trigger(GSource * source, const char *name, int priority,
+                       int (*dispatch) (gpointer user_data), gpointer userdata)
 {
     crm_trigger_t *trigger = NULL;
 
@@ -172,6 +577,9 @@ mainloop_setup_trigger(GSource * source, int priority, int (*dispatch) (gpointer
     trigger->id = 0;
     trigger->trigger = FALSE;
     trigger->user_data = userdata;
+    trigger->lane = lane_for_priority(priority);
+    trigger->set_ns = 0;
+    trigger->stats = name? hold_source_stats(name) : NULL;
 
     if (dispatch) {
         g_source_set_callback(source, dispatch, trigger, NULL);
@@ -201,6 +609,25 @@ mainloop_trigger_complete(crm_trigger_t * trig)
  */
 crm_trigger_t *
 mainloop_add_trigger(int priority, int (*dispatch) (gpointer user_data), gpointer userdata)
+{
+    return pcmk__mainloop_add_named_trigger(NULL, priority, dispatch, userdata);
+}
+
+/*!
+ * \internal
+ * \brief Create a trigger whose dispatches are tracked under a name
+ *
+ * \param[in] name      Name to report statistics under (or NULL for none)
+ * \param[in] priority  Main loop priority of trigger
+ * \param[in] dispatch  Trigger handler (see mainloop_add_trigger())
+ * \param[in] userdata  Argument for \p dispatch
+ *
+ * \return New trigger
+ */
+crm_trigger_t *
+pcmk__mainloop_add_named_trigger(const char *name, int priority,
+                                 int (*dispatch) (gpointer user_data),
+                                 gpointer userdata)
 {
     GSource *source = NULL;
 
@@ -208,13 +635,17 @@ mainloop_add_trigger(int priority, int (*dispatch) (gpointer user_data), gpointe
     source = g_source_new(&crm_trigger_funcs, sizeof(crm_trigger_t));
     CRM_ASSERT(source != NULL);
 
-    return mainloop_setup_trigger(source, priority, dispatch, userdata);
+    return mainloop_setup_trigger(source, (dispatch? name : NULL), priority,
+                                  dispatch, userdata);
 }
 
 void
 mainloop_set_trigger(crm_trigger_t * source)
 {
     if(source) {
+        if (source->set_ns == 0) {
+            source->set_ns = qb_util_nano_current_get();
+        }
         source->trigger = TRUE;
     }
 }
@@ -282,7 +713,12 @@ crm_signal_dispatch(GSource * source, GSourceFunc callback, gpointer userdata)
 
     sig->trigger.trigger = FALSE;
     if (sig->handler) {
+        uint64_t start_ns = qb_util_nano_current_get();
+
         sig->handler(sig->signal);
+        if (sig->trigger.stats != NULL) {
+            source_record_run(sig->trigger.stats, start_ns, FALSE);
+        }
     }
     return TRUE;
 }
@@ -412,7 +848,10 @@ mainloop_add_signal(int sig, void (*dispatch) (int sig))
     CRM_ASSERT(sizeof(crm_signal_t) > sizeof(GSource));
     source = g_source_new(&crm_signal_funcs, sizeof(crm_signal_t));
 
-    crm_signals[sig] = (crm_signal_t *) mainloop_setup_trigger(source, priority, NULL, NULL);
+    crm_signals[sig] = (crm_signal_t *) mainloop_setup_trigger(source,
+                                                               strsignal(sig),
+                                                               priority, NULL,
+                                                               NULL);
     CRM_ASSERT(crm_signals[sig] != NULL);
 
     crm_signals[sig]->handler = dispatch;
@@ -466,6 +905,12 @@ mainloop_cleanup(void)
     for (int sig = 0; sig < NSIG; ++sig) {
         mainloop_destroy_signal_entry(sig);
     }
+
+    // Sources still alive keep their own references to their entries
+    if (source_stats) {
+        g_hash_table_destroy(source_stats);
+        source_stats = NULL;
+    }
 }
 
 /*
@@ -492,7 +937,13 @@ gio_read_socket(GIOChannel * gio, GIOCondition condition, gpointer data)
      * when we destroy a fd and when mainloop actually gives it up */
     CRM_ASSERT(adaptor->is_used > 0);
 
-    return (adaptor->fn(fd, condition, adaptor->data) == 0);
+    {
+        uint64_t start_ns = qb_util_nano_current_get();
+        gboolean keep = (adaptor->fn(fd, condition, adaptor->data) == 0);
+
+        source_record_run(get_source_stats("ipc-server"), start_ns, TRUE);
+        return keep;
+    }
 }
 
 static void
@@ -613,6 +1064,7 @@ gio_poll_dispatch_update(enum qb_loop_priority p, int32_t fd, int32_t evts,
     adaptor->data = data;
     adaptor->p = p;
     adaptor->is_used++;
+    instrument_poll();
     adaptor->source =
         g_io_add_watch_full(channel, conv_prio_libqb2glib(p), evts,
                             gio_read_socket, adaptor, gio_poll_destroy);
@@ -765,6 +1217,8 @@ struct mainloop_io_s {
     int (*dispatch_fn_io) (gpointer userdata);
     void (*destroy_fn) (gpointer userdata);
 
+    enum mainloop_lane lane;
+    struct source_stats_s *stats;
 };
 
 static gboolean
@@ -772,6 +1226,7 @@ mainloop_gio_callback(GIOChannel * gio, GIOCondition condition, gpointer data)
 {
     gboolean keep = TRUE;
     mainloop_io_t *client = data;
+    uint64_t start_ns = qb_util_nano_current_get();
 
     CRM_ASSERT(client->fd == g_io_channel_unix_get_fd(gio));
 
@@ -779,6 +1234,7 @@ mainloop_gio_callback(GIOChannel * gio, GIOCondition condition, gpointer data)
         if (client->ipc) {
             long rc = 0;
             int max = 10;
+            bool batched = lanes_enabled && (client->lane == lane_bulk);
 
             do {
                 rc = crm_ipc_read(client->ipc);
@@ -796,6 +1252,13 @@ mainloop_gio_callback(GIOChannel * gio, GIOCondition condition, gpointer data)
                     }
                 }
 
+                if (batched && ((qb_util_nano_current_get() - start_ns)
+                                >= (LANE_BULK_BATCH_MS * QB_TIME_NS_IN_MSEC))) {
+                    crm_trace("Yielding %s[%p] after %dms batch",
+                              client->name, client, LANE_BULK_BATCH_MS);
+                    break;
+                }
+
             } while (keep && rc > 0 && --max > 0);
 
         } else {
@@ -850,6 +1313,9 @@ mainloop_gio_callback(GIOChannel * gio, GIOCondition condition, gpointer data)
         crm_err("Strange condition: %d", condition);
     }
 
+    lane_record_run(client->lane, start_ns);
+    source_record_run(client->stats, start_ns, TRUE);
+
     /* keep == FALSE results in mainloop_gio_destroy() being called
      * just before the source is removed from mainloop
      */
@@ -887,6 +1353,7 @@ mainloop_gio_destroy(gpointer c)
 
     crm_trace("Destroyed client %s[%p]", c_name, c);
 
+    source_stats_unref(client->stats);
     free(client->name); client->name = NULL;
     free(client);
 
@@ -949,6 +1416,9 @@ mainloop_add_fd(const char *name, int priority, int fd, void *userdata,
         }
         client->name = strdup(name);
         client->userdata = userdata;
+        client->lane = lane_for_priority(priority);
+        client->stats = hold_source_stats(name);
+        instrument_poll();
 
         if (callbacks) {
             client->destroy_fn = callbacks->destroy;
@@ -1271,6 +1741,7 @@ struct mainloop_timer_s {
         char *name;
         GSourceFunc cb;
         void *userdata;
+        struct source_stats_s *stats;
 };
 
 static gboolean mainloop_timer_cb(gpointer user_data)
@@ -1287,12 +1758,15 @@ static gboolean mainloop_timer_cb(gpointer user_data)
                 */
 
     if(t->cb) {
+        uint64_t start_ns = qb_util_nano_current_get();
+
         crm_trace("Invoking callbacks for timer %s", t->name);
         repeat = t->repeat;
         if(t->cb(t->userdata) == FALSE) {
             crm_trace("Timer %s complete", t->name);
             repeat = FALSE;
         }
+        source_record_run(t->stats, start_ns, FALSE);
     }
 
     if(repeat) {
@@ -1361,6 +1835,7 @@ mainloop_timer_add(const char *name, guint period_ms, bool repeat, GSourceFunc c
         t->repeat = repeat;
         t->cb = cb;
         t->userdata = userdata;
+        t->stats = hold_source_stats(name? name : "timer");
         crm_trace("Created timer %s with %p %p", t->name, userdata, t->userdata);
     }
     return t;
@@ -1372,6 +1847,7 @@ mainloop_timer_del(mainloop_timer_t *t)
     if(t) {
         crm_trace("Destroying timer %s", t->name);
         mainloop_timer_stop(t);
+        source_stats_unref(t->stats);
         free(t->name);
         free(t);
     }
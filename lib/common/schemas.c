@@ -67,6 +67,11 @@ static struct schema_s *known_schemas = NULL;
 static int xml_schema_max = 0;
 static bool silent_logging = FALSE;
 
+#if HAVE_LIBXSLT
+/* Parsed XSLT stylesheets, keyed by file name, loaded on first use */
+static GHashTable *transform_cache = NULL;
+#endif
+
 static void
 xml_log(int priority, const char *fmt, ...)
 G_GNUC_PRINTF(2, 3);
@@ -579,6 +584,13 @@ crm_schema_cleanup(void)
     free(known_schemas);
     known_schemas = NULL;
 
+#if HAVE_LIBXSLT
+    if (transform_cache != NULL) {
+        g_hash_table_destroy(transform_cache);
+        transform_cache = NULL;
+    }
+#endif
+
     xsltCleanupGlobals();  /* XXX proper, explicit reshaking regarding
                                   init/fini routines is pending (pair
                                   of facade functions to express the
@@ -894,10 +906,49 @@ cib_upgrade_err(void *ctx, const char *fmt, ...)
 #define PCMK_SCHEMAS_EMERGENCY_XSLT 1
 #endif
 
+static void
+free_transform(gpointer data)
+{
+    xsltFreeStylesheet((xsltStylesheet *) data);
+}
+
+/*!
+ * \internal
+ * \brief Get a parsed XSLT stylesheet, parsing it on first use
+ *
+ * \param[in] transform  Stylesheet file name (relative to schema directory)
+ *
+ * \return Parsed stylesheet (owned by the cache), or NULL on error
+ */
+static xsltStylesheet *
+get_transform(const char *transform)
+{
+    char *xform = NULL;
+    xsltStylesheet *xslt = NULL;
+
+    if (transform_cache == NULL) {
+        transform_cache = g_hash_table_new_full(crm_str_hash, g_str_equal,
+                                                free, free_transform);
+    } else {
+        xslt = g_hash_table_lookup(transform_cache, transform);
+        if (xslt != NULL) {
+            return xslt;
+        }
+    }
+
+    xform = get_schema_path(NULL, transform);
+    xslt = xsltParseStylesheetFile((pcmkXmlStr) xform);
+    if (xslt != NULL) {
+        crm_trace("Parsed transform %s", xform);
+        g_hash_table_insert(transform_cache, strdup(transform), xslt);
+    }
+    free(xform);
+    return xslt;
+}
+
 static xmlNode *
 apply_transformation(xmlNode *xml, const char *transform, gboolean to_logs)
 {
-    char *xform = NULL;
     xmlNode *out = NULL;
     xmlDocPtr res = NULL;
     xmlDocPtr doc = NULL;
@@ -910,7 +961,6 @@ apply_transformation(xmlNode *xml, const char *transform, gboolean to_logs)
 
     CRM_CHECK(xml != NULL, return FALSE);
     doc = getDocPtr(xml);
-    xform = get_schema_path(NULL, transform);
 
     xmlLoadExtDtdDefaultValue = 1;
     xmlSubstituteEntitiesDefault(1);
@@ -922,7 +972,7 @@ apply_transformation(xmlNode *xml, const char *transform, gboolean to_logs)
         xsltSetGenericErrorFunc(&crm_log_level, cib_upgrade_err);
     }
 
-    xslt = xsltParseStylesheetFile((pcmkXmlStr) xform);
+    xslt = get_transform(transform);
     CRM_CHECK(xslt != NULL, goto cleanup);
 
     res = xsltApplyStylesheet(xslt, doc, NULL);
@@ -943,12 +993,6 @@ apply_transformation(xmlNode *xml, const char *transform, gboolean to_logs)
 #endif
 
   cleanup:
-    if (xslt) {
-        xsltFreeStylesheet(xslt);
-    }
-
-    free(xform);
-
     return out;
 }
 
@@ -1047,6 +1091,7 @@ update_validation(xmlNode **xml_blob, int *best, int max, gboolean transform,
     int max_stable_schemas = xml_latest_schema_index();
     int lpc = 0, match = -1, rc = pcmk_ok;
     int next = -1;  /* -1 denotes "inactive" value */
+    int validated = -1; /* schema xml is already known to be valid for */
 
     CRM_CHECK(best != NULL, return -EINVAL);
     *best = 0;
@@ -1082,7 +1127,10 @@ update_validation(xmlNode **xml_blob, int *best, int max, gboolean transform,
                   known_schemas[lpc].name ? known_schemas[lpc].name : "<unset>",
                   lpc, max_stable_schemas);
 
-        if (validate_with(xml, lpc, to_logs) == FALSE) {
+        /* The loop moves on to a schema only after checking the (unchanged
+         * or just transformed) configuration against it, so don't repeat that
+         */
+        if ((lpc != validated) && (validate_with(xml, lpc, to_logs) == FALSE)) {
             if (next != -1) {
                 crm_info("Configuration not valid for schema: %s",
                          known_schemas[lpc].name);
@@ -1134,6 +1182,9 @@ update_validation(xmlNode **xml_blob, int *best, int max, gboolean transform,
                 crm_debug("%s-style configuration is also valid for %s",
                            known_schemas[lpc].name, known_schemas[next].name);
 
+                if (known_schemas[lpc].transform != NULL) {
+                    validated = next;
+                }
                 lpc = next;
 
             } else {
@@ -1156,6 +1207,7 @@ update_validation(xmlNode **xml_blob, int *best, int max, gboolean transform,
                     *best = next;
                     free_xml(xml);
                     xml = upgrade;
+                    validated = next;
                     rc = pcmk_ok;
 
                 } else {
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2019 the Pacemaker project contributors
+ *
+ * The version control history for this file may have further details.
+ *
+ * This source code is licensed under the GNU Lesser General Public License
+ * version 2.1 or later (LGPLv2.1+) WITHOUT ANY WARRANTY.
+ */
+
+#include <crm_internal.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <crm/crm.h>
+#include <crm/common/trace_internal.h>
+
+/* Daemons run everything of interest from a single main loop thread, so one
+ * ring per process is sufficient and avoids thread-local storage.
+ */
+static pcmk__trace_record_t *ring = NULL;
+static uint64_t ring_next = 0;      // Total records ever written
+static int ring_enabled = -1;       // -1 = not yet checked
+
+static const struct {
+    const char *name;
+    const char *args;
+} trace_events[pcmk__trace_event_max] = {
+    { "none",               "" },
+    { "ipcs-recv",          "pid bytes id" },
+    { "ipcs-send",          "pid bytes flags" },
+    { "ipcc-send",          "id bytes flags" },
+    { "cib-op-start",       "call type options" },
+    { "cib-op-done",        "call type rc" },
+    { "transition-start",   "transition synapses actions" },
+    { "transition-done",    "transition completed status" },
+    { "action-fire",        "transition action type" },
+    { "exec-start",         "call interval timeout" },
+    { "exec-done",          "call rc status" },
+};
+
+static inline uint64_t
+trace_now(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+static bool
+trace_init(void)
+{
+    const char *value = daemon_option("trace_ring");
+
+    ring_enabled = (value == NULL) || crm_is_true(value);
+    if (ring_enabled) {
+        ring = calloc(PCMK__TRACE_RECORDS, sizeof(pcmk__trace_record_t));
+        if (ring == NULL) {
+            ring_enabled = 0;
+        }
+    }
+    return ring_enabled;
+}
+
+/*!
+ * \internal
+ * \brief Record an event in the binary trace ring buffer
+ *
+ * \param[in] event  Event to record
+ * \param[in] arg0   First event-specific argument
+ * \param[in] arg1   Second event-specific argument
+ * \param[in] arg2   Third event-specific argument
+ */
+void
+pcmk__trace(enum pcmk__trace_event event, uint32_t arg0, uint32_t arg1,
+            uint32_t arg2)
+{
+    pcmk__trace_record_t *record = NULL;
+
+    if ((ring_enabled == 0) || ((ring_enabled < 0) && !trace_init())) {
+        return;
+    }
+
+    record = &ring[ring_next++ & (PCMK__TRACE_RECORDS - 1)];
+    record->timestamp_ns = trace_now(CLOCK_MONOTONIC);
+    record->event = event;
+    record->args[0] = arg0;
+    record->args[1] = arg1;
+    record->args[2] = arg2;
+}
+
+/*!
+ * \internal
+ * \brief Write the binary trace ring buffer to a file
+ *
+ * \param[in] filename  Name of file to create
+ *
+ * \return pcmk_ok on success, otherwise -errno
+ */
+int
+pcmk__trace_dump(const char *filename)
+{
+    pcmk__trace_header_t header;
+    uint64_t first = 0;
+    int rc = pcmk_ok;
+    int fd = -1;
+
+    if ((ring_enabled <= 0) || (ring_next == 0)) {
+        return pcmk_ok;
+    }
+
+    first = (ring_next > PCMK__TRACE_RECORDS)? (ring_next - PCMK__TRACE_RECORDS) : 0;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = PCMK__TRACE_MAGIC;
+    header.version = PCMK__TRACE_VERSION;
+    header.record_size = sizeof(pcmk__trace_record_t);
+    header.pid = getpid();
+    header.count = ring_next - first;
+    header.dump_mono_ns = trace_now(CLOCK_MONOTONIC);
+    header.dump_real_ns = trace_now(CLOCK_REALTIME);
+    header.lost = first;
+    if (crm_system_name) {
+        strncpy(header.name, crm_system_name, sizeof(header.name) - 1);
+    }
+
+    fd = open(filename, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0600);
+    if (fd < 0) {
+        rc = -errno;
+        crm_warn("Could not write trace buffer to %s: %s",
+                 filename, pcmk_strerror(rc));
+        return rc;
+    }
+
+    if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+        rc = -EIO;
+    }
+
+    /* Records from the oldest to the end of the ring, then any wrapped part */
+    for (uint64_t i = first; (rc == pcmk_ok) && (i < ring_next); ) {
+        uint64_t start = i & (PCMK__TRACE_RECORDS - 1);
+        uint64_t n = PCMK__TRACE_RECORDS - start;
+        ssize_t len = 0;
+
+        if (n > (ring_next - i)) {
+            n = ring_next - i;
+        }
+        len = n * sizeof(pcmk__trace_record_t);
+
+        if (write(fd, ring + start, len) != len) {
+            rc = -EIO;
+        }
+        i += n;
+    }
+
+    close(fd);
+    if (rc != pcmk_ok) {
+        crm_warn("Could not write trace buffer to %s: %s",
+                 filename, pcmk_strerror(rc));
+        unlink(filename);
+    }
+    return rc;
+}
+
+/*!
+ * \internal
+ * \brief Get the name of a binary trace event
+ *
+ * \param[in] event  Event ID
+ *
+ * \return Readable name of \p event
+ */
+const char *
+pcmk__trace_event_name(uint32_t event)
+{
+    return (event < pcmk__trace_event_max)? trace_events[event].name : "unknown";
+}
+
+/*!
+ * \internal
+ * \brief Get the meaning of a binary trace event's arguments
+ *
+ * \param[in] event  Event ID
+ *
+ * \return Space-separated names of \p event's arguments
+ */
+const char *
+pcmk__trace_arg_names(uint32_t event)
+{
+    return (event < pcmk__trace_event_max)? trace_events[event].args : "";
+}
@@ -237,6 +237,9 @@ __xml_private_clean(xml_private_t *p)
             p->acls = NULL;
         }
 
+        pcmk__free_acl_matches(p->acl_matches);
+        p->acl_matches = NULL;
+
         if(p->deleted_objs) {
             g_list_free_full(p->deleted_objs, __xml_deleted_obj_free);
             p->deleted_objs = NULL;
@@ -4442,6 +4445,7 @@ void
 crm_xml_cleanup(void)
 {
     crm_info("Cleaning up memory from libxml2");
+    pcmk__free_acl_cache();
     crm_schema_cleanup();
     xmlCleanupParser();
 }
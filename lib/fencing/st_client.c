@@ -1490,7 +1490,10 @@ stonith_api_signon(stonith_t * stonith, const char *name, int *stonith_fd)
     } else {
         /* With mainloop */
         native->source =
-            mainloop_add_ipc_client("stonith-ng", G_PRIORITY_MEDIUM, 0, stonith, &st_callbacks);
+            mainloop_add_ipc_client("stonith-ng",
+                                    pcmk__mainloop_lane_priority(PCMK__PRIORITY_CRITICAL,
+                                                                 G_PRIORITY_MEDIUM),
+                                    0, stonith, &st_callbacks);
         native->ipc = mainloop_get_ipc_client(native->source);
     }
 
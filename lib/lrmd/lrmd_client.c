@@ -975,7 +975,10 @@ lrmd_ipc_connect(lrmd_t * lrmd, int *fd)
             rc = -ENOTCONN;
         }
     } else {
-        native->source = mainloop_add_ipc_client(CRM_SYSTEM_LRMD, G_PRIORITY_HIGH, 0, lrmd, &lrmd_callbacks);
+        native->source = mainloop_add_ipc_client(CRM_SYSTEM_LRMD,
+                                                 pcmk__mainloop_lane_priority(PCMK__PRIORITY_OPS,
+                                                                              G_PRIORITY_HIGH),
+                                                 0, lrmd, &lrmd_callbacks);
         native->ipc = mainloop_get_ipc_client(native->source);
     }
 
@@ -1187,9 +1190,16 @@ lrmd_tcp_connect_cb(void *userdata, int sock)
     name = crm_strdup_printf("pacemaker-remote-%s:%d",
                              native->server, native->port);
 
-    native->process_notify = mainloop_add_trigger(G_PRIORITY_HIGH, lrmd_tls_dispatch, lrmd);
+    native->process_notify =
+        pcmk__mainloop_add_named_trigger("lrmd-tls-notify",
+                                         pcmk__mainloop_lane_priority(PCMK__PRIORITY_OPS,
+                                                                      G_PRIORITY_HIGH),
+                                         lrmd_tls_dispatch, lrmd);
     native->source =
-        mainloop_add_fd(name, G_PRIORITY_HIGH, native->sock, lrmd, &lrmd_tls_callbacks);
+        mainloop_add_fd(name,
+                        pcmk__mainloop_lane_priority(PCMK__PRIORITY_OPS,
+                                                     G_PRIORITY_HIGH),
+                        native->sock, lrmd, &lrmd_tls_callbacks);
 
     rc = lrmd_handshake(lrmd, name);
     free(name);
@@ -1276,9 +1286,16 @@ lrmd_tls_connect(lrmd_t * lrmd, int *fd)
         char *name = crm_strdup_printf("pacemaker-remote-%s:%d",
                                        native->server, native->port);
 
-        native->process_notify = mainloop_add_trigger(G_PRIORITY_HIGH, lrmd_tls_dispatch, lrmd);
+        native->process_notify =
+            pcmk__mainloop_add_named_trigger("lrmd-tls-notify",
+                                             pcmk__mainloop_lane_priority(PCMK__PRIORITY_OPS,
+                                                                          G_PRIORITY_HIGH),
+                                             lrmd_tls_dispatch, lrmd);
         native->source =
-            mainloop_add_fd(name, G_PRIORITY_HIGH, native->sock, lrmd, &lrmd_tls_callbacks);
+            mainloop_add_fd(name,
+                            pcmk__mainloop_lane_priority(PCMK__PRIORITY_OPS,
+                                                         G_PRIORITY_HIGH),
+                            native->sock, lrmd, &lrmd_tls_callbacks);
         free(name);
     }
     return pcmk_ok;
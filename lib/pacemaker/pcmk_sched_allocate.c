@@ -2789,6 +2789,32 @@ stage7(pe_working_set_t * data_set)
 
 static int transition_id = -1;
 
+/*!
+ * \internal
+ * \brief Get the ID of the most recently calculated transition
+ *
+ * \return Last transition ID used (or -1 if none yet)
+ */
+int
+pcmk__last_transition_id(void)
+{
+    return transition_id;
+}
+
+/*!
+ * \internal
+ * \brief Set the ID of the most recently calculated transition
+ *
+ * \param[in] id  Transition ID that the next calculation should follow
+ *
+ * \note This allows a calculation that is not (yet) used to give back its ID.
+ */
+void
+pcmk__set_last_transition_id(int id)
+{
+    transition_id = id;
+}
+
 /*!
  * \internal
  * \brief Log a message after calculating a transition
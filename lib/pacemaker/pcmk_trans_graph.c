@@ -12,40 +12,45 @@
 #include <crm/crm.h>
 #include <crm/msg_xml.h>
 #include <crm/common/xml.h>
+#include <crm/common/trace_internal.h>
 #include <pacemaker-internal.h>
 
 crm_graph_functions_t *graph_fns = NULL;
 
-static gboolean
-update_synapse_ready(synapse_t * synapse, int action_id)
-{
-    GListPtr lpc = NULL;
-    gboolean updates = FALSE;
+static void index_graph(crm_graph_t * graph);
 
-    CRM_CHECK(synapse->executed == FALSE, return FALSE);
-    CRM_CHECK(synapse->confirmed == FALSE, return FALSE);
+static gint
+sort_synapse_position(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    return ((const synapse_t *) a)->position - ((const synapse_t *) b)->position;
+}
 
+static void
+mark_synapse_ready(crm_graph_t * graph, synapse_t * synapse)
+{
+    crm_trace("Synapse %d is ready", synapse->id);
     synapse->ready = TRUE;
-    for (lpc = synapse->inputs; lpc != NULL; lpc = lpc->next) {
-        crm_action_t *prereq = (crm_action_t *) lpc->data;
+    g_sequence_insert_sorted(graph->ready, synapse, sort_synapse_position,
+                             NULL);
+}
 
-        crm_trace("Processing input %d", prereq->id);
+static gboolean
+update_synapse_ready(crm_graph_t * graph, crm_action_t * input)
+{
+    synapse_t *synapse = input->synapse;
 
-        if (prereq->id == action_id) {
-            crm_trace("Marking input %d of synapse %d confirmed", action_id, synapse->id);
-            prereq->confirmed = TRUE;
-            updates = TRUE;
+    CRM_CHECK(synapse->executed == FALSE, return FALSE);
+    CRM_CHECK(synapse->confirmed == FALSE, return FALSE);
 
-        } else if (prereq->confirmed == FALSE) {
-            synapse->ready = FALSE;
+    crm_trace("Marking input %d of synapse %d confirmed",
+              input->id, synapse->id);
+    if (input->confirmed == FALSE) {
+        input->confirmed = TRUE;
+        if (--(synapse->inputs_pending) == 0) {
+            mark_synapse_ready(graph, synapse);
         }
-
     }
-
-    if (updates) {
-        crm_trace("Updated synapse %d", synapse->id);
-    }
-    return updates;
+    return TRUE;
 }
 
 static gboolean
@@ -90,24 +95,34 @@ update_synapse_confirmed(synapse_t * synapse, int action_id)
 gboolean
 update_graph(crm_graph_t * graph, crm_action_t * action)
 {
-    gboolean rc = FALSE;
     gboolean updates = FALSE;
+    crm_action_t *own = NULL;
     GListPtr lpc = NULL;
 
-    for (lpc = graph->synapses; lpc != NULL; lpc = lpc->next) {
-        synapse_t *synapse = (synapse_t *) lpc->data;
+    index_graph(graph);
 
-        if (synapse->confirmed || synapse->failed) {
-            crm_trace("Synapse complete");
+    own = g_hash_table_lookup(graph->actions_by_id,
+                              GINT_TO_POINTER(action->id));
+    if ((own != NULL) && own->synapse->executed
+        && (own->synapse->confirmed == FALSE)
+        && (own->synapse->failed == FALSE)) {
+        updates = update_synapse_confirmed(own->synapse, action->id);
+    }
+
+    /* Only the synapses that use this action as an input can be unblocked */
+    lpc = g_hash_table_lookup(graph->dependents, GINT_TO_POINTER(action->id));
+    for (; lpc != NULL; lpc = lpc->next) {
+        crm_action_t *input = (crm_action_t *) lpc->data;
+        synapse_t *synapse = input->synapse;
 
-        } else if (synapse->executed) {
-            crm_trace("Synapse executed");
-            rc = update_synapse_confirmed(synapse, action->id);
+        if (synapse->confirmed || synapse->failed || synapse->executed) {
+            crm_trace("Synapse %d already handled", synapse->id);
 
         } else if (action->failed == FALSE || synapse->priority == INFINITY) {
-            rc = update_synapse_ready(synapse, action->id);
+            if (update_synapse_ready(graph, input)) {
+                updates = TRUE;
+            }
         }
-        updates = updates || rc;
     }
 
     if (updates) {
@@ -116,6 +131,24 @@ update_graph(crm_graph_t * graph, crm_action_t * action)
     return updates;
 }
 
+/*!
+ * \brief Find an action in a transition graph
+ *
+ * \param[in] graph  Transition graph to search
+ * \param[in] id     ID of action to find
+ *
+ * \return Action with \p id in \p graph if found, otherwise NULL
+ */
+crm_action_t *
+find_graph_action(crm_graph_t * graph, int id)
+{
+    if (graph == NULL) {
+        return NULL;
+    }
+    index_graph(graph);
+    return g_hash_table_lookup(graph->actions_by_id, GINT_TO_POINTER(id));
+}
+
 static gboolean
 should_fire_synapse(crm_graph_t * graph, synapse_t * synapse)
 {
@@ -173,6 +206,7 @@ initiate_action(crm_graph_t * graph, crm_action_t * action)
     CRM_CHECK(id != NULL, return FALSE);
 
     action->executed = TRUE;
+    pcmk__trace(pcmk__trace_action_fire, graph->id, action->id, action->type);
     if (action->type == action_type_pseudo) {
         crm_trace("Executing pseudo-event: %s (%d)", id, action->id);
         return graph_fns->pseudo(graph, action);
@@ -232,10 +266,281 @@ fire_synapse(crm_graph_t * graph, synapse_t * synapse)
     return TRUE;
 }
 
+/*!
+ * \internal
+ * \brief Get the time an action is expected to take
+ *
+ * \param[in] graph   Transition graph that \p action is part of
+ * \param[in] action  Action to check
+ *
+ * \return Expected duration of \p action in milliseconds
+ * \note The graph user may supply an estimate (for example, from execution
+ *       history). Otherwise, the action's timeout is used as an upper bound.
+ */
+static guint
+expected_duration(crm_graph_t * graph, crm_action_t * action)
+{
+    guint duration = 0;
+
+    if (action->type == action_type_pseudo) {
+        return 0;
+    }
+    if (graph_fns->duration != NULL) {
+        duration = graph_fns->duration(graph, action);
+    }
+    if ((duration == 0) && (action->timeout > 0)) {
+        duration = (guint) action->timeout;
+    }
+    return duration;
+}
+
+static synapse_t *
+input_producer(crm_graph_t * graph, crm_action_t * input)
+{
+    crm_action_t *action = g_hash_table_lookup(graph->actions_by_id,
+                                               GINT_TO_POINTER(input->id));
+
+    return (action == NULL)? NULL : action->synapse;
+}
+
+static gint
+sort_synapse_critical(gconstpointer a, gconstpointer b)
+{
+    const synapse_t *synapse_a = a;
+    const synapse_t *synapse_b = b;
+
+    if (synapse_a->critical_ms > synapse_b->critical_ms) {
+        return -1;
+    } else if (synapse_a->critical_ms < synapse_b->critical_ms) {
+        return 1;
+    }
+    return 0;
+}
+
+/*!
+ * \internal
+ * \brief Order a graph's synapses so the longest dependency chains fire first
+ *
+ * A synapse's critical path is the expected time from firing it until
+ * everything that (directly or indirectly) depends on it has completed. When
+ * the graph user can defer ready actions (for example, because of job limits),
+ * firing ready synapses with the longest critical path first minimizes the
+ * total time needed to complete the transition.
+ *
+ * \param[in,out] graph  Transition graph to prioritize
+ */
+static void
+prioritize_synapses(crm_graph_t * graph)
+{
+    GListPtr lpc = NULL;
+    GListPtr gIter = NULL;
+    GQueue *queue = g_queue_new();
+    int processed = 0;
+
+    /* Synapse -> number of dependent inputs whose synapse is not processed */
+    GHashTable *waiting = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    graph->prioritized = TRUE;
+
+    for (lpc = graph->synapses; lpc != NULL; lpc = lpc->next) {
+        synapse_t *synapse = (synapse_t *) lpc->data;
+
+        synapse->critical_ms = 0;
+        for (gIter = synapse->inputs; gIter != NULL; gIter = gIter->next) {
+            synapse_t *producer = input_producer(graph, gIter->data);
+
+            if ((producer != NULL) && (producer != synapse)) {
+                int count = GPOINTER_TO_INT(g_hash_table_lookup(waiting,
+                                                                producer));
+
+                g_hash_table_insert(waiting, producer,
+                                    GINT_TO_POINTER(count + 1));
+            }
+        }
+    }
+
+    /* Start from the synapses nothing depends on, and work backward */
+    for (lpc = graph->synapses; lpc != NULL; lpc = lpc->next) {
+        if (g_hash_table_lookup(waiting, lpc->data) == NULL) {
+            g_queue_push_tail(queue, lpc->data);
+        }
+    }
+
+    while (!g_queue_is_empty(queue)) {
+        synapse_t *synapse = g_queue_pop_head(queue);
+        guint duration = 0;
+
+        processed++;
+        for (gIter = synapse->actions; gIter != NULL; gIter = gIter->next) {
+            duration = MAX(duration,
+                           expected_duration(graph,
+                                             (crm_action_t *) gIter->data));
+        }
+
+        // At this point, critical_ms holds the longest dependent path
+        if (synapse->critical_ms > (G_MAXUINT - duration)) {
+            synapse->critical_ms = G_MAXUINT;
+        } else {
+            synapse->critical_ms += duration;
+        }
+
+        for (gIter = synapse->inputs; gIter != NULL; gIter = gIter->next) {
+            synapse_t *producer = input_producer(graph, gIter->data);
+            int count = 0;
+
+            if ((producer == NULL) || (producer == synapse)) {
+                continue;
+            }
+
+            producer->critical_ms = MAX(producer->critical_ms,
+                                        synapse->critical_ms);
+
+            count = GPOINTER_TO_INT(g_hash_table_lookup(waiting, producer)) - 1;
+            if (count > 0) {
+                g_hash_table_insert(waiting, producer, GINT_TO_POINTER(count));
+            } else {
+                g_hash_table_remove(waiting, producer);
+                g_queue_push_tail(queue, producer);
+            }
+        }
+    }
+
+    if (processed < graph->num_synapses) {
+        // The scheduler should never create an ordering loop
+        crm_warn("Could not fully prioritize transition %d: "
+                 "%d of %d synapses are part of an ordering loop",
+                 graph->id, graph->num_synapses - processed,
+                 graph->num_synapses);
+    }
+
+    // g_list_sort() is stable, so ties keep the scheduler's order
+    graph->synapses = g_list_sort(graph->synapses, sort_synapse_critical);
+    if (graph->synapses != NULL) {
+        crm_debug("Prioritized %d synapses of transition %d "
+                  "(longest critical path %ums)", graph->num_synapses,
+                  graph->id, ((synapse_t *) graph->synapses->data)->critical_ms);
+    }
+
+    g_queue_free(queue);
+    g_hash_table_destroy(waiting);
+}
+
+/*!
+ * \internal
+ * \brief Index a transition graph's actions and dependencies
+ *
+ * Map each action ID to its action and to the inputs that refer to it, and
+ * queue the synapses that are ready to fire, so that confirming an action
+ * only needs to visit the synapses it could unblock, and each run only needs
+ * to consider ready synapses. This does nothing if the graph is already
+ * indexed.
+ *
+ * \param[in,out] graph  Transition graph to index
+ */
+static void
+index_graph(crm_graph_t * graph)
+{
+    GListPtr lpc = NULL;
+    GListPtr gIter = NULL;
+    int position = 0;
+
+    if (graph->actions_by_id != NULL) {
+        return;
+    }
+    if (graph_fns == NULL) {
+        set_default_graph_functions();
+    }
+
+    graph->actions_by_id = g_hash_table_new(g_direct_hash, g_direct_equal);
+    graph->dependents = g_hash_table_new(g_direct_hash, g_direct_equal);
+    graph->ready = g_sequence_new(NULL);
+
+    for (lpc = graph->synapses; lpc != NULL; lpc = lpc->next) {
+        synapse_t *synapse = (synapse_t *) lpc->data;
+
+        for (gIter = synapse->actions; gIter != NULL; gIter = gIter->next) {
+            crm_action_t *action = (crm_action_t *) gIter->data;
+
+            g_hash_table_insert(graph->actions_by_id,
+                                GINT_TO_POINTER(action->id), action);
+        }
+    }
+
+    for (lpc = graph->synapses; lpc != NULL; lpc = lpc->next) {
+        synapse_t *synapse = (synapse_t *) lpc->data;
+
+        synapse->inputs_pending = 0;
+        for (gIter = synapse->inputs; gIter != NULL; gIter = gIter->next) {
+            crm_action_t *input = (crm_action_t *) gIter->data;
+            gpointer key = GINT_TO_POINTER(input->id);
+            GListPtr list = g_hash_table_lookup(graph->dependents, key);
+
+            g_hash_table_insert(graph->dependents, key,
+                                g_list_prepend(list, input));
+            if (input->confirmed == FALSE) {
+                synapse->inputs_pending++;
+            }
+        }
+    }
+
+    /* Firing order only matters when ready actions may be deferred, so leave
+     * it alone otherwise (which keeps simulation output stable)
+     */
+    if (graph_fns->allowed != NULL) {
+        prioritize_synapses(graph);
+    }
+
+    for (lpc = graph->synapses; lpc != NULL; lpc = lpc->next) {
+        synapse_t *synapse = (synapse_t *) lpc->data;
+
+        synapse->position = position++;
+        if (synapse->executed) {
+            graph->in_flight = g_list_prepend(graph->in_flight, synapse);
+
+        } else if ((synapse->inputs_pending == 0) && !synapse->failed) {
+            synapse->ready = TRUE;
+            g_sequence_append(graph->ready, synapse);
+        }
+    }
+}
+
+/*!
+ * \internal
+ * \brief Count a graph's skipped and incomplete synapses
+ *
+ * Runs only visit ready synapses, so once nothing more can be fired, check
+ * every synapse to determine whether the transition finished cleanly.
+ *
+ * \param[in,out] graph  Transition graph to check
+ */
+static void
+count_unfired_synapses(crm_graph_t * graph)
+{
+    GListPtr lpc = NULL;
+
+    graph->skipped = 0;
+    graph->incomplete = 0;
+    for (lpc = graph->synapses; lpc != NULL; lpc = lpc->next) {
+        synapse_t *synapse = (synapse_t *) lpc->data;
+
+        if (synapse->failed) {
+            graph->skipped++;
+
+        } else if (synapse->confirmed || synapse->executed) {
+            /* Already handled */
+
+        } else if (should_fire_synapse(graph, synapse) == FALSE) {
+            crm_trace("Synapse %d cannot fire", synapse->id);
+            graph->incomplete++;
+        }
+    }
+}
+
 int
 run_graph(crm_graph_t * graph)
 {
     GListPtr lpc = NULL;
+    GSequenceIter *iter = NULL;
     int stat_log_level = LOG_DEBUG;
     int pass_result = transition_active;
 
@@ -255,33 +560,46 @@ run_graph(crm_graph_t * graph)
     graph->incomplete = 0;
     crm_trace("Entering graph %d callback", graph->id);
 
+    index_graph(graph);
+
     /* Pre-calculate the number of completed and in-flight operations */
-    for (lpc = graph->synapses; lpc != NULL; lpc = lpc->next) {
+    for (lpc = graph->in_flight; lpc != NULL; ) {
         synapse_t *synapse = (synapse_t *) lpc->data;
+        GListPtr next = lpc->next;
 
         if (synapse->confirmed) {
             crm_trace("Synapse %d complete", synapse->id);
-            graph->completed++;
+            graph->num_confirmed++;
+            graph->in_flight = g_list_delete_link(graph->in_flight, lpc);
 
-        } else if (synapse->failed == FALSE && synapse->executed) {
+        } else if (synapse->failed) {
+            graph->in_flight = g_list_delete_link(graph->in_flight, lpc);
+
+        } else {
             crm_trace("Synapse %d: confirmation pending", synapse->id);
             graph->pending++;
         }
+        lpc = next;
     }
+    graph->completed = graph->num_confirmed;
 
-    /* Now check if there is work to do */
-    for (lpc = graph->synapses; lpc != NULL; lpc = lpc->next) {
-        synapse_t *synapse = (synapse_t *) lpc->data;
+    /* Now check if there is work to do (firing a synapse may queue others,
+     * which will be considered in this run if they come later in the list)
+     */
+    iter = g_sequence_get_begin_iter(graph->ready);
+    while (!g_sequence_iter_is_end(iter)) {
+        synapse_t *synapse = g_sequence_get(iter);
+        GSequenceIter *next = NULL;
 
         if (graph->batch_limit > 0 && graph->pending >= graph->batch_limit) {
             crm_debug("Throttling output: batch limit (%d) reached", graph->batch_limit);
             break;
-        } else if (synapse->failed) {
-            graph->skipped++;
-            continue;
 
-        } else if (synapse->confirmed || synapse->executed) {
+        } else if (synapse->failed || synapse->confirmed || synapse->executed) {
             /* Already handled */
+            next = g_sequence_iter_next(iter);
+            g_sequence_remove(iter);
+            iter = next;
             continue;
         }
 
@@ -299,14 +617,21 @@ run_graph(crm_graph_t * graph)
             if (synapse->confirmed == FALSE) {
                 graph->pending++;
             }
+            graph->in_flight = g_list_prepend(graph->in_flight, synapse);
+
+            next = g_sequence_iter_next(iter);
+            g_sequence_remove(iter);
+            iter = next;
 
         } else {
             crm_trace("Synapse %d cannot fire", synapse->id);
             graph->incomplete++;
+            iter = g_sequence_iter_next(iter);
         }
     }
 
     if (graph->pending == 0 && graph->fired == 0) {
+        count_unfired_synapses(graph);
         graph->complete = TRUE;
         stat_log_level = LOG_NOTICE;
         pass_result = transition_complete;
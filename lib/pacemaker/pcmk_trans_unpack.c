@@ -124,7 +124,7 @@ unpack_synapse(crm_graph_t * new_graph, xmlNode * xml_synapse)
 
                 crm_trace("Adding action %d to synapse %d", new_action->id, new_synapse->id);
 
-                new_synapse->actions = g_list_append(new_synapse->actions, new_action);
+                new_synapse->actions = g_list_prepend(new_synapse->actions, new_action);
             }
         }
     }
@@ -148,12 +148,14 @@ unpack_synapse(crm_graph_t * new_graph, xmlNode * xml_synapse)
 
                     crm_trace("Adding input %d to synapse %d", new_input->id, new_synapse->id);
 
-                    new_synapse->inputs = g_list_append(new_synapse->inputs, new_input);
+                    new_synapse->inputs = g_list_prepend(new_synapse->inputs, new_input);
                 }
             }
         }
     }
 
+    new_synapse->actions = g_list_reverse(new_synapse->actions);
+    new_synapse->inputs = g_list_reverse(new_synapse->inputs);
     return new_synapse;
 }
 
@@ -221,11 +223,13 @@ unpack_graph(xmlNode * xml_graph, const char *reference)
             synapse_t *new_synapse = unpack_synapse(new_graph, synapse);
 
             if (new_synapse != NULL) {
-                new_graph->synapses = g_list_append(new_graph->synapses, new_synapse);
+                new_graph->synapses = g_list_prepend(new_graph->synapses, new_synapse);
             }
         }
     }
 
+    new_graph->synapses = g_list_reverse(new_graph->synapses);
+
     crm_debug("Unpacked transition %d: %d actions in %d synapses",
               new_graph->id, new_graph->num_actions, new_graph->num_synapses);
 
@@ -250,19 +254,8 @@ destroy_action(crm_action_t * action)
 static void
 destroy_synapse(synapse_t * synapse)
 {
-    while (g_list_length(synapse->actions) > 0) {
-        crm_action_t *action = g_list_nth_data(synapse->actions, 0);
-
-        synapse->actions = g_list_remove(synapse->actions, action);
-        destroy_action(action);
-    }
-
-    while (g_list_length(synapse->inputs) > 0) {
-        crm_action_t *action = g_list_nth_data(synapse->inputs, 0);
-
-        synapse->inputs = g_list_remove(synapse->inputs, action);
-        destroy_action(action);
-    }
+    g_list_free_full(synapse->actions, (GDestroyNotify) destroy_action);
+    g_list_free_full(synapse->inputs, (GDestroyNotify) destroy_action);
     free(synapse);
 }
 
@@ -272,13 +265,26 @@ destroy_graph(crm_graph_t * graph)
     if (graph == NULL) {
         return;
     }
-    while (g_list_length(graph->synapses) > 0) {
-        synapse_t *synapse = g_list_nth_data(graph->synapses, 0);
 
-        graph->synapses = g_list_remove(graph->synapses, synapse);
-        destroy_synapse(synapse);
+    if (graph->dependents != NULL) {
+        GHashTableIter iter;
+        gpointer value = NULL;
+
+        g_hash_table_iter_init(&iter, graph->dependents);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            g_list_free((GListPtr) value);
+        }
+        g_hash_table_destroy(graph->dependents);
+    }
+    if (graph->actions_by_id != NULL) {
+        g_hash_table_destroy(graph->actions_by_id);
+    }
+    if (graph->ready != NULL) {
+        g_sequence_free(graph->ready);
     }
+    g_list_free(graph->in_flight);
 
+    g_list_free_full(graph->synapses, (GDestroyNotify) destroy_synapse);
     free(graph->source);
     free(graph);
 }
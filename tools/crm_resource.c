@@ -1282,6 +1282,9 @@ main(int argc, char **argv)
                   rsc->id, rsc_id, (host_uname? host_uname: "all nodes"));
         rc = cli_resource_delete(crmd_channel, host_uname, rsc,
                                  operation, interval_spec, TRUE, data_set);
+        if (rc == pcmk_ok) {
+            rc = cli_resource_wait_attrd();
+        }
 
         if ((rc == pcmk_ok) && !BE_QUIET) {
             // Show any reasons why resource might stay stopped
@@ -1309,6 +1312,9 @@ main(int argc, char **argv)
                   rsc->id, rsc_id, (host_uname? host_uname: "all nodes"));
         rc = cli_resource_delete(crmd_channel, host_uname, rsc,
                                  NULL, 0, FALSE, data_set);
+        if (rc == pcmk_ok) {
+            rc = cli_resource_wait_attrd();
+        }
 
         if ((rc == pcmk_ok) && !BE_QUIET) {
             // Show any reasons why resource might stay stopped
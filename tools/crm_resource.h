@@ -68,6 +68,7 @@ int cli_resource_delete(crm_ipc_t *crmd_channel, const char *host_uname,
                         resource_t *rsc, const char *operation,
                         const char *interval_spec, bool just_failures,
                         pe_working_set_t *data_set);
+int cli_resource_wait_attrd(void);
 int cli_cleanup_all(crm_ipc_t *crmd_channel, const char *node_name,
                     const char *operation, const char *interval_spec,
                     pe_working_set_t *data_set);
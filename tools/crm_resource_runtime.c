@@ -8,6 +8,7 @@
  */
 
 #include <crm_resource.h>
+#include <crm/common/ipc_internal.h>  /* pcmk__ipc_send_async() */
 
 int resource_verbose = 0;
 bool do_force = FALSE;
@@ -687,6 +688,63 @@ clear_rsc_failures(crm_ipc_t *crmd_channel, const char *node_name,
     return rc;
 }
 
+/* Failure clean-ups are sent to pacemaker-attrd without waiting for each
+ * reply, so that cleaning up many resources does not take a round trip apiece
+ */
+static mainloop_io_t *attrd_source = NULL;
+static int attrd_clear_rc = pcmk_ok;
+
+struct attrd_clear_s {
+    char *rsc_id;
+    char *node_name;
+};
+
+static void
+attrd_connection_destroy(gpointer user_data)
+{
+    crm_info("Connection to pacemaker-attrd was terminated");
+    attrd_source = NULL;
+}
+
+static crm_ipc_t *
+attrd_channel(void)
+{
+    if (attrd_source == NULL) {
+        struct ipc_client_callbacks attrd_callbacks = {
+            .dispatch = NULL,
+            .destroy = attrd_connection_destroy
+        };
+
+        attrd_source = mainloop_add_ipc_client(T_ATTRD, G_PRIORITY_DEFAULT, 0,
+                                               NULL, &attrd_callbacks);
+    }
+    return attrd_source? mainloop_get_ipc_client(attrd_source) : NULL;
+}
+
+static void
+free_attrd_clear(struct attrd_clear_s *clear)
+{
+    free(clear->rsc_id);
+    free(clear->node_name);
+    free(clear);
+}
+
+static void
+attrd_clear_done(crm_ipc_t *ipc, uint32_t request_id, int rc, xmlNode *reply,
+                 void *user_data)
+{
+    struct attrd_clear_s *clear = user_data;
+
+    if (rc != pcmk_ok) {
+        printf("Unable to clean up %s failures on %s: %s\n",
+               clear->rsc_id, clear->node_name, pcmk_strerror(rc));
+        if (attrd_clear_rc == pcmk_ok) {
+            attrd_clear_rc = rc;
+        }
+    }
+    free_attrd_clear(clear);
+}
+
 static int
 clear_rsc_fail_attrs(resource_t *rsc, const char *operation,
                      const char *interval_spec, node_t *node)
@@ -694,16 +752,60 @@ clear_rsc_fail_attrs(resource_t *rsc, const char *operation,
     int rc = pcmk_ok;
     int attr_options = attrd_opt_none;
     char *rsc_name = rsc_fail_name(rsc);
+    crm_ipc_t *attrd = attrd_channel();
 
     if (pe__is_guest_or_remote_node(node)) {
         attr_options |= attrd_opt_remote;
     }
-    rc = attrd_clear_delegate(NULL, node->details->uname, rsc_name, operation,
-                              interval_spec, NULL, attr_options);
+
+    if (attrd == NULL) {
+        rc = attrd_clear_delegate(NULL, node->details->uname, rsc_name,
+                                  operation, interval_spec, NULL, attr_options);
+
+    } else {
+        xmlNode *clear_op = pcmk__attrd_clear_op(node->details->uname,
+                                                 rsc_name, operation,
+                                                 interval_spec, NULL,
+                                                 attr_options);
+        struct attrd_clear_s *clear = calloc(1, sizeof(struct attrd_clear_s));
+
+        CRM_ASSERT(clear != NULL);
+        clear->rsc_id = strdup(rsc->id);
+        clear->node_name = strdup(node->details->uname);
+
+        rc = pcmk__ipc_send_async(attrd, clear_op, crm_ipc_flags_none, 0,
+                                  attrd_clear_done, clear, NULL);
+        if (rc != pcmk_ok) {
+            free_attrd_clear(clear);
+        }
+        free_xml(clear_op);
+    }
     free(rsc_name);
     return rc;
 }
 
+/*!
+ * \internal
+ * \brief Wait for pacemaker-attrd to acknowledge all failure clean-ups
+ *
+ * \return pcmk_ok if all clean-ups were acknowledged, otherwise -errno of the
+ *         first that failed
+ */
+int
+cli_resource_wait_attrd(void)
+{
+    crm_ipc_t *attrd = attrd_source? mainloop_get_ipc_client(attrd_source) : NULL;
+
+    while (pcmk__ipc_pending_replies(attrd) > 0) {
+        crm_trace("Waiting for %u acknowledgement%s from pacemaker-attrd",
+                  pcmk__ipc_pending_replies(attrd),
+                  (pcmk__ipc_pending_replies(attrd) == 1)? "" : "s");
+        g_main_context_iteration(NULL, TRUE);
+        attrd = attrd_source? mainloop_get_ipc_client(attrd_source) : NULL;
+    }
+    return attrd_clear_rc;
+}
+
 int
 cli_resource_delete(crm_ipc_t *crmd_channel, const char *host_uname,
                     resource_t *rsc, const char *operation,
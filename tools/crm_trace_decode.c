@@ -0,0 +1,207 @@
+/*
+ * Copyright 2019 the Pacemaker project contributors
+ *
+ * The version control history for this file may have further details.
+ *
+ * This source code is licensed under the GNU General Public License version 2
+ * or later (GPLv2+) WITHOUT ANY WARRANTY.
+ */
+
+#include <crm_internal.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <crm/crm.h>
+#include <crm/common/trace_internal.h>
+
+/* *INDENT-OFF* */
+static struct crm_option long_options[] = {
+    /* Top-level Options */
+    {"help",       0, 0, '?', "\tThis text"},
+    {"version",    0, 0, '$', "\tVersion information"  },
+    {"verbose",    0, 0, 'V', "\tIncrease debug output"},
+
+    {"relative",   0, 0, 'r', "\tShow times relative to the first record"
+     "\n\t\t\trather than as wall clock times"},
+    {"event",      1, 0, 'e', "\tShow only records for the named event"
+     " (may be specified multiple times)"},
+
+    {"-spacer-",   1, 0, '-', "\nTrace files are written next to blackbox files"
+     " (with a .trace suffix) whenever a daemon dumps its blackbox.\n"},
+
+    {0, 0, 0, 0}
+};
+/* *INDENT-ON* */
+
+static bool show_relative = FALSE;
+static GHashTable *show_events = NULL;
+
+static void
+print_timestamp(const pcmk__trace_header_t *header, uint64_t first_ns,
+                uint64_t ts)
+{
+    if (show_relative) {
+        uint64_t delta = ts - first_ns;
+
+        printf("%6llu.%06llu",
+               (unsigned long long) (delta / 1000000000),
+               (unsigned long long) ((delta % 1000000000) / 1000));
+
+    } else {
+        // Convert monotonic timestamp to wall clock using dump-time offset
+        uint64_t real_ns = header->dump_real_ns - (header->dump_mono_ns - ts);
+        time_t secs = (time_t) (real_ns / 1000000000);
+        struct tm tm;
+        char buf[32];
+
+        localtime_r(&secs, &tm);
+        strftime(buf, sizeof(buf), "%b %d %H:%M:%S", &tm);
+        printf("%s.%06llu", buf,
+               (unsigned long long) ((real_ns % 1000000000) / 1000));
+    }
+}
+
+static void
+print_record(const pcmk__trace_header_t *header, uint64_t first_ns,
+             const pcmk__trace_record_t *record)
+{
+    const char *event = pcmk__trace_event_name(record->event);
+    char *names = strdup(pcmk__trace_arg_names(record->event));
+    char *saveptr = NULL;
+    char *name = NULL;
+
+    CRM_ASSERT(names != NULL);
+
+    if ((show_events != NULL)
+        && (g_hash_table_lookup(show_events, event) == NULL)) {
+        free(names);
+        return;
+    }
+
+    print_timestamp(header, first_ns, record->timestamp_ns);
+    printf(" %-18s", event);
+
+    name = strtok_r(names, " ", &saveptr);
+    for (int lpc = 0; lpc < 3; lpc++) {
+        if (name != NULL) {
+            printf(" %s=%d", name, (int) record->args[lpc]);
+            name = strtok_r(NULL, " ", &saveptr);
+        } else if (record->event >= pcmk__trace_event_max) {
+            printf(" arg%d=%u", lpc, record->args[lpc]);
+        }
+    }
+    printf("\n");
+    free(names);
+}
+
+static crm_exit_t
+decode_file(const char *filename)
+{
+    pcmk__trace_header_t header;
+    pcmk__trace_record_t record;
+    uint64_t first_ns = 0;
+    FILE *fp = fopen(filename, "r");
+
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open %s: %s\n", filename, strerror(errno));
+        return CRM_EX_NOINPUT;
+    }
+
+    if ((fread(&header, sizeof(header), 1, fp) != 1)
+        || (header.magic != PCMK__TRACE_MAGIC)) {
+        fprintf(stderr, "%s is not a Pacemaker trace file\n", filename);
+        fclose(fp);
+        return CRM_EX_DATAERR;
+    }
+
+    if ((header.version != PCMK__TRACE_VERSION)
+        || (header.record_size != sizeof(pcmk__trace_record_t))) {
+        fprintf(stderr, "%s uses unsupported trace format %d "
+                "(record size %d)\n", filename, header.version,
+                header.record_size);
+        fclose(fp);
+        return CRM_EX_DATAERR;
+    }
+
+    header.name[sizeof(header.name) - 1] = '\0';
+    printf("# %s[%u]: %u records (%llu older records lost)\n",
+           (header.name[0]? header.name : "unknown"), header.pid, header.count,
+           (unsigned long long) header.lost);
+
+    for (uint32_t lpc = 0; lpc < header.count; lpc++) {
+        if (fread(&record, sizeof(record), 1, fp) != 1) {
+            fprintf(stderr, "%s is truncated after %u records\n",
+                    filename, lpc);
+            fclose(fp);
+            return CRM_EX_DATAERR;
+        }
+        if (lpc == 0) {
+            first_ns = record.timestamp_ns;
+        }
+        print_record(&header, first_ns, &record);
+    }
+
+    fclose(fp);
+    return CRM_EX_OK;
+}
+
+int
+main(int argc, char **argv)
+{
+    int flag = 0;
+    int option_index = 0;
+    crm_exit_t exit_code = CRM_EX_OK;
+
+    crm_log_cli_init("crm_trace_decode");
+    crm_set_options(NULL, "[options] <trace file> [<trace file>...]",
+                    long_options,
+                    "Tool for displaying the binary trace buffer dumped by"
+                    " Pacemaker daemons");
+
+    while (flag >= 0) {
+        flag = crm_get_option(argc, argv, &option_index);
+        switch (flag) {
+            case -1:
+                break;
+            case 'V':
+                crm_bump_log_level(argc, argv);
+                break;
+            case '$':
+            case '?':
+                crm_help(flag, CRM_EX_OK);
+                break;
+            case 'r':
+                show_relative = TRUE;
+                break;
+            case 'e':
+                if (show_events == NULL) {
+                    show_events = crm_str_table_new();
+                }
+                g_hash_table_insert(show_events, strdup(optarg), strdup("1"));
+                break;
+            default:
+                crm_help(flag, CRM_EX_USAGE);
+                break;
+        }
+    }
+
+    if (optind >= argc) {
+        crm_help('?', CRM_EX_USAGE);
+    }
+
+    for (int lpc = optind; lpc < argc; lpc++) {
+        crm_exit_t file_rc = decode_file(argv[lpc]);
+
+        if (file_rc != CRM_EX_OK) {
+            exit_code = file_rc;
+        }
+    }
+
+    if (show_events != NULL) {
+        g_hash_table_destroy(show_events);
+    }
+    crm_exit(exit_code);
+}
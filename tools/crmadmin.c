@@ -54,10 +54,13 @@ static gboolean DO_NODE_LIST = FALSE;
 static gboolean BE_SILENT = FALSE;
 static gboolean DO_RESOURCE_LIST = FALSE;
 static const char *crmd_operation = NULL;
+static const char *ipc_stats_server = NULL;
 static char *dest_node = NULL;
 static crm_exit_t exit_code = CRM_EX_OK;
 static const char *sys_to = NULL;
 
+static crm_exit_t show_ipc_stats(const char *server);
+
 /* *INDENT-OFF* */
 static struct crm_option long_options[] = {
     /* Top-level Options */
@@ -79,6 +82,11 @@ static struct crm_option long_options[] = {
         "(Advanced) Stop the controller (not the rest of the cluster stack) on specified node"
     },
     {"health",    0, 0, 'H', NULL, 1},
+    {
+        "ipc-stats", 1, 0, 'I',
+        "(Advanced) Display per-client statistics of the named local IPC server"
+    },
+    {"-spacer-",  1, 0, '-', "\n\tFor example: cib_rw, crmd, stonith-ng, lrmd, attrd, pengine, or pacemakerd.\n"},
     
     {"-spacer-",	1, 0, '-', "\nAdditional Options:"},
     {XML_ATTR_TIMEOUT, 1, 0, 't', "Time (in milliseconds) to wait before declaring the operation failed"},
@@ -156,6 +164,9 @@ main(int argc, char **argv)
             case 'H':
                 DO_HEALTH = TRUE;
                 break;
+            case 'I':
+                ipc_stats_server = optarg;
+                break;
             default:
                 printf("Argument code 0%o (%c) is not (?yet?) supported\n", flag, flag);
                 ++argerr;
@@ -178,6 +189,10 @@ main(int argc, char **argv)
         crm_help('?', CRM_EX_USAGE);
     }
 
+    if (ipc_stats_server != NULL) {
+        crm_exit(show_ipc_stats(ipc_stats_server));
+    }
+
     if (do_init()) {
         int res = 0;
 
@@ -310,6 +325,100 @@ do_work(void)
     return ret;
 }
 
+static const char *
+stat_value(xmlNode *xml, const char *name)
+{
+    const char *value = crm_element_value(xml, name);
+
+    return value? value : "0";
+}
+
+/*!
+ * \internal
+ * \brief Query and display a local IPC server's per-client statistics
+ *
+ * \param[in] server  Name of IPC server to query
+ *
+ * \return Exit status to use
+ */
+static crm_exit_t
+show_ipc_stats(const char *server)
+{
+    crm_ipc_t *ipc = crm_ipc_new(server, 0);
+    xmlNode *request = NULL;
+    xmlNode *reply = NULL;
+    crm_exit_t rc = CRM_EX_OK;
+
+    if ((ipc == NULL) || !crm_ipc_connect(ipc)) {
+        fprintf(stderr, "Could not connect to IPC server %s\n", server);
+        crm_ipc_destroy(ipc);
+        return CRM_EX_UNAVAILABLE;
+    }
+
+    request = create_xml_node(NULL, __FUNCTION__);
+    crm_xml_add(request, F_CRM_TASK, CRM_OP_IPC_STATS);
+    crm_xml_add(request, F_CRM_SYS_FROM, crm_system_name);
+
+    if ((crm_ipc_send(ipc, request, crm_ipc_client_response,
+                      message_timeout_ms, &reply) <= 0) || (reply == NULL)) {
+        fprintf(stderr, "No reply from IPC server %s\n", server);
+        rc = CRM_EX_TIMEOUT;
+
+    } else if (safe_str_neq(crm_element_name(reply), "ipc-stats")) {
+        fprintf(stderr, "IPC server %s refused request "
+                "(only root and " CRM_DAEMON_USER " may view statistics)\n",
+                server);
+        rc = CRM_EX_INSUFFICIENT_PRIV;
+
+    } else if (BE_SILENT) {
+        char *buffer = dump_xml_formatted(reply);
+
+        printf("%s", buffer);
+        free(buffer);
+
+    } else {
+        printf("%s[%s]: %s clients, %s evicted\n",
+               crm_str(crm_element_value(reply, "server")),
+               stat_value(reply, "pid"), stat_value(reply, "clients"),
+               stat_value(reply, "evictions"));
+
+        for (xmlNode *client = __xml_first_child(reply); client != NULL;
+             client = __xml_next(client)) {
+
+            printf("  %s[%s] (%s, %s)\n"
+                   "    received: %s messages, %s bytes (%s uncompressed)\n"
+                   "    sent:     %s messages, %s bytes (%s uncompressed)\n"
+                   "    replies:  %s, average %sus, slowest %sus\n"
+                   "    events:   %s queued (high %s, limit %s), "
+                   "blocked %s times, retry delay %sms\n",
+                   crm_str(crm_element_value(client, XML_ATTR_NAME)),
+                   stat_value(client, "pid"),
+                   crm_str(crm_element_value(client, "type")),
+                   crm_str(crm_element_value(client, "user")),
+                   stat_value(client, "recv-msgs"),
+                   stat_value(client, "recv-bytes"),
+                   stat_value(client, "recv-raw-bytes"),
+                   stat_value(client, "sent-msgs"),
+                   stat_value(client, "sent-bytes"),
+                   stat_value(client, "sent-raw-bytes"),
+                   stat_value(client, "replies"),
+                   stat_value(client, "service-avg-us"),
+                   stat_value(client, "service-max-us"),
+                   stat_value(client, "queue-length"),
+                   stat_value(client, "queue-high"),
+                   stat_value(client, "queue-max"),
+                   stat_value(client, "blocked"),
+                   stat_value(client, "flush-delay-ms"));
+        }
+    }
+
+    free_xml(request);
+    free_xml(reply);
+    crm_ipc_close(ipc);
+    crm_ipc_destroy(ipc);
+    return rc;
+}
+
 void
 crmadmin_ipc_connection_destroy(gpointer user_data)
 {